@@ -0,0 +1,266 @@
+#include "Animation.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include "Libraries/imgui/imgui.h"
+#include "Util/ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace {
+	constexpr float twoPi = 6.28318530718f;
+}
+
+Engine::Animation::Animation()
+	: time(), duration(), speed(1.f), playing(), loop(true), fixedStep(), sequenceFrameRate(30),
+	changed(), turntableRequested(), cameraKeyRequested(), clearRequested(), turntablePeriod(8.f), cameraKeyInterval(2.f)
+{
+}
+
+void Engine::Animation::clear()
+{
+	clearedNodes.insert(clearedNodes.end(), trackNodes.begin(), trackNodes.end());
+	trackNodes.clear();
+	nodeTracks.clear();
+	cameraTrack.clear();
+	sampledTransforms.clear();
+
+	time = 0.f;
+	duration = 0.f;
+	playing = false;
+}
+
+void Engine::Animation::setNodeTrack(std::size_t node, std::vector<Keyframe> keyframes)
+{
+	const auto it = find(trackNodes.begin(), trackNodes.end(), node);
+	const size_t trackIndex = it - trackNodes.begin();
+
+	if (keyframes.empty()) {
+		// Removes the track
+		if (it != trackNodes.end()) {
+			trackNodes.erase(it);
+			nodeTracks.erase(nodeTracks.begin() + trackIndex);
+			clearedNodes.push_back(node);
+		}
+	}
+	else if (it != trackNodes.end()) {
+		nodeTracks[trackIndex] = move(keyframes);
+	}
+	else {
+		trackNodes.push_back(node);
+		nodeTracks.push_back(move(keyframes));
+	}
+
+	updateDuration();
+}
+
+void Engine::Animation::setCameraTrack(std::vector<Keyframe> keyframes)
+{
+	cameraTrack = move(keyframes);
+	updateDuration();
+}
+
+std::vector<Engine::Animation::Keyframe> Engine::Animation::createTurntable(float period)
+{
+	// Quarter turns, so that slerp never has to take the long way round
+	vector<Keyframe> keyframes;
+	for (int i = 0; i <= 4; ++i) {
+		Keyframe keyframe = { period * i / 4.f, { 0.f, 0.f, 0.f }, {}, { 1.f, 1.f, 1.f } };
+		XMStoreFloat4(&keyframe.rotation, XMQuaternionRotationRollPitchYaw(0.f, twoPi * i / 4.f, 0.f));
+		keyframes.push_back(keyframe);
+	}
+
+	return keyframes;
+}
+
+bool Engine::Animation::update(float deltaSeconds, SceneGraph& sceneGraph, Camera& camera)
+{
+	bool moved = changed;
+	changed = false;
+
+	moved |= applyRequests(sceneGraph, camera);
+
+	// Nodes whose track was removed go back to their local transform
+	for (size_t node : clearedNodes) {
+		if (find(trackNodes.begin(), trackNodes.end(), node) == trackNodes.end()) {
+			sceneGraph.clearAnimatedTransform(node);
+			moved = true;
+		}
+	}
+	clearedNodes.clear();
+
+	if (playing && duration > 0.f) {
+		time += fixedStep ? 1.f / sequenceFrameRate : deltaSeconds * speed;
+		if (loop) {
+			time = std::fmod(time, duration);
+		}
+		else if (time >= duration) {
+			time = duration;
+			playing = false;
+		}
+		moved = true;
+	}
+
+	if (moved) {
+		applyNodeTracks(sceneGraph, time);
+		applyCameraTrack(camera, time);
+	}
+
+	return moved;
+}
+
+float Engine::Animation::getTime() const
+{
+	return time;
+}
+
+void Engine::Animation::setTime(float time)
+{
+	this->time = time;
+	changed = true;
+}
+
+float Engine::Animation::getDuration() const
+{
+	return duration;
+}
+
+bool Engine::Animation::isPlaying() const
+{
+	return playing;
+}
+
+void Engine::Animation::setPlaying(bool playing)
+{
+	this->playing = playing;
+}
+
+void Engine::Animation::drawUI()
+{
+	ImGui::PushID(this);
+
+	ImGui::Checkbox("Play", &playing);
+	ImGui::SameLine();
+	ImGui::Checkbox("Loop", &loop);
+
+	changed = ImGui::SliderFloat("Time", &time, 0.f, duration);
+	ImGui::DragFloat("Speed", &speed, 0.01f, 0.f, 10.f);
+
+	// Renders a sequence independent of the frame time
+	ImGui::Checkbox("Fixed Step", &fixedStep);
+	if (fixedStep) {
+		ImGui::SliderInt("Frame Rate", &sequenceFrameRate, 1, 120);
+	}
+
+	ImGui::DragFloat("Turntable Period", &turntablePeriod, 0.1f, 0.1f, 600.f);
+	turntableRequested |= ImGui::Button("Turntable");
+	ImGui::SameLine();
+	clearRequested |= ImGui::Button("Clear");
+
+	ImGui::DragFloat("Camera Key Interval", &cameraKeyInterval, 0.1f, 0.1f, 600.f);
+	cameraKeyRequested |= ImGui::Button("Add Camera Key");
+
+	ImGui::Text("%zu node tracks, %zu camera keys, %.2f s", nodeTracks.size(), cameraTrack.size(), duration);
+
+	ImGui::PopID();
+}
+
+bool Engine::Animation::hasChanged() const
+{
+	return changed;
+}
+
+Engine::Animation::Sample Engine::Animation::sample(const std::vector<Keyframe>& keyframes, float time)
+{
+	// First keyframe after time
+	const auto next = upper_bound(keyframes.begin(), keyframes.end(), time, [](float t, const Keyframe& keyframe) { return t < keyframe.time; });
+	if (next == keyframes.begin() || next == keyframes.end()) {
+		const Keyframe& keyframe = next == keyframes.begin() ? keyframes.front() : keyframes.back();
+		return { XMLoadFloat3(&keyframe.position), XMLoadFloat4(&keyframe.rotation), XMLoadFloat3(&keyframe.scale) };
+	}
+
+	const Keyframe& previous = *(next - 1);
+	const float t = (time - previous.time) / (next->time - previous.time);
+
+	return {
+		XMVectorLerp(XMLoadFloat3(&previous.position), XMLoadFloat3(&next->position), t),
+		XMQuaternionSlerp(XMLoadFloat4(&previous.rotation), XMLoadFloat4(&next->rotation), t),
+		XMVectorLerp(XMLoadFloat3(&previous.scale), XMLoadFloat3(&next->scale), t)
+	};
+}
+
+void Engine::Animation::updateDuration()
+{
+	duration = cameraTrack.empty() ? 0.f : cameraTrack.back().time;
+	for (const auto& track : nodeTracks) {
+		duration = std::max(duration, track.back().time);
+	}
+
+	time = std::min(time, duration);
+}
+
+void Engine::Animation::applyNodeTracks(SceneGraph& sceneGraph, float time)
+{
+	sampledTransforms.resize(nodeTracks.size());
+
+	const size_t batchCount = (nodeTracks.size() + tracksPerBatch - 1) / tracksPerBatch;
+	Util::ThreadPool::getDefault().parallelFor(batchCount, [&](size_t batch) {
+		const size_t end = std::min(nodeTracks.size(), (batch + 1) * tracksPerBatch);
+		for (size_t i = batch * tracksPerBatch; i < end; ++i) {
+			const Sample s = sample(nodeTracks[i], time);
+			XMStoreFloat3x4(&sampledTransforms[i], XMMatrixAffineTransformation(s.scale, XMVectorZero(), s.rotation, s.position));
+		}
+	});
+
+	// The scene graph isn't thread safe
+	for (size_t i = 0; i < trackNodes.size(); ++i) {
+		sceneGraph.setAnimatedTransform(trackNodes[i], sampledTransforms[i]);
+	}
+}
+
+void Engine::Animation::applyCameraTrack(Camera& camera, float time) const
+{
+	if (cameraTrack.empty()) {
+		return;
+	}
+
+	const Sample s = sample(cameraTrack, time);
+	camera.setPosition(XMVectorSetW(s.position, 1.f));
+	camera.lookTo(XMVector3Rotate(XMVectorSet(0.f, 0.f, -1.f, 0.f), s.rotation));
+}
+
+bool Engine::Animation::applyRequests(SceneGraph& sceneGraph, Camera& camera)
+{
+	const bool moved = clearRequested || turntableRequested;
+
+	if (clearRequested) {
+		clear();
+	}
+
+	if (turntableRequested && !sceneGraph.getRoots().empty()) {
+		setNodeTrack(sceneGraph.getRoots().front(), createTurntable(turntablePeriod));
+		playing = true;
+	}
+
+	if (cameraKeyRequested) {
+		// Orientation that turns -Z into the camera's direction
+		XMFLOAT3 direction;
+		XMStoreFloat3(&direction, XMVector3Normalize(camera.getDirection()));
+		const float pitch = std::asin(std::clamp(direction.y, -1.f, 1.f));
+		const float yaw = std::atan2(-direction.x, -direction.z);
+
+		// Appended, the camera is left where it is so that the next key can be set up
+		Keyframe keyframe = { cameraTrack.empty() ? 0.f : cameraTrack.back().time + cameraKeyInterval, {}, {}, { 1.f, 1.f, 1.f } };
+		XMStoreFloat3(&keyframe.position, camera.getPosition());
+		XMStoreFloat4(&keyframe.rotation, XMQuaternionRotationRollPitchYaw(pitch, yaw, 0.f));
+		cameraTrack.push_back(keyframe);
+
+		updateDuration();
+	}
+
+	turntableRequested = cameraKeyRequested = clearRequested = false;
+
+	return moved;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+
+#include "IDrawableUI.h"
+#include "Camera.h"
+#include "SceneGraph.h"
+
+namespace Engine {
+	// Keyframed position / rotation / scale tracks, played back on scene graph nodes and on the camera.
+	// Node tracks are sampled in batches on the thread pool and set as the nodes' animated transforms, so the
+	// scene graph only recomputes the animated subtrees and the TLAS is refit rather than rebuilt.
+	class Animation
+		: public IDrawableUI
+	{
+	public:
+		struct Keyframe {
+			float time; // seconds
+			DirectX::XMFLOAT3 position;
+			DirectX::XMFLOAT4 rotation; // quaternion
+			DirectX::XMFLOAT3 scale;
+		};
+
+		// Node tracks sampled by a single task
+		static constexpr std::size_t tracksPerBatch = 64;
+
+		Animation();
+
+		void clear();
+
+		// Keyframes have to be sorted by time. Replaces the node's track if it already has one.
+		void setNodeTrack(std::size_t node, std::vector<Keyframe> keyframes);
+		// The rotation turns the camera's default direction (-Z), scale is ignored
+		void setCameraTrack(std::vector<Keyframe> keyframes);
+
+		// One turn around the Y axis every period seconds
+		static std::vector<Keyframe> createTurntable(float period);
+
+		// Advances the time by deltaSeconds (fixed step when rendering a sequence), then applies the tracks.
+		// Returns true if anything moved.
+		bool update(float deltaSeconds, SceneGraph& sceneGraph, Camera& camera);
+
+		float getTime() const;
+		void setTime(float time);
+		// Time of the last keyframe of all tracks
+		float getDuration() const;
+		bool isPlaying() const;
+		void setPlaying(bool playing);
+
+		void drawUI() override;
+		bool hasChanged() const override;
+
+	private:
+		struct Sample {
+			DirectX::XMVECTOR position;
+			DirectX::XMVECTOR rotation;
+			DirectX::XMVECTOR scale;
+		};
+
+		static Sample sample(const std::vector<Keyframe>& keyframes, float time);
+		void updateDuration();
+		void applyNodeTracks(SceneGraph& sceneGraph, float time);
+		void applyCameraTrack(Camera& camera, float time) const;
+		// Requests made through the UI, which has no access to the scene graph or camera. Returns true if the scene moved.
+		bool applyRequests(SceneGraph& sceneGraph, Camera& camera);
+
+		std::vector<std::size_t> trackNodes;
+		std::vector<std::vector<Keyframe>> nodeTracks;
+		std::vector<Keyframe> cameraTrack;
+		// Nodes that were animated before the last clear, their animated transforms are reset on the next update
+		std::vector<std::size_t> clearedNodes;
+
+		// Output of the batched sampling, one per node track
+		std::vector<DirectX::XMFLOAT3X4> sampledTransforms;
+
+		float time;
+		float duration;
+		float speed;
+		bool playing;
+		bool loop;
+		// Sequence rendering: every update advances the time by exactly one frame
+		bool fixedStep;
+		int sequenceFrameRate;
+
+		bool changed;
+		bool turntableRequested;
+		bool cameraKeyRequested;
+		bool clearRequested;
+		float turntablePeriod;
+		// Time between camera keys added through the UI
+		float cameraKeyInterval;
+	};
+}
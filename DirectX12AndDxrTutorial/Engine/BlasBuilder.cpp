@@ -0,0 +1,135 @@
+#include "BlasBuilder.h"
+
+#include "Libraries/d3dx12.h"
+#include "Exception/Exception.h"
+#include "Exception/WindowException.h"
+
+namespace wrl = Microsoft::WRL;
+
+using namespace std;
+using namespace Util;
+
+using CompactedSizeDesc = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE_DESC;
+
+Engine::BlasBuilder::BlasBuilder(wrl::ComPtr<ID3D12Device5> pDevice, CommandQueue& commandQueue, UINT64 scratchBudget)
+	: pDevice(pDevice), commandQueue(commandQueue), scratchBudget(scratchBudget)
+{
+}
+
+Engine::BlasBuilder::Result Engine::BlasBuilder::build(wrl::ComPtr<ID3D12GraphicsCommandList4>& pCommandList, const std::vector<Geometry>& geometries, UINT vertexStride)
+{
+	HRESULT hr;
+
+	const size_t count = geometries.size();
+	Result result = {};
+	if (count == 0) {
+		return result;
+	}
+
+	// Inputs point into geometryDescs, so it may not be resized afterwards
+	vector<D3D12_RAYTRACING_GEOMETRY_DESC> geometryDescs(count);
+	vector<D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS> inputs(count);
+	vector<uint64_t> scratchSizes(count);
+	vector<uint64_t> resultSizes(count);
+
+	for (size_t i = 0; i < count; ++i) {
+		D3D12_RAYTRACING_GEOMETRY_DESC& geometryDesc = geometryDescs[i];
+		geometryDesc.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
+		geometryDesc.Flags = D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE;
+		geometryDesc.Triangles.VertexBuffer.StartAddress = geometries[i].vertexBuffer;
+		geometryDesc.Triangles.VertexBuffer.StrideInBytes = vertexStride;
+		geometryDesc.Triangles.VertexCount = geometries[i].vertexCount;
+		geometryDesc.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+
+		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS& input = inputs[i];
+		input.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+		input.NumDescs = 1;
+		input.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+		input.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_COMPACTION | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+		input.pGeometryDescs = &geometryDesc;
+
+		D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO prebuildInfo = {};
+		pDevice->GetRaytracingAccelerationStructurePrebuildInfo(&input, &prebuildInfo);
+		scratchSizes[i] = prebuildInfo.ScratchDataSizeInBytes;
+		resultSizes[i] = prebuildInfo.ResultDataMaxSizeInBytes;
+	}
+
+	const BlasBuildPlan plan(scratchSizes, resultSizes, scratchBudget);
+
+	wrl::ComPtr<ID3D12Resource> pScratch = DXUtil::createCommittedResource(pDevice, D3D12_HEAP_TYPE_DEFAULT, plan.getScratchArenaSize(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+	wrl::ComPtr<ID3D12Resource> pUncompacted = DXUtil::createCommittedResource(pDevice, D3D12_HEAP_TYPE_DEFAULT, plan.getResultSize(), D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+	wrl::ComPtr<ID3D12Resource> pPostbuildInfo = DXUtil::createCommittedResource(pDevice, D3D12_HEAP_TYPE_DEFAULT, count * sizeof(CompactedSizeDesc), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+	wrl::ComPtr<ID3D12Resource> pPostbuildReadback = DXUtil::createCommittedResource(pDevice, D3D12_HEAP_TYPE_READBACK, count * sizeof(CompactedSizeDesc), D3D12_RESOURCE_STATE_COPY_DEST);
+
+	for (const auto& batch : plan.getBatches()) {
+		if (batch.begin > 0) {
+			// The previous batch has to be done with the arena
+			pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::UAV(pScratch.Get()));
+		}
+
+		for (size_t i = batch.begin; i < batch.end; ++i) {
+			D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC blasDesc = {};
+			blasDesc.Inputs = inputs[i];
+			blasDesc.DestAccelerationStructureData = pUncompacted->GetGPUVirtualAddress() + plan.getBuilds()[i].resultOffset;
+			blasDesc.ScratchAccelerationStructureData = pScratch->GetGPUVirtualAddress() + plan.getBuilds()[i].scratchOffset;
+
+			// The compacted size is written as part of the build
+			D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC postbuildDesc = {};
+			postbuildDesc.DestBuffer = pPostbuildInfo->GetGPUVirtualAddress() + i * sizeof(CompactedSizeDesc);
+			postbuildDesc.InfoType = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE;
+
+			pCommandList->BuildRaytracingAccelerationStructure(&blasDesc, 1, &postbuildDesc);
+		}
+	}
+
+	pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(pPostbuildInfo.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE));
+	pCommandList->CopyResource(pPostbuildReadback.Get(), pPostbuildInfo.Get());
+
+	executeAndWait(pCommandList);
+	pScratch.Reset();
+
+	// Read back the compacted sizes
+	vector<uint64_t> compactedSizes(count);
+	const D3D12_RANGE readRange = { 0, count * sizeof(CompactedSizeDesc) };
+	CompactedSizeDesc* pCompactedSizes;
+	GFXTHROWIFFAILED(pPostbuildReadback->Map(0, &readRange, reinterpret_cast<void**>(&pCompactedSizes)));
+	for (size_t i = 0; i < count; ++i) {
+		compactedSizes[i] = pCompactedSizes[i].CompactedSizeInBytes;
+	}
+	const D3D12_RANGE writeRange = { 0, 0 };
+	pPostbuildReadback->Unmap(0, &writeRange);
+
+	uint64_t compactedSize;
+	const vector<uint64_t> compactedOffsets = BlasBuildPlan::pack(compactedSizes, compactedSize);
+
+	wrl::ComPtr<ID3D12Resource> pCompacted = DXUtil::createCommittedResource(pDevice, D3D12_HEAP_TYPE_DEFAULT, compactedSize, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+
+	for (size_t i = 0; i < count; ++i) {
+		pCommandList->CopyRaytracingAccelerationStructure(
+			pCompacted->GetGPUVirtualAddress() + compactedOffsets[i],
+			pUncompacted->GetGPUVirtualAddress() + plan.getBuilds()[i].resultOffset,
+			D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_COMPACT);
+	}
+	pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::UAV(pCompacted.Get()));
+
+	executeAndWait(pCommandList);
+
+	result.blasBuffers.resize(count);
+	for (size_t i = 0; i < count; ++i) {
+		result.blasBuffers[i].pResult = pCompacted;
+		result.blasBuffers[i].resultOffset = compactedOffsets[i];
+	}
+
+	result.uncompactedSize = plan.getResultSize();
+	result.compactedSize = compactedSize;
+	result.scratchArenaSize = plan.getScratchArenaSize();
+	result.batchCount = plan.getBatches().size();
+
+	return result;
+}
+
+void Engine::BlasBuilder::executeAndWait(wrl::ComPtr<ID3D12GraphicsCommandList4>& pCommandList)
+{
+	commandQueue.waitForFenceValue(commandQueue.executeCommandList(pCommandList));
+	pCommandList = commandQueue.getCommandList();
+}
@@ -0,0 +1,46 @@
+#pragma once
+#define NOMINMAX
+
+#include <d3d12.h>
+#include <wrl/client.h>
+#include <cstdint>
+#include <vector>
+
+#include "Engine/CommandQueue.h"
+#include "Util/DXUtil.h"
+#include "Util/BlasBuildPlan.h"
+
+namespace Engine {
+	// Builds many bottom level AS at once: one scratch arena per group of builds (see Util::BlasBuildPlan), results packed
+	// into one buffer, then compacted into a second one. Scratch and uncompacted results are gone once build returns.
+	class BlasBuilder {
+	public:
+		// One triangle list of R32G32B32 positions
+		struct Geometry {
+			D3D12_GPU_VIRTUAL_ADDRESS vertexBuffer;
+			UINT vertexCount;
+		};
+
+		struct Result {
+			// pResult is shared, each BLAS starts at its resultOffset
+			std::vector<Util::DXUtil::AccelerationStructureBuffers> blasBuffers;
+			UINT64 uncompactedSize;
+			UINT64 compactedSize;
+			UINT64 scratchArenaSize;
+			std::size_t batchCount;
+		};
+
+		BlasBuilder(Microsoft::WRL::ComPtr<ID3D12Device5> pDevice, CommandQueue& commandQueue, UINT64 scratchBudget = Util::BlasBuildPlan::defaultScratchBudget);
+
+		// Vertex buffers must be in a readable state once pCommandList executes. pCommandList is executed and waited for
+		// (twice, the compacted sizes have to be read back) and is replaced by a fresh one from the command queue.
+		Result build(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4>& pCommandList, const std::vector<Geometry>& geometries, UINT vertexStride);
+
+	private:
+		void executeAndWait(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4>& pCommandList);
+
+		Microsoft::WRL::ComPtr<ID3D12Device5> pDevice;
+		CommandQueue& commandQueue;
+		UINT64 scratchBudget;
+	};
+}
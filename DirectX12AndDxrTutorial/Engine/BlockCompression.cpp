@@ -0,0 +1,466 @@
+#include "BlockCompression.h"
+
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
+
+#include <DirectXMath.h>
+
+using namespace std;
+using namespace DirectX;
+
+namespace {
+	constexpr int texelCount = 16;
+
+	// BC7 interpolation weights for 4 bit indices (out of 64)
+	constexpr int bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// Texels as 0-255 floats. Alpha is zeroed for colour only formats, so it never contributes to errors.
+	void loadTexels(const uint8_t* rgba, bool withAlpha, XMVECTOR* texels)
+	{
+		for (int i = 0; i < texelCount; ++i) {
+			const uint8_t* t = rgba + i * 4;
+			texels[i] = XMVectorSet(t[0], t[1], t[2], withAlpha ? t[3] : 0.f);
+		}
+	}
+
+	inline float getDistanceSq(FXMVECTOR a, FXMVECTOR b)
+	{
+		const XMVECTOR d = XMVectorSubtract(a, b);
+		return XMVectorGetX(XMVector4Dot(d, d));
+	}
+
+	inline XMVECTOR clampTexel(FXMVECTOR v)
+	{
+		return XMVectorClamp(v, XMVectorZero(), XMVectorReplicate(255.f));
+	}
+
+	// Initial endpoints: extremes of the texels projected onto the principal axis (power iteration on the covariance)
+	void getPrincipalEndpoints(const XMVECTOR* texels, XMVECTOR& e0, XMVECTOR& e1)
+	{
+		XMVECTOR mean = XMVectorZero();
+		XMVECTOR minTexel = texels[0];
+		XMVECTOR maxTexel = texels[0];
+		for (int i = 0; i < texelCount; ++i) {
+			mean = XMVectorAdd(mean, texels[i]);
+			minTexel = XMVectorMin(minTexel, texels[i]);
+			maxTexel = XMVectorMax(maxTexel, texels[i]);
+		}
+		mean = XMVectorScale(mean, 1.f / texelCount);
+
+		XMVECTOR covariance[4] = { XMVectorZero(), XMVectorZero(), XMVectorZero(), XMVectorZero() };
+		for (int i = 0; i < texelCount; ++i) {
+			const XMVECTOR d = XMVectorSubtract(texels[i], mean);
+			covariance[0] = XMVectorMultiplyAdd(d, XMVectorSplatX(d), covariance[0]);
+			covariance[1] = XMVectorMultiplyAdd(d, XMVectorSplatY(d), covariance[1]);
+			covariance[2] = XMVectorMultiplyAdd(d, XMVectorSplatZ(d), covariance[2]);
+			covariance[3] = XMVectorMultiplyAdd(d, XMVectorSplatW(d), covariance[3]);
+		}
+
+		// Start along the bounding box diagonal, which is already close for most blocks
+		XMVECTOR axis = XMVectorSubtract(maxTexel, minTexel);
+		for (int iteration = 0; iteration < 8; ++iteration) {
+			XMVECTOR next = XMVectorMultiply(covariance[0], XMVectorSplatX(axis));
+			next = XMVectorMultiplyAdd(covariance[1], XMVectorSplatY(axis), next);
+			next = XMVectorMultiplyAdd(covariance[2], XMVectorSplatZ(axis), next);
+			next = XMVectorMultiplyAdd(covariance[3], XMVectorSplatW(axis), next);
+
+			const float lengthSq = XMVectorGetX(XMVector4Dot(next, next));
+			if (lengthSq < 1e-12f) {
+				break;
+			}
+			axis = XMVectorScale(next, 1.f / sqrt(lengthSq));
+		}
+
+		const float axisLengthSq = XMVectorGetX(XMVector4Dot(axis, axis));
+		if (axisLengthSq < 1e-12f) {
+			// Single colour block
+			e0 = e1 = mean;
+			return;
+		}
+		axis = XMVectorScale(axis, 1.f / sqrt(axisLengthSq));
+
+		float minT = FLT_MAX;
+		float maxT = -FLT_MAX;
+		for (int i = 0; i < texelCount; ++i) {
+			const float t = XMVectorGetX(XMVector4Dot(XMVectorSubtract(texels[i], mean), axis));
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+
+		e0 = clampTexel(XMVectorMultiplyAdd(axis, XMVectorReplicate(minT), mean));
+		e1 = clampTexel(XMVectorMultiplyAdd(axis, XMVectorReplicate(maxT), mean));
+	}
+
+	// Least squares endpoints for fixed per-texel weights of e1 (0-1). Returns false if the system is singular.
+	bool solveEndpoints(const XMVECTOR* texels, const float* weights, XMVECTOR& e0, XMVECTOR& e1)
+	{
+		float aa = 0.f, ab = 0.f, bb = 0.f;
+		XMVECTOR ax = XMVectorZero();
+		XMVECTOR bx = XMVectorZero();
+		for (int i = 0; i < texelCount; ++i) {
+			const float a = 1.f - weights[i];
+			const float b = weights[i];
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			ax = XMVectorMultiplyAdd(texels[i], XMVectorReplicate(a), ax);
+			bx = XMVectorMultiplyAdd(texels[i], XMVectorReplicate(b), bx);
+		}
+
+		const float det = aa * bb - ab * ab;
+		if (fabs(det) < 1e-6f) {
+			return false;
+		}
+
+		const float invDet = 1.f / det;
+		e0 = clampTexel(XMVectorScale(XMVectorSubtract(XMVectorScale(ax, bb), XMVectorScale(bx, ab)), invDet));
+		e1 = clampTexel(XMVectorScale(XMVectorSubtract(XMVectorScale(bx, aa), XMVectorScale(ax, ab)), invDet));
+		return true;
+	}
+
+	// Index of the closest palette entry for every texel, returns the total squared error
+	float selectIndices(const XMVECTOR* texels, const XMVECTOR* palette, int paletteSize, uint8_t* indices)
+	{
+		float totalError = 0.f;
+		for (int i = 0; i < texelCount; ++i) {
+			float bestError = FLT_MAX;
+			for (int j = 0; j < paletteSize; ++j) {
+				const float error = getDistanceSq(texels[i], palette[j]);
+				if (error < bestError) {
+					bestError = error;
+					indices[i] = static_cast<uint8_t>(j);
+				}
+			}
+			totalError += bestError;
+		}
+
+		return totalError;
+	}
+
+	/*******************************************************************
+		BC1
+	*******************************************************************/
+	uint16_t packRgb565(FXMVECTOR colour)
+	{
+		XMFLOAT4 c;
+		XMStoreFloat4(&c, clampTexel(colour));
+		const int r = static_cast<int>(c.x * (31.f / 255.f) + 0.5f);
+		const int g = static_cast<int>(c.y * (63.f / 255.f) + 0.5f);
+		const int b = static_cast<int>(c.z * (31.f / 255.f) + 0.5f);
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void unpackRgb565(uint16_t colour, int* rgb)
+	{
+		const int r = (colour >> 11) & 31;
+		const int g = (colour >> 5) & 63;
+		const int b = colour & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	// Same palette for encoding and decoding, so the encoder's index choice matches what is sampled
+	void getBC1Palette(uint16_t c0, uint16_t c1, int palette[4][4])
+	{
+		unpackRgb565(c0, palette[0]);
+		unpackRgb565(c1, palette[1]);
+		palette[0][3] = palette[1][3] = 255;
+
+		for (int ch = 0; ch < 3; ++ch) {
+			if (c0 > c1) {
+				palette[2][ch] = (2 * palette[0][ch] + palette[1][ch]) / 3;
+				palette[3][ch] = (palette[0][ch] + 2 * palette[1][ch]) / 3;
+			}
+			else {
+				palette[2][ch] = (palette[0][ch] + palette[1][ch]) / 2;
+				palette[3][ch] = 0;
+			}
+		}
+		palette[2][3] = 255;
+		palette[3][3] = c0 > c1 ? 255 : 0;
+	}
+
+	struct BC1Block {
+		uint16_t c0, c1;
+		uint8_t indices[texelCount];
+		float error;
+	};
+
+	void evaluateBC1(const XMVECTOR* texels, FXMVECTOR e0, FXMVECTOR e1, BC1Block& result)
+	{
+		result.c0 = packRgb565(e0);
+		result.c1 = packRgb565(e1);
+
+		// The 4 colour mode requires c0 > c1
+		if (result.c0 < result.c1) {
+			std::swap(result.c0, result.c1);
+		}
+
+		int palette[4][4];
+		getBC1Palette(result.c0, result.c1, palette);
+
+		XMVECTOR paletteTexels[4];
+		for (int i = 0; i < 4; ++i) {
+			paletteTexels[i] = XMVectorSet(static_cast<float>(palette[i][0]), static_cast<float>(palette[i][1]), static_cast<float>(palette[i][2]), 0.f);
+		}
+
+		// Equal endpoints select the 3 colour mode, where index 3 would be transparent black
+		result.error = selectIndices(texels, paletteTexels, result.c0 > result.c1 ? 4 : 3, result.indices);
+	}
+
+	/*******************************************************************
+		BC7
+	*******************************************************************/
+	class BitWriter {
+	public:
+		BitWriter(uint8_t* data) : data(data), position() {}
+
+		void write(uint32_t value, int bitCount) {
+			for (int i = 0; i < bitCount; ++i, ++position) {
+				if ((value >> i) & 1u) {
+					data[position >> 3] |= static_cast<uint8_t>(1u << (position & 7));
+				}
+			}
+		}
+
+	private:
+		uint8_t* data;
+		int position;
+	};
+
+	class BitReader {
+	public:
+		BitReader(const uint8_t* data) : data(data), position() {}
+
+		uint32_t read(int bitCount) {
+			uint32_t value = 0;
+			for (int i = 0; i < bitCount; ++i, ++position) {
+				value |= static_cast<uint32_t>((data[position >> 3] >> (position & 7)) & 1u) << i;
+			}
+			return value;
+		}
+
+	private:
+		const uint8_t* data;
+		int position;
+	};
+
+	// 7 bit endpoint and its p-bit, reconstructed as (value << 1) | pBit
+	struct BC7Endpoint {
+		int values[4];
+		int pBit;
+	};
+
+	BC7Endpoint quantizeBC7Endpoint(FXMVECTOR endpoint)
+	{
+		XMFLOAT4 e;
+		XMStoreFloat4(&e, clampTexel(endpoint));
+		const float channels[4] = { e.x, e.y, e.z, e.w };
+
+		BC7Endpoint best = {};
+		float bestError = FLT_MAX;
+		for (int pBit = 0; pBit < 2; ++pBit) {
+			BC7Endpoint candidate = {};
+			candidate.pBit = pBit;
+
+			float error = 0.f;
+			for (int ch = 0; ch < 4; ++ch) {
+				candidate.values[ch] = std::clamp(static_cast<int>(floor((channels[ch] - pBit) * 0.5f + 0.5f)), 0, 127);
+				const float d = static_cast<float>((candidate.values[ch] << 1) | pBit) - channels[ch];
+				error += d * d;
+			}
+
+			if (error < bestError) {
+				bestError = error;
+				best = candidate;
+			}
+		}
+
+		return best;
+	}
+
+	void getBC7Palette(const BC7Endpoint& e0, const BC7Endpoint& e1, int palette[16][4])
+	{
+		for (int ch = 0; ch < 4; ++ch) {
+			const int a = (e0.values[ch] << 1) | e0.pBit;
+			const int b = (e1.values[ch] << 1) | e1.pBit;
+			for (int i = 0; i < 16; ++i) {
+				palette[i][ch] = ((64 - bc7Weights4[i]) * a + bc7Weights4[i] * b + 32) >> 6;
+			}
+		}
+	}
+
+	struct BC7Block {
+		BC7Endpoint e0, e1;
+		uint8_t indices[texelCount];
+		float error;
+	};
+
+	void evaluateBC7(const XMVECTOR* texels, FXMVECTOR e0, FXMVECTOR e1, BC7Block& result)
+	{
+		result.e0 = quantizeBC7Endpoint(e0);
+		result.e1 = quantizeBC7Endpoint(e1);
+
+		int palette[16][4];
+		getBC7Palette(result.e0, result.e1, palette);
+
+		XMVECTOR paletteTexels[16];
+		for (int i = 0; i < 16; ++i) {
+			paletteTexels[i] = XMVectorSet(static_cast<float>(palette[i][0]), static_cast<float>(palette[i][1]), static_cast<float>(palette[i][2]), static_cast<float>(palette[i][3]));
+		}
+
+		result.error = selectIndices(texels, paletteTexels, 16, result.indices);
+	}
+}
+
+void Engine::BlockCompression::encodeBC1Block(const std::uint8_t* rgba, std::uint8_t* block)
+{
+	XMVECTOR texels[texelCount];
+	loadTexels(rgba, false, texels);
+
+	XMVECTOR e0, e1;
+	getPrincipalEndpoints(texels, e0, e1);
+
+	BC1Block best;
+	evaluateBC1(texels, e0, e1, best);
+
+	// One least squares refinement using the selected indices
+	if (best.c0 > best.c1) {
+		constexpr float indexWeights[4] = { 0.f, 1.f, 1.f / 3.f, 2.f / 3.f };
+		float weights[texelCount];
+		for (int i = 0; i < texelCount; ++i) {
+			weights[i] = indexWeights[best.indices[i]];
+		}
+
+		BC1Block refined;
+		if (solveEndpoints(texels, weights, e0, e1)) {
+			evaluateBC1(texels, e0, e1, refined);
+			if (refined.error < best.error) {
+				best = refined;
+			}
+		}
+	}
+
+	uint32_t indices = 0;
+	for (int i = 0; i < texelCount; ++i) {
+		indices |= static_cast<uint32_t>(best.indices[i]) << (2 * i);
+	}
+
+	block[0] = static_cast<uint8_t>(best.c0);
+	block[1] = static_cast<uint8_t>(best.c0 >> 8);
+	block[2] = static_cast<uint8_t>(best.c1);
+	block[3] = static_cast<uint8_t>(best.c1 >> 8);
+	for (int i = 0; i < 4; ++i) {
+		block[4 + i] = static_cast<uint8_t>(indices >> (8 * i));
+	}
+}
+
+void Engine::BlockCompression::encodeBC7Block(const std::uint8_t* rgba, std::uint8_t* block)
+{
+	XMVECTOR texels[texelCount];
+	loadTexels(rgba, true, texels);
+
+	XMVECTOR e0, e1;
+	getPrincipalEndpoints(texels, e0, e1);
+
+	BC7Block best;
+	evaluateBC7(texels, e0, e1, best);
+
+	// One least squares refinement using the selected indices
+	float weights[texelCount];
+	for (int i = 0; i < texelCount; ++i) {
+		weights[i] = bc7Weights4[best.indices[i]] / 64.f;
+	}
+
+	BC7Block refined;
+	if (solveEndpoints(texels, weights, e0, e1)) {
+		evaluateBC7(texels, e0, e1, refined);
+		if (refined.error < best.error) {
+			best = refined;
+		}
+	}
+
+	// The anchor index (texel 0) is stored without its top bit, swap the endpoints if it is set.
+	// The weights are symmetric, so index i of the swapped palette is 15 - i.
+	if (best.indices[0] & 8) {
+		std::swap(best.e0, best.e1);
+		for (auto& index : best.indices) {
+			index = static_cast<uint8_t>(15 - index);
+		}
+	}
+
+	memset(block, 0, bc7BlockSize);
+	BitWriter writer(block);
+	writer.write(1u << 6, 7); // mode 6
+	for (int ch = 0; ch < 4; ++ch) {
+		writer.write(best.e0.values[ch], 7);
+		writer.write(best.e1.values[ch], 7);
+	}
+	writer.write(best.e0.pBit, 1);
+	writer.write(best.e1.pBit, 1);
+
+	writer.write(best.indices[0], 3);
+	for (int i = 1; i < texelCount; ++i) {
+		writer.write(best.indices[i], 4);
+	}
+}
+
+void Engine::BlockCompression::decodeBC1Block(const std::uint8_t* block, std::uint8_t* rgba)
+{
+	const uint16_t c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+	const uint16_t c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+	const uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+
+	int palette[4][4];
+	getBC1Palette(c0, c1, palette);
+
+	for (int i = 0; i < texelCount; ++i) {
+		const int* colour = palette[(indices >> (2 * i)) & 3];
+		for (int ch = 0; ch < 4; ++ch) {
+			rgba[i * 4 + ch] = static_cast<uint8_t>(colour[ch]);
+		}
+	}
+}
+
+void Engine::BlockCompression::decodeBC7Block(const std::uint8_t* block, std::uint8_t* rgba)
+{
+	if ((block[0] & 0x7f) != (1 << 6)) {
+		memset(rgba, 0, texelCount * 4);
+		return;
+	}
+
+	BitReader reader(block);
+	reader.read(7);
+
+	BC7Endpoint e0 = {}, e1 = {};
+	for (int ch = 0; ch < 4; ++ch) {
+		e0.values[ch] = static_cast<int>(reader.read(7));
+		e1.values[ch] = static_cast<int>(reader.read(7));
+	}
+	e0.pBit = static_cast<int>(reader.read(1));
+	e1.pBit = static_cast<int>(reader.read(1));
+
+	int palette[16][4];
+	getBC7Palette(e0, e1, palette);
+
+	for (int i = 0; i < texelCount; ++i) {
+		const int* colour = palette[reader.read(i == 0 ? 3 : 4)];
+		for (int ch = 0; ch < 4; ++ch) {
+			rgba[i * 4 + ch] = static_cast<uint8_t>(colour[ch]);
+		}
+	}
+}
+
+void Engine::BlockCompression::extractBlock(const std::uint8_t* image, int width, int height, int blockX, int blockY, std::uint8_t* rgba)
+{
+	for (int y = 0; y < blockDimension; ++y) {
+		const int sourceY = std::min(blockY * blockDimension + y, height - 1);
+		for (int x = 0; x < blockDimension; ++x) {
+			const int sourceX = std::min(blockX * blockDimension + x, width - 1);
+			memcpy(rgba + (y * blockDimension + x) * 4, image + (static_cast<size_t>(sourceY) * width + sourceX) * 4, 4);
+		}
+	}
+}
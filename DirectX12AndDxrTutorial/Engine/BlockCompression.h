@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Engine {
+	// BC1 and BC7 block encoders/decoders.
+	// A block is 4x4 texels of 8 bit RGBA, stored row by row (64 bytes).
+	class BlockCompression {
+	public:
+		static constexpr int blockDimension = 4;
+		static constexpr int bc1BlockSize = 8;
+		static constexpr int bc7BlockSize = 16;
+
+		// Opaque colour only, alpha is ignored (4 colour mode)
+		static void encodeBC1Block(const std::uint8_t* rgba, std::uint8_t* block);
+		// Uses mode 6 (single subset, RGBA endpoints with p-bits, 4 bit indices)
+		static void encodeBC7Block(const std::uint8_t* rgba, std::uint8_t* block);
+
+		// Handles both the 4 colour and the 3 colour + transparent modes
+		static void decodeBC1Block(const std::uint8_t* block, std::uint8_t* rgba);
+		// Only mode 6 blocks (as written by encodeBC7Block) are supported, other modes decode to transparent black
+		static void decodeBC7Block(const std::uint8_t* block, std::uint8_t* rgba);
+
+		// Copies the 4x4 block at (blockX, blockY) out of an RGBA8 image, edge texels are repeated for partial blocks
+		static void extractBlock(const std::uint8_t* image, int width, int height, int blockX, int blockY, std::uint8_t* rgba);
+	};
+}
@@ -107,6 +107,16 @@ bool Engine::CommandQueue::isFenceComplete(std::uint64_t fenceValue)
 	return pFence->GetCompletedValue() >= fenceValue;
 }
 
+std::uint64_t Engine::CommandQueue::getCompletedFenceValue() const
+{
+	return pFence->GetCompletedValue();
+}
+
+std::uint64_t Engine::CommandQueue::getLastSignaledFenceValue() const
+{
+	return fenceValue;
+}
+
 void Engine::CommandQueue::waitForFenceValue(std::uint64_t fenceValue)
 {
 	if (!isFenceComplete(fenceValue)) {
@@ -115,6 +125,12 @@ void Engine::CommandQueue::waitForFenceValue(std::uint64_t fenceValue)
 	}
 }
 
+void Engine::CommandQueue::waitForQueue(const CommandQueue& producer, std::uint64_t fenceValue)
+{
+	HRESULT hr;
+	GFXTHROWIFFAILED(pCommandQueue->Wait(producer.pFence.Get(), fenceValue));
+}
+
 void Engine::CommandQueue::flush()
 {
 	auto fV = signal();
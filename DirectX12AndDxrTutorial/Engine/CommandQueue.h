@@ -22,7 +22,12 @@ namespace Engine {
 		std::uint64_t executeCommandList(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> commandList);
 		std::uint64_t signal();
 		bool isFenceComplete(std::uint64_t fenceValue);
+		std::uint64_t getCompletedFenceValue() const;
+		// Value of the most recent signal, reached once all work submitted so far is done
+		std::uint64_t getLastSignaledFenceValue() const;
 		void waitForFenceValue(std::uint64_t fenceValue);
+		// GPU side wait, work submitted to this queue afterwards starts once producer reaches fenceValue
+		void waitForQueue(const CommandQueue& producer, std::uint64_t fenceValue);
 		void flush();
 
 		static void waitForEvent(HANDLE handleEvent);
@@ -0,0 +1,45 @@
+#include "FrameConstantBuffer.h"
+
+#include <cstring>
+
+#include "Util/DXUtil.h"
+#include "Exception/WindowException.h"
+
+namespace wrl = Microsoft::WRL;
+
+using namespace std;
+using namespace Util;
+
+Engine::FrameConstantBuffer::FrameConstantBuffer(wrl::ComPtr<ID3D12Device5> pDevice, CommandQueue& commandQueue, UINT64 size, UINT slotCount)
+	: commandQueue(commandQueue), pMappedData(), size(size), slots(slotCount)
+{
+	HRESULT hr;
+
+	// Constant buffer views have to start on a 256 byte boundary
+	slotSize = (size + D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1) & ~static_cast<UINT64>(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1);
+	pBuffer = DXUtil::createCommittedResource(pDevice, D3D12_HEAP_TYPE_UPLOAD, slotSize * slotCount, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+	const D3D12_RANGE readRange = { 0, 0 };
+	GFXTHROWIFFAILED(pBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pMappedData)));
+}
+
+Engine::FrameConstantBuffer::~FrameConstantBuffer()
+{
+	pBuffer->Unmap(0, nullptr);
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS Engine::FrameConstantBuffer::write(const void* ptData)
+{
+	// Normally long done, the swap chain already throttles the CPU to the frames in flight
+	commandQueue.waitForFenceValue(slots.advance());
+
+	const UINT64 offset = slotSize * slots.getCurrentSlot();
+	memcpy(pMappedData + offset, ptData, size);
+
+	return pBuffer->GetGPUVirtualAddress() + offset;
+}
+
+void Engine::FrameConstantBuffer::finishFrame(std::uint64_t fenceValue)
+{
+	slots.finishFrame(fenceValue);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#define NOMINMAX
+
+#include <d3d12.h>
+#include <wrl/client.h>
+#include <cstdint>
+
+#include "Engine/CommandQueue.h"
+#include "Util/FrameSlotRing.h"
+
+namespace Engine {
+	// Persistently mapped upload heap constant buffer with one copy per frame in flight. The CPU writes the frame's
+	// constants straight into the next free copy, which is bound by its GPU address (a root CBV), so there is no copy
+	// into a default heap and no barrier.
+	class FrameConstantBuffer {
+	public:
+		FrameConstantBuffer(Microsoft::WRL::ComPtr<ID3D12Device5> pDevice, CommandQueue& commandQueue, UINT64 size, UINT slotCount);
+		FrameConstantBuffer(const FrameConstantBuffer&) = delete;
+		FrameConstantBuffer& operator=(const FrameConstantBuffer&) = delete;
+		virtual ~FrameConstantBuffer();
+
+		// Copies size bytes into the next copy, waiting for the GPU if it is still reading it. Returns its address.
+		D3D12_GPU_VIRTUAL_ADDRESS write(const void* ptData);
+		// Call once the command list that reads the last write has been executed, with the fence value it signalled
+		void finishFrame(std::uint64_t fenceValue);
+
+	private:
+		CommandQueue& commandQueue;
+		Microsoft::WRL::ComPtr<ID3D12Resource> pBuffer;
+		std::uint8_t* pMappedData;
+		UINT64 size;
+		UINT64 slotSize;
+		Util::FrameSlotRing slots;
+	};
+}
@@ -0,0 +1,86 @@
+#include "GpuDescriptorHeap.h"
+
+#include <string>
+
+#include "Util/DXUtil.h"
+#include "Exception/Exception.h"
+
+namespace wrl = Microsoft::WRL;
+
+using namespace std;
+using namespace Util;
+
+Engine::GpuDescriptorHeap::GpuDescriptorHeap(wrl::ComPtr<ID3D12Device5> pDevice, CommandQueue& commandQueue, UINT persistentCount, UINT frameCount, UINT slotCount)
+	: commandQueue(commandQueue), allocator(persistentCount, frameCount, slotCount)
+{
+	pDescriptorHeap = DXUtil::createDescriptorHeap(pDevice, allocator.getCapacity(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, true);
+	descriptorSize = pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+Engine::GpuDescriptorHeap::Handle Engine::GpuDescriptorHeap::allocate(UINT count)
+{
+	// Frees of completed frames may have come in since the last beginFrame
+	allocator.release(commandQueue.getCompletedFenceValue());
+
+	const Handle handle = allocator.allocate(count);
+	if (handle.index == DescriptorAllocator::invalidIndex) {
+		ThrowException("No room for " + to_string(count) + " descriptors in the shader visible heap");
+	}
+
+	return handle;
+}
+
+void Engine::GpuDescriptorHeap::free(const Handle& handle)
+{
+	allocator.free(handle);
+}
+
+bool Engine::GpuDescriptorHeap::isValid(const Handle& handle) const
+{
+	return allocator.isValid(handle);
+}
+
+void Engine::GpuDescriptorHeap::beginFrame()
+{
+	commandQueue.waitForFenceValue(allocator.beginFrame());
+	allocator.release(commandQueue.getCompletedFenceValue());
+}
+
+UINT Engine::GpuDescriptorHeap::allocateTemporary(UINT count)
+{
+	const UINT index = allocator.allocateTemporary(count);
+	if (index == DescriptorAllocator::invalidIndex) {
+		ThrowException("No room for " + to_string(count) + " temporary descriptors in this frame");
+	}
+
+	return index;
+}
+
+void Engine::GpuDescriptorHeap::finishFrame(std::uint64_t fenceValue)
+{
+	allocator.finishFrame(fenceValue);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE Engine::GpuDescriptorHeap::getCpuHandle(UINT index) const
+{
+	D3D12_CPU_DESCRIPTOR_HANDLE handle = pDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+	handle.ptr += static_cast<SIZE_T>(index) * descriptorSize;
+	return handle;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE Engine::GpuDescriptorHeap::getGpuHandle(UINT index) const
+{
+	D3D12_GPU_DESCRIPTOR_HANDLE handle = pDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+	handle.ptr += static_cast<UINT64>(index) * descriptorSize;
+	return handle;
+}
+
+wrl::ComPtr<ID3D12DescriptorHeap> Engine::GpuDescriptorHeap::getDescriptorHeap() const
+{
+	return pDescriptorHeap;
+}
+
+const Util::DescriptorAllocator& Engine::GpuDescriptorHeap::getAllocator() const
+{
+	return allocator;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#define NOMINMAX
+
+#include <d3d12.h>
+#include <wrl/client.h>
+#include <cstdint>
+
+#include "Engine/CommandQueue.h"
+#include "Util/DescriptorAllocator.h"
+
+namespace Engine {
+	// The shader visible CBV/SRV/UAV heap of the frame, split by a Util::DescriptorAllocator. Descriptor tables and
+	// single descriptors (ex. ImGui's font) are allocated from it as they are needed, so everything stays bound with
+	// one SetDescriptorHeaps call.
+	class GpuDescriptorHeap {
+	public:
+		using Handle = Util::DescriptorAllocator::Handle;
+
+		GpuDescriptorHeap(Microsoft::WRL::ComPtr<ID3D12Device5> pDevice, CommandQueue& commandQueue, UINT persistentCount, UINT frameCount, UINT slotCount);
+		GpuDescriptorHeap(const GpuDescriptorHeap&) = delete;
+		GpuDescriptorHeap& operator=(const GpuDescriptorHeap&) = delete;
+
+		// Throws if the heap is full
+		Handle allocate(UINT count);
+		// The descriptors are reused once the frame recorded at the time has completed
+		void free(const Handle& handle);
+		bool isValid(const Handle& handle) const;
+
+		// Call at the start of the frame, waits for the GPU if the frame region is still in use
+		void beginFrame();
+		// Valid until the frame completes, throws if the frame region is full
+		UINT allocateTemporary(UINT count);
+		void finishFrame(std::uint64_t fenceValue);
+
+		D3D12_CPU_DESCRIPTOR_HANDLE getCpuHandle(UINT index) const;
+		D3D12_GPU_DESCRIPTOR_HANDLE getGpuHandle(UINT index) const;
+		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> getDescriptorHeap() const;
+		const Util::DescriptorAllocator& getAllocator() const;
+
+	private:
+		CommandQueue& commandQueue;
+		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> pDescriptorHeap;
+		UINT descriptorSize;
+		Util::DescriptorAllocator allocator;
+	};
+}
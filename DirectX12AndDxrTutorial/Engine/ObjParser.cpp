@@ -0,0 +1,545 @@
+#include "ObjParser.h"
+
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <limits>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+#include <unordered_map>
+
+#include "Exception/Exception.h"
+#include "Util/MappedFile.h"
+
+using namespace std;
+using namespace Engine;
+
+namespace {
+	enum FaceVertexFlags : std::uint8_t {
+		RelativeVertex = 1 << 0,
+		HasTexcoord = 1 << 1,
+		RelativeTexcoord = 1 << 2
+	};
+
+	constexpr size_t minChunkSize = 1 << 20;
+
+	inline bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	inline const char* skipSpaces(const char* p, const char* end)
+	{
+		while (p < end && isSpace(*p)) {
+			++p;
+		}
+		return p;
+	}
+
+	// Rest of the line with surrounding whitespace removed
+	string getArgument(const char* p, const char* end)
+	{
+		p = skipSpaces(p, end);
+		return string(p, end);
+	}
+
+	// Same as tinyobj, multiple group names are joined by a single space
+	string getGroupName(const char* p, const char* end)
+	{
+		string name;
+		while ((p = skipSpaces(p, end)) < end) {
+			const char* tokenEnd = find_if(p, end, isSpace);
+			if (!name.empty()) {
+				name += ' ';
+			}
+			name.append(p, tokenEnd);
+			p = tokenEnd;
+		}
+		return name;
+	}
+
+	// Exactly representable powers of ten
+	constexpr double exactPowersOfTen[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+}
+
+ObjData Engine::ObjParser::parse(const std::string& pathToObj, Util::ThreadPool& threadPool)
+{
+	Util::MappedFile file(pathToObj);
+	const char* const data = reinterpret_cast<const char*>(file.getData());
+	const size_t size = file.getSize();
+	const char* const dataEnd = data + size;
+
+	// Split file in chunks, each ending on a line boundary
+	const size_t chunkCount = std::clamp<size_t>(size / minChunkSize, 1, threadPool.getThreadCount() * 4);
+	vector<pair<const char*, const char*>> ranges;
+	const char* chunkBegin = data;
+	for (size_t i = 1; i <= chunkCount && chunkBegin < dataEnd; ++i) {
+		const char* chunkEnd = i == chunkCount ? dataEnd : std::max(chunkBegin, data + size / chunkCount * i);
+		chunkEnd = find(chunkEnd, dataEnd, '\n');
+		if (chunkEnd != dataEnd) {
+			++chunkEnd;
+		}
+
+		ranges.emplace_back(chunkBegin, chunkEnd);
+		chunkBegin = chunkEnd;
+	}
+
+	vector<Chunk> chunks(ranges.size());
+	threadPool.parallelFor(chunks.size(), [&](size_t i) {
+		parseChunk(ranges[i].first, ranges[i].second, chunks[i]);
+	});
+
+	ObjData objData;
+
+	// Materials
+	const string baseDirectory = filesystem::path(pathToObj).parent_path().string();
+	unordered_map<string, int> materialMap;
+	vector<string> loadedLibraries;
+	for (const auto& chunk : chunks) {
+		for (const auto& library : chunk.materialLibraries) {
+			if (find(loadedLibraries.begin(), loadedLibraries.end(), library) != loadedLibraries.end()) {
+				continue;
+			}
+			loadedLibraries.push_back(library);
+
+			const string pathToMtl = baseDirectory.empty() ? library : (filesystem::path(baseDirectory) / library).string();
+			objData.materialLibraries.push_back(pathToMtl);
+			for (auto& material : parseMaterialLibrary(pathToMtl)) {
+				materialMap.emplace(material.name, static_cast<int>(objData.materials.size()));
+				objData.materials.push_back(move(material));
+			}
+		}
+	}
+
+	// Starting offsets of each chunk's data in the merged arrays
+	vector<size_t> vertexBase(chunks.size() + 1), texcoordBase(chunks.size() + 1), faceBase(chunks.size() + 1);
+	vector<int> incomingMaterialIds(chunks.size());
+	int currentMaterialId = -1;
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		const auto& chunk = chunks[i];
+		vertexBase[i + 1] = vertexBase[i] + chunk.vertices.size() / 3;
+		texcoordBase[i + 1] = texcoordBase[i] + chunk.texcoords.size() / 2;
+		faceBase[i + 1] = faceBase[i] + chunk.faceMaterialSlots.size();
+
+		incomingMaterialIds[i] = currentMaterialId;
+		if (chunk.finalMaterialSlot >= 0) {
+			const auto it = materialMap.find(chunk.usedMaterials[chunk.finalMaterialSlot]);
+			currentMaterialId = it != materialMap.end() ? it->second : -1;
+		}
+	}
+
+	const size_t vertexCount = vertexBase.back();
+	const size_t texcoordCount = texcoordBase.back();
+	objData.vertices.resize(vertexCount * 3);
+	objData.texcoords.resize(texcoordCount * 2);
+	objData.indices.resize(faceBase.back() * 3);
+	objData.materialIds.resize(faceBase.back());
+
+	// Merge chunks
+	threadPool.parallelFor(chunks.size(), [&](size_t i) {
+		const auto& chunk = chunks[i];
+
+		copy(chunk.vertices.begin(), chunk.vertices.end(), objData.vertices.begin() + vertexBase[i] * 3);
+		copy(chunk.texcoords.begin(), chunk.texcoords.end(), objData.texcoords.begin() + texcoordBase[i] * 2);
+
+		ObjIndex* indices = objData.indices.data() + faceBase[i] * 3;
+		for (const auto& faceVertex : chunk.faceVertices) {
+			const long long vertexIndex = (faceVertex.flags & RelativeVertex) ? static_cast<long long>(vertexBase[i]) + faceVertex.vertexIndex : faceVertex.vertexIndex;
+			if (vertexIndex < 0 || vertexIndex >= static_cast<long long>(vertexCount)) {
+				ThrowException("Vertex index out of range in " + pathToObj);
+			}
+
+			long long texcoordIndex = -1;
+			if (faceVertex.flags & HasTexcoord) {
+				texcoordIndex = (faceVertex.flags & RelativeTexcoord) ? static_cast<long long>(texcoordBase[i]) + faceVertex.texcoordIndex : faceVertex.texcoordIndex;
+				if (texcoordIndex < 0 || texcoordIndex >= static_cast<long long>(texcoordCount)) {
+					ThrowException("Texture vertex index out of range in " + pathToObj);
+				}
+			}
+
+			*indices++ = { static_cast<int>(vertexIndex), static_cast<int>(texcoordIndex) };
+		}
+
+		vector<int> slotMaterialIds;
+		for (const auto& materialName : chunk.usedMaterials) {
+			const auto it = materialMap.find(materialName);
+			slotMaterialIds.push_back(it != materialMap.end() ? it->second : -1);
+		}
+
+		int* materialIds = objData.materialIds.data() + faceBase[i];
+		for (const int slot : chunk.faceMaterialSlots) {
+			*materialIds++ = slot >= 0 ? slotMaterialIds[slot] : incomingMaterialIds[i];
+		}
+	});
+
+	// Shapes - empty groups are dropped, as in tinyobj
+	ObjShape currentShape = {};
+	auto closeShape = [&objData, &currentShape](size_t faceIndex) {
+		currentShape.faceCount = faceIndex - currentShape.faceOffset;
+		if (currentShape.faceCount > 0) {
+			objData.shapes.push_back(currentShape);
+		}
+	};
+
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		for (const auto& groupEvent : chunks[i].groupEvents) {
+			const size_t faceIndex = faceBase[i] + groupEvent.faceIndex;
+			closeShape(faceIndex);
+			currentShape = { groupEvent.name, faceIndex, 0 };
+		}
+	}
+	closeShape(faceBase.back());
+
+	return objData;
+}
+
+void Engine::ObjParser::parseChunk(const char* begin, const char* end, Chunk& chunk)
+{
+	unordered_map<string, int> materialSlots;
+	int currentMaterialSlot = -1;
+
+	const char* p = begin;
+	while (p < end) {
+		const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+		if (lineEnd == nullptr) {
+			lineEnd = end;
+		}
+
+		// Trim line
+		const char* lineStart = skipSpaces(p, lineEnd);
+		const char* e = lineEnd;
+		while (e > lineStart && (isSpace(e[-1]) || e[-1] == '\r')) {
+			--e;
+		}
+
+		p = lineEnd + 1;
+
+		if (lineStart == e) {
+			continue;
+		}
+
+		const char* token = lineStart;
+		const size_t length = e - token;
+
+		switch (token[0]) {
+			case 'v':
+				if (length > 1 && isSpace(token[1])) {
+					float v[3] = {};
+					const char* q = token + 1;
+					for (float& f : v) {
+						q = parseFloat(skipSpaces(q, e), e, f);
+					}
+					chunk.vertices.insert(chunk.vertices.end(), std::begin(v), std::end(v));
+				}
+				else if (length > 2 && token[1] == 't' && isSpace(token[2])) {
+					float vt[2] = {};
+					const char* q = token + 2;
+					for (float& f : vt) {
+						q = parseFloat(skipSpaces(q, e), e, f);
+					}
+					chunk.texcoords.insert(chunk.texcoords.end(), std::begin(vt), std::end(vt));
+				}
+				break;
+			case 'f':
+				if (length > 1 && isSpace(token[1])) {
+					parseFace(token + 1, e, chunk, currentMaterialSlot);
+				}
+				break;
+			case 'o':
+			case 'g':
+				if (length == 1 || isSpace(token[1])) {
+					const size_t faceIndex = chunk.faceMaterialSlots.size();
+					chunk.groupEvents.push_back({ faceIndex, token[0] == 'o' ? getArgument(token + 1, e) : getGroupName(token + 1, e) });
+				}
+				break;
+			case 'u':
+				if (length > 6 && strncmp(token, "usemtl", 6) == 0 && isSpace(token[6])) {
+					const string materialName = getArgument(token + 6, e);
+					const auto it = materialSlots.find(materialName);
+					if (it != materialSlots.end()) {
+						currentMaterialSlot = it->second;
+					}
+					else {
+						currentMaterialSlot = static_cast<int>(chunk.usedMaterials.size());
+						materialSlots.emplace(materialName, currentMaterialSlot);
+						chunk.usedMaterials.push_back(materialName);
+					}
+					chunk.finalMaterialSlot = currentMaterialSlot;
+				}
+				break;
+			case 'm':
+				if (length > 6 && strncmp(token, "mtllib", 6) == 0 && isSpace(token[6])) {
+					istringstream ss(string(token + 6, e));
+					copy(istream_iterator<string>(ss), istream_iterator<string>(), back_inserter(chunk.materialLibraries));
+				}
+				break;
+		}
+	}
+}
+
+void Engine::ObjParser::parseFace(const char* p, const char* end, Chunk& chunk, int currentMaterialSlot)
+{
+	const int localVertexCount = static_cast<int>(chunk.vertices.size() / 3);
+	const int localTexcoordCount = static_cast<int>(chunk.texcoords.size() / 2);
+
+	FaceVertex polygon[16];
+	vector<FaceVertex> largePolygon;
+	size_t polygonSize = 0;
+
+	const char* const start = p;
+	auto invalidFace = [start, end]() {
+		ThrowException("Invalid face: f" + string(start, end));
+	};
+
+	while ((p = skipSpaces(p, end)) < end) {
+		// Trailing comment
+		if (*p == '#') {
+			break;
+		}
+
+		FaceVertex faceVertex = {};
+		int index = 0;
+
+		// v, v/vt, v//vn, v/vt/vn (indices are 1 based, negative ones are relative to the end)
+		const char* q = parseInt(p, end, index);
+		if (q == p || index == 0) {
+			invalidFace();
+		}
+		p = q;
+
+		if (index > 0) {
+			faceVertex.vertexIndex = index - 1;
+		}
+		else {
+			faceVertex.vertexIndex = localVertexCount + index;
+			faceVertex.flags |= RelativeVertex;
+		}
+
+		if (p < end && *p == '/') {
+			++p;
+			if (p < end && *p != '/' && !isSpace(*p)) {
+				q = parseInt(p, end, index);
+				if (q == p || index == 0) {
+					invalidFace();
+				}
+				p = q;
+
+				faceVertex.flags |= HasTexcoord;
+				if (index > 0) {
+					faceVertex.texcoordIndex = index - 1;
+				}
+				else {
+					faceVertex.texcoordIndex = localTexcoordCount + index;
+					faceVertex.flags |= RelativeTexcoord;
+				}
+			}
+
+			// Normals are not used
+			p = find_if(p, end, isSpace);
+		}
+		else if (p < end && !isSpace(*p)) {
+			invalidFace();
+		}
+
+		if (polygonSize < size(polygon)) {
+			polygon[polygonSize] = faceVertex;
+		}
+		else {
+			if (largePolygon.empty()) {
+				largePolygon.assign(std::begin(polygon), std::end(polygon));
+			}
+			largePolygon.push_back(faceVertex);
+		}
+		++polygonSize;
+	}
+
+	const FaceVertex* faceVertices = largePolygon.empty() ? polygon : largePolygon.data();
+
+	// Fan triangulation
+	for (size_t i = 2; i < polygonSize; ++i) {
+		chunk.faceVertices.push_back(faceVertices[0]);
+		chunk.faceVertices.push_back(faceVertices[i - 1]);
+		chunk.faceVertices.push_back(faceVertices[i]);
+		chunk.faceMaterialSlots.push_back(currentMaterialSlot);
+	}
+}
+
+std::vector<ObjMaterial> Engine::ObjParser::parseMaterialLibrary(const std::string& pathToMtl)
+{
+	vector<ObjMaterial> materials;
+
+	ifstream file(pathToMtl, ios::binary);
+	if (!file) {
+		return materials;
+	}
+
+	const string contents((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+	const char* p = contents.data();
+	const char* const end = p + contents.size();
+
+	auto parseColour = [](const char* p, const char* e, float (&colour)[3]) {
+		for (float& f : colour) {
+			p = parseFloat(skipSpaces(p, e), e, f);
+		}
+	};
+
+	while (p < end) {
+		const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+		if (lineEnd == nullptr) {
+			lineEnd = end;
+		}
+
+		const char* token = skipSpaces(p, lineEnd);
+		const char* e = lineEnd;
+		while (e > token && (isSpace(e[-1]) || e[-1] == '\r')) {
+			--e;
+		}
+
+		p = lineEnd + 1;
+
+		const char* tokenEnd = find_if(token, e, isSpace);
+		const string keyword(token, tokenEnd);
+
+		if (keyword == "newmtl") {
+			materials.push_back({ getArgument(tokenEnd, e), { 0.f, 0.f, 0.f }, { 0.f, 0.f, 0.f }, "" });
+		}
+		else if (materials.empty()) {
+			continue;
+		}
+		else if (keyword == "Kd") {
+			parseColour(tokenEnd, e, materials.back().diffuse);
+		}
+		else if (keyword == "Ke") {
+			parseColour(tokenEnd, e, materials.back().emission);
+		}
+		else if (keyword == "map_Kd") {
+			// Texture options (ex. -bm 1) precede the file name
+			const char* nameStart = e;
+			while (nameStart > tokenEnd && !isSpace(nameStart[-1])) {
+				--nameStart;
+			}
+			materials.back().diffuseTextureName = string(nameStart, e);
+		}
+	}
+
+	return materials;
+}
+
+const char* Engine::ObjParser::parseFloat(const char* p, const char* end, float& value)
+{
+	const char* const start = p;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p++ == '-';
+	}
+
+	// Mantissa, keeping up to 19 significant digits
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	int digits = 0;
+	bool anyDigits = false;
+
+	for (; p < end && *p >= '0' && *p <= '9'; ++p, anyDigits = true) {
+		if (digits < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			digits += mantissa != 0;
+		}
+		else {
+			++exponent;
+		}
+	}
+
+	if (p < end && *p == '.') {
+		for (++p; p < end && *p >= '0' && *p <= '9'; ++p, anyDigits = true) {
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += mantissa != 0;
+				--exponent;
+			}
+		}
+	}
+
+	if (!anyDigits) {
+		// Not a plain decimal number (ex. nan, inf), leave it to the standard library
+		char buffer[64];
+		const size_t length = std::min<size_t>(find_if(start, end, isSpace) - start, sizeof(buffer) - 1);
+		memcpy(buffer, start, length);
+		buffer[length] = '\0';
+
+		char* parsedEnd;
+		value = strtof(buffer, &parsedEnd);
+		return start + (parsedEnd - buffer);
+	}
+
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		const char* exponentStart = p++;
+		int explicitExponent = 0;
+		bool negativeExponent = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negativeExponent = *p++ == '-';
+		}
+
+		if (p < end && *p >= '0' && *p <= '9') {
+			for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+				explicitExponent = std::min(explicitExponent * 10 + (*p - '0'), 10000);
+			}
+			exponent += negativeExponent ? -explicitExponent : explicitExponent;
+		}
+		else {
+			p = exponentStart;
+		}
+	}
+
+	// Fast path - both mantissa and power of ten are exact doubles, so a single rounding happens
+	double result = static_cast<double>(mantissa);
+	if (mantissa == 0) {
+		result = 0.0;
+	}
+	else if (exponent < 0 && -exponent < static_cast<int>(size(exactPowersOfTen))) {
+		result /= exactPowersOfTen[-exponent];
+	}
+	else if (exponent >= 0 && exponent < static_cast<int>(size(exactPowersOfTen))) {
+		result *= exactPowersOfTen[exponent];
+	}
+	else {
+		result *= pow(10.0, exponent);
+	}
+
+	value = static_cast<float>(negative ? -result : result);
+	return p;
+}
+
+const char* Engine::ObjParser::parseInt(const char* p, const char* end, int& value)
+{
+	const char* const start = p;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = *p++ == '-';
+	}
+
+	// Accumulated wider than int, so a long run of digits can't overflow before it is rejected
+	const char* const digits = p;
+	int64_t result = 0;
+	for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+		result = result * 10 + (*p - '0');
+		if (result > static_cast<int64_t>(numeric_limits<int>::max()) + (negative ? 1 : 0)) {
+			return start;
+		}
+	}
+
+	if (p == digits) {
+		return start;
+	}
+
+	value = static_cast<int>(negative ? -result : result);
+	return p;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Util/ThreadPool.h"
+
+namespace Engine {
+	struct ObjMaterial {
+		std::string name;
+		float diffuse[3];
+		float emission[3];
+		std::string diffuseTextureName;
+	};
+
+	// Zero based indices into ObjData::vertices/texcoords, texcoordIndex is -1 if not present
+	struct ObjIndex {
+		int vertexIndex;
+		int texcoordIndex;
+	};
+
+	// A run of consecutive faces, started by an 'o' or 'g' record
+	struct ObjShape {
+		std::string name;
+		std::size_t faceOffset;
+		std::size_t faceCount;
+	};
+
+	struct ObjData {
+		std::vector<float> vertices;  // xyz per vertex
+		std::vector<float> texcoords; // uv per texture vertex
+		std::vector<ObjIndex> indices; // 3 per face (polygons are triangulated as fans)
+		std::vector<int> materialIds;  // 1 per face, -1 if not found
+		std::vector<ObjShape> shapes;
+		std::vector<ObjMaterial> materials;
+		std::vector<std::string> materialLibraries; // paths of the MTL files that were read
+	};
+
+	// Multithreaded OBJ/MTL parser.
+	// The memory mapped OBJ is split at line boundaries, each chunk is parsed on its own and the
+	// chunk results are then stitched together in file order (resolving relative indices and materials).
+	class ObjParser {
+	public:
+		static ObjData parse(const std::string& pathToObj, Util::ThreadPool& threadPool = Util::ThreadPool::getDefault());
+
+	private:
+		struct FaceVertex {
+			int vertexIndex;
+			int texcoordIndex;
+			std::uint8_t flags;
+		};
+
+		struct GroupEvent {
+			std::size_t faceIndex;
+			std::string name;
+		};
+
+		struct Chunk {
+			std::vector<float> vertices;
+			std::vector<float> texcoords;
+			std::vector<FaceVertex> faceVertices; // 3 per face
+			std::vector<int> faceMaterialSlots;   // index into usedMaterials, -1 continues the previous chunk's material
+			std::vector<std::string> usedMaterials;
+			int finalMaterialSlot = -1;           // material active at the end of the chunk
+			std::vector<GroupEvent> groupEvents;
+			std::vector<std::string> materialLibraries;
+		};
+
+		static void parseChunk(const char* begin, const char* end, Chunk& chunk);
+		static void parseFace(const char* p, const char* end, Chunk& chunk, int currentMaterialSlot);
+		static std::vector<ObjMaterial> parseMaterialLibrary(const std::string& pathToMtl);
+
+		static const char* parseFloat(const char* p, const char* end, float& value);
+		// Returns p (and leaves value unchanged) if there are no digits or the number doesn't fit an int
+		static const char* parseInt(const char* p, const char* end, int& value);
+	};
+}
@@ -2,6 +2,7 @@
 
 #include "../Util/DXUtil.h"
 
+#include <cmath>
 #include <chrono>
 #include <array>
 #include <limits>
@@ -34,7 +35,7 @@ using namespace Util;
 using namespace Engine;
 
 RTGraphics::RTGraphics(HWND hWnd)
-	: winWidth(), winHeight(), pRTVDescriptorSize(), pCurrentBackBufferIndex(), frameFenceValues{},
+	: winWidth(), winHeight(), pRTVDescriptorSize(), pCurrentBackBufferIndex(), frameNumber(), lastFrameTimeMs(), blasUncompactedSize(), blasCompactedSize(), backBufferHandle(), frameConstantsAddress(), frameFenceValues{},
 	scissorRect(CD3DX12_RECT(0, 0, LONG_MAX, LONG_MAX)), viewport()
 {
 	RECT rect;
@@ -58,8 +59,16 @@ RTGraphics::RTGraphics(HWND hWnd)
 	// Enable debug messages in debug mode
 	DXUtil::setupDebugLayer(pDevice);
 
+	// Place buffers and textures in a few large heaps
+	memoryAllocator = make_unique<GpuMemoryAllocator>(pDevice);
+	DXUtil::setMemoryAllocator(memoryAllocator.get());
+
 	// Create command queue
 	pCommandQueue = make_unique<CommandQueue>(pDevice, D3D12_COMMAND_LIST_TYPE_DIRECT);
+	pCopyQueue = make_unique<CommandQueue>(pDevice, D3D12_COMMAND_LIST_TYPE_COPY);
+	uploadRingBuffer = make_unique<UploadRingBuffer>(pDevice, *pCommandQueue);
+	frameConstants = make_unique<FrameConstantBuffer>(pDevice, *pCommandQueue, sizeof(Shaders::ConstBuff), numBackBuffers);
+	gpuDescriptorHeap = make_unique<GpuDescriptorHeap>(pDevice, *pCommandQueue, descriptorHeapPersistentSize, descriptorHeapFrameSize, numBackBuffers);
 
 	// Create swap chain 
 	pSwapChain = DXUtil::createSwapChain(pCommandQueue->getCommandQueue(), hWnd, numBackBuffers);
@@ -86,7 +95,7 @@ RTGraphics::RTGraphics(HWND hWnd)
 
 	// Setup ImGui
 	bool valid = IMGUI_CHECKVERSION();
-	pImGuiDescriptorHeap = DXUtil::createDescriptorHeap(pDevice, 1u, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, true);
+	const GpuDescriptorHeap::Handle fontDescriptor = gpuDescriptorHeap->allocate(1u);
 	ImGuiContext* context = ImGui::CreateContext();
 	ImGuiIO& io = ImGui::GetIO();
 	ImGui_ImplWin32_Init(hWnd);
@@ -94,8 +103,8 @@ RTGraphics::RTGraphics(HWND hWnd)
 		pDevice.Get(),
 		numBackBuffers,
 		DXGI_FORMAT_R8G8B8A8_UNORM,
-		pImGuiDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
-		pImGuiDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
+		gpuDescriptorHeap->getCpuHandle(fontDescriptor.index),
+		gpuDescriptorHeap->getGpuHandle(fontDescriptor.index));
 	ImGui::StyleColorsDark();
 }
 
@@ -106,6 +115,7 @@ Engine::RTGraphics::~RTGraphics()
 	ImGui::DestroyContext();
 
 	pCommandQueue->flush();
+	DXUtil::setMemoryAllocator(nullptr);
 }
 
 void Engine::RTGraphics::init()
@@ -121,103 +131,82 @@ void Engine::RTGraphics::init()
 
 	const auto& shapes = scene.getShapes();
 
-	pCurrentCommandList = pCommandQueue->getCommandList();
+	// Plain buffer uploads go through the copy queue and end up in the common state, which the direct queue promotes from.
+	// Each batch is staged in a few large upload pages.
+	wrl::ComPtr<ID3D12GraphicsCommandList4> pCopyCommandList = pCopyQueue->getCommandList();
+	UploadBatcher vertexUploads(pDevice);
 
-	Shaders::ConstBuff cBuff = {};
+	auto flattenedVerts = scene.getFlattenedVertices();
+	vertexBuffer = vertexUploads.createBuffer(flattenedVerts.data(), flattenedVerts.size() * sizeof(dx::XMFLOAT3), D3D12_RESOURCE_STATE_COMMON);
 
-	wrl::ComPtr<ID3D12Resource> cBuffIntBuffer;
-	pConstantBuffer = DXUtil::uploadDataToDefaultHeap(
-		pDevice,
-		pCurrentCommandList,
-		cBuffIntBuffer,
-		&cBuff,
-		sizeof(cBuff),
-		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	// The BLAS builds only need the vertices, so they go first
+	vertexUploads.record(pCopyCommandList);
+	executeUploads(pCopyCommandList, { vertexBuffer.Get() });
+	pCopyCommandList = pCopyQueue->getCommandList();
 
-	std::vector<wrl::ComPtr<ID3D12Resource>> intermediateBuffers;
-	intermediateBuffers.resize(1);
+	// Everything else streams in while the BLAS builds run
+	UploadBatcher sceneUploads(pDevice);
 
-	auto flattenedVerts = scene.getFlattenedVertices();
-	vertexBuffer = DXUtil::uploadDataToDefaultHeap(
-		pDevice,
-		pCurrentCommandList,
-		intermediateBuffers[0], 
-		flattenedVerts.data(),
-		flattenedVerts.size() * sizeof(dx::XMFLOAT3),
-		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-
-	std::vector<size_t> vertexCounts;
-	std::transform(shapes.begin(), shapes.end(), std::back_inserter(vertexCounts), [](const Shape& s) -> size_t {return s.getVertices().size(); });
-
-	blasBuffers.resize(shapes.size());
-
-	for (size_t i = 0; i < blasBuffers.size(); ++i) {
-		size_t vertexCount = scene.getShape(i).getVertices().size();
-		blasBuffers[i] = DXUtil::createBottomLevelAS(pDevice, pCurrentCommandList, 
-			{ vertexBuffer->GetGPUVirtualAddress() + sizeof(dx::XMFLOAT3) * scene.getFaceOffsets()[i] * 3 },
-			{ vertexCount }, sizeof(dx::XMFLOAT3));
-	}
+	pTexCoords = sceneUploads.createBuffer(scene.getTextureVertices().data(), scene.getTextureVertices().size() * sizeof(dx::XMFLOAT2), D3D12_RESOURCE_STATE_COMMON);
 
-	// Setup matrices
-	groupMatrices.resize(shapes.size());
-	
-	for (size_t i = 0; i < groupMatrices.size(); ++i) {
-		groupMatrices[i] = shapes[i].getTransform();
-	}
+	createMaterialsAndFaceAttributes(sceneUploads);
 
-	wrl::ComPtr<ID3D12Resource> tlasTempBuffer;
-	DXUtil::buildTopLevelAS(pDevice, pCurrentCommandList, blasBuffers, tlasTempBuffer, scene.getFaceOffsets(), groupMatrices, false, tlasBuffers);
+	// World transforms of the shapes, kept up to date by the scene graph
+	const auto& instanceTransforms = scene.getSceneGraph().getInstanceTransforms();
+	pMatrices = sceneUploads.createBuffer(instanceTransforms.data(), sizeof(dx::XMFLOAT3X4) * instanceTransforms.size(), D3D12_RESOURCE_STATE_COMMON);
 
-	// load textures
-	vector<wrl::ComPtr<ID3D12Resource>> texTempBuffer;
-	texTempBuffer.resize(scene.getTextures().size());
-	size_t dTCount = 0;
-	for (const auto& texture : scene.getTextures()) {
-		textures.push_back(DXUtil::uploadTextureDataToDefaultHeap(
-			pDevice, 
-			pCurrentCommandList,
-			texTempBuffer[dTCount++],
-			texture.data.get(),
-			texture.width,
-			texture.height,
-			texture.channels,
-			DXGI_FORMAT_R8G8B8A8_UNORM,
-			D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
+	sceneUploads.record(pCopyCommandList);
+	executeUploads(pCopyCommandList, { pTexCoords.Get(), pMaterials.Get(), pFaceAttributes.Get(), pMatrices.Get() });
+	pCopyCommandList.Reset();
+
+	pCurrentCommandList = pCommandQueue->getCommandList();
+	waitForUploads({ vertexBuffer.Get() });
+
+	// One BLAS per mesh, shared by all shapes that instance it
+	const auto& meshes = scene.getMeshes();
+	vector<BlasBuilder::Geometry> blasGeometries(meshes.size());
+
+	for (size_t i = 0; i < blasGeometries.size(); ++i) {
+		blasGeometries[i] = { vertexBuffer->GetGPUVirtualAddress() + sizeof(dx::XMFLOAT3) * meshes[i].faceOffset * 3, static_cast<UINT>(meshes[i].vertices.size()) };
 	}
 
-	if (textures.empty()) {
-		textures.push_back(DXUtil::createTextureCommittedResource(
-			pDevice, D3D12_HEAP_TYPE_DEFAULT, 1, 1, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_FLAG_NONE, DXGI_FORMAT_R8G8B8A8_UNORM));
+	// Executes everything recorded so far and continues on a new command list
+	BlasBuilder::Result blasResult = BlasBuilder(pDevice, *pCommandQueue).build(pCurrentCommandList, blasGeometries, sizeof(dx::XMFLOAT3));
+	blasBuffers = move(blasResult.blasBuffers);
+	blasUncompactedSize = blasResult.uncompactedSize;
+	blasCompactedSize = blasResult.compactedSize;
+
+	// The builds have been waited for, and they waited for the vertex uploads
+	vertexUploads.release();
+
+	// Setup instances. InstanceID is the mesh's first face, so per face data is shared as well.
+	instanceMeshIndices.resize(shapes.size());
+	instanceFaceOffsets.resize(shapes.size());
+	
+	for (size_t i = 0; i < shapes.size(); ++i) {
+		instanceMeshIndices[i] = shapes[i].getMeshIndex();
+		instanceFaceOffsets[i] = meshes[instanceMeshIndices[i]].faceOffset;
 	}
 
-	// load texture coordinates
-	wrl::ComPtr<ID3D12Resource> texCoordsTempBuffer;
-	pTexCoords = DXUtil::uploadDataToDefaultHeap(
-		pDevice,
-		pCurrentCommandList,
-		texCoordsTempBuffer,
-		scene.getTextureVertices().data(),
-		scene.getTextureVertices().size() * sizeof(dx::XMFLOAT2),
-		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	DXUtil::buildTopLevelAS(pDevice, pCurrentCommandList, blasBuffers, instanceMeshIndices, uploadRingBuffer->getAllocator(), instanceFaceOffsets, instanceTransforms, tlasBuffers);
+
+	// Only the small placeholder mips are uploaded here, full resolution textures are streamed in once sampled.
+	// Stays on the direct queue, the streaming that follows keeps track of the texture states.
+	textureResidencyManager = make_unique<TextureResidencyManager>(pDevice, scene.getTextures(), numBackBuffers);
+	textureResidencyManager->init(pCurrentCommandList);
 
 	pStateObject = createRtPipeline();
-	
-	createShaderResources();
-	createMaterialsAndFaceAttributes();
 
-	// Copy matrices
-	pMatrices = DXUtil::uploadDataToDefaultHeap(
-		pDevice,
-		pCurrentCommandList,
-		pTempBufferMatrices[pCurrentBackBufferIndex],
-		groupMatrices.data(),
-		sizeof(decltype(groupMatrices)::value_type) * groupMatrices.size(),
-		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	createRenderGraph();
+	createShaderResources();
 
 	wrl::ComPtr<ID3D12Resource> shaderTableTempBuffer;
 	pShadingTable = createShaderTable(shaderTableTempBuffer);
 
-	pCommandQueue->executeCommandList(pCurrentCommandList);
+	// The copy queue work has to land before the first frame reads it
+	waitForUploads({ pTexCoords.Get(), pMaterials.Get(), pFaceAttributes.Get(), pMatrices.Get() });
+
+	uploadRingBuffer->finishFrame(pCommandQueue->executeCommandList(pCurrentCommandList));
 	pCommandQueue->flush();
 
 	pCurrentCommandList.Reset();
@@ -228,13 +217,13 @@ void Engine::RTGraphics::clearBuffer(float red, float green, float blue)
 {
 	pCurrentCommandList = pCommandQueue->getCommandList();
 
-	pCurrentCommandList->SetDescriptorHeaps(1u, descriptorHeap.GetAddressOf());
-
-	pCurrentCommandList->ResourceBarrier(1u, &CD3DX12_RESOURCE_BARRIER::Transition(outputRTTexture.Get(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+	// Holds the descriptors of every pass, ImGui's included
+	gpuDescriptorHeap->beginFrame();
+	ID3D12DescriptorHeap* descriptorHeaps[] = { gpuDescriptorHeap->getDescriptorHeap().Get() };
+	pCurrentCommandList->SetDescriptorHeaps(1u, descriptorHeaps);
 
-	// Transition the back buffer from the present state to the render target state
-	auto backBuffer = pBackBuffers[pCurrentBackBufferIndex];
-	pCurrentCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_COPY_DEST));
+	// Stream textures based on the feedback of the last frame that used this back buffer
+	textureResidencyManager->update(pCurrentCommandList, *pCommandQueue, *uploadRingBuffer, pCurrentBackBufferIndex, ++frameNumber);
 
 	// Clear the RTV with the specified colour
 	//CD3DX12_CPU_DESCRIPTOR_HANDLE rtvDescriptorHandle(pRTVDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), pCurrentBackBufferIndex, pRTVDescriptorSize);
@@ -245,7 +234,7 @@ void Engine::RTGraphics::clearBuffer(float red, float green, float blue)
 void Engine::RTGraphics::draw(uint64_t timeMs, bool& clear)
 {
 	// Transform vertices in TLAS
-	//DXUtil::buildTopLevelAS(pDevice, pCurrentCommandList, blasBuffers.pResult, pTlasTempBuffer[pCurrentBackBufferIndex], (timeMs % 8000) / 8000.f * 6.28f, true, tlasBuffers);
+	//DXUtil::buildTopLevelAS(pDevice, pCurrentCommandList, blasBuffers.pResult, uploadRingBuffer->getAllocator(), (timeMs % 8000) / 8000.f * 6.28f, true, tlasBuffers);
 
 	Shaders::ConstBuff cBuff = {};
 
@@ -259,6 +248,15 @@ void Engine::RTGraphics::draw(uint64_t timeMs, bool& clear)
 	clear |= camera->hasChanged();
 	ImGui::End();
 
+	ImGui::Begin("Animation");
+	animation.drawUI();
+	ImGui::End();
+
+	// Moves the camera and sets the animated node transforms, which the scene graph update below propagates
+	const float deltaSeconds = lastFrameTimeMs == 0 ? 0.f : (timeMs - lastFrameTimeMs) / 1000.f;
+	lastFrameTimeMs = timeMs;
+	clear |= animation.update(deltaSeconds, scene.getSceneGraph(), *camera);
+
 	// Setup camera - Simulating Nikon's one
 	Shaders::Camera& shaderCamera = cBuff.camera;
 	shaderCamera.position = camera->getPosition();
@@ -276,32 +274,36 @@ void Engine::RTGraphics::draw(uint64_t timeMs, bool& clear)
 		shaderCamera.filmPlane.height *= camera->getMagnification();
 	}
 
+	// Angle covered by a single pixel, used to grow ray cones for texture LOD selection
+	shaderCamera.pixelSpreadAngle = std::atan(shaderCamera.filmPlane.height / (shaderCamera.focalLength * winHeight));
+
 	//// Create ImGui Window
 	ImGui::Begin("Shapes");
 
-	bool structureChanged = false;
-	for (int i = 0; i < scene.getShapes().size(); ++i) {
-		auto& shape = scene.getShape(i);
-		shape.drawUI();
-		if (shape.hasChanged()) {
-			structureChanged = true;
-			groupMatrices[i] = shape.getTransform();
-		}
+	// Only the selected shape gets editable widgets, the tree only submits its open and visible nodes
+	drawSelectedShapeUI();
+
+	auto& sceneGraph = scene.getSceneGraph();
+	for (size_t root : sceneGraph.getRoots()) {
+		drawSceneGraphUI(root);
 	}
 
 	ImGui::End();
 
-	if (structureChanged) {
+	// Only the edited and animated subtrees are recomputed, and only their matrices uploaded. The TLAS is refit, not rebuilt.
+	if (sceneGraph.update()) {
 		clear = true;
-		DXUtil::buildTopLevelAS(pDevice, pCurrentCommandList, blasBuffers, pTlasTempBuffer[pCurrentBackBufferIndex], scene.getFaceOffsets(), groupMatrices, true, tlasBuffers);
-		DXUtil::updateDataInDefaultHeap(
-			pDevice,
+		const auto& instanceTransforms = sceneGraph.getInstanceTransforms();
+		DXUtil::updateTopLevelAS(pCurrentCommandList, uploadRingBuffer->getAllocator(), instanceTransforms, sceneGraph.getChangedInstanceRanges(), tlasBuffers);
+		// Buffers decay to COMMON once a command list using them completes, so the matrices are in COMMON at the start of every frame
+		DXUtil::updateDataRangesInDefaultHeap(
 			pCurrentCommandList,
 			pMatrices,
-			pTempBufferMatrices[pCurrentBackBufferIndex],
-			groupMatrices.data(),
-			sizeof(decltype(groupMatrices)::value_type) * groupMatrices.size(),
-			D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+			uploadRingBuffer->getAllocator(),
+			instanceTransforms.data(),
+			sizeof(dx::XMFLOAT3X4),
+			sceneGraph.getChangedInstanceRanges(),
+			D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 	}
 
 	ImGui::Begin("Lights");
@@ -314,6 +316,22 @@ void Engine::RTGraphics::draw(uint64_t timeMs, bool& clear)
 
 	ImGui::End();
 
+	ImGui::Begin("Textures");
+	textureResidencyManager->drawUI();
+	ImGui::End();
+
+	ImGui::Begin("Memory");
+	const auto memoryStats = memoryAllocator->getStats();
+	ImGui::Text("Heaps: %zu, %.1f MB reserved, %.1f MB allocated", memoryStats.heapCount, memoryStats.reservedSize / (1024.f * 1024.f), memoryStats.allocatedSize / (1024.f * 1024.f));
+	ImGui::Text("Placed resources: %zu, committed: %zu", memoryStats.placedCount, memoryStats.committedCount);
+	ImGui::Text("Largest free block: %.1f MB, fragmentation: %.2f", memoryStats.largestFreeBlockSize / (1024.f * 1024.f), memoryStats.fragmentation);
+	ImGui::Text("BLAS: %.1f MB compacted from %.1f MB", blasCompactedSize / (1024.f * 1024.f), blasUncompactedSize / (1024.f * 1024.f));
+	const auto& renderGraphMemory = renderGraph->getCompiled();
+	const auto& descriptorAllocator = gpuDescriptorHeap->getAllocator();
+	ImGui::Text("Descriptors: %u of %u free, %u waiting for the GPU", descriptorAllocator.getFreeCount(), descriptorAllocator.getPersistentCount(), descriptorAllocator.getPendingFreeCount());
+	ImGui::Text("Render graph: %.1f MB transient, %.1f MB without aliasing", renderGraphMemory.heapSize / (1024.f * 1024.f), renderGraphMemory.transientSize / (1024.f * 1024.f));
+	ImGui::End();
+
 	// Setup area lights
 	cBuff.numLights = std::min(std::size(cBuff.areaLights), scene.getLights().size());
 	memcpy(cBuff.areaLights, scene.getLights().data(), sizeof(Shaders::AreaLight) * cBuff.numLights);
@@ -322,27 +340,10 @@ void Engine::RTGraphics::draw(uint64_t timeMs, bool& clear)
 	cBuff.seed1 = sampler.nextUInt32();
 	cBuff.seed2 = sampler.nextUInt32();
 	cBuff.clear = clear ? 1 : 0;
+	cBuff.frameNumber = frameNumber;
 
-	//
-	DXUtil::updateDataInDefaultHeap(
-		pDevice,
-		pCurrentCommandList,
-		pConstantBuffer,
-		pConstTempBuffer[pCurrentBackBufferIndex],
-		&cBuff,
-		sizeof(cBuff),
-		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-
-	// bind empty root signature 
-	pCurrentCommandList->SetComputeRootSignature(globalEmptyRootSignature.Get());
-	pCurrentCommandList->SetPipelineState1(pStateObject.Get());
-
-	// Launch rays
-	D3D12_DISPATCH_RAYS_DESC dispatchRaysDesc = shadingTable->getDispatchRaysDescriptor(winWidth, winHeight);
-
-	pCurrentCommandList->DispatchRays(&dispatchRaysDesc);
-
-	
+	// Written straight into this frame's copy, which the ray tracing pass binds as the global root CBV
+	frameConstantsAddress = frameConstants->write(&cBuff);
 
 	// Create ImGui Test Window
 	//ImGui::Begin("Test");
@@ -355,24 +356,15 @@ void Engine::RTGraphics::draw(uint64_t timeMs, bool& clear)
 
 void Engine::RTGraphics::endFrame()
 {
-	pCurrentCommandList->ResourceBarrier(1u, &CD3DX12_RESOURCE_BARRIER::Transition(outputRTTexture.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE));
-
-	// Change the back buffer from the render target state to the present state
-	auto backBuffer = pBackBuffers[pCurrentBackBufferIndex];
-	// perform copy
-	pCurrentCommandList->CopyResource(backBuffer.Get(), outputRTTexture.Get());
-	pCurrentCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_RENDER_TARGET));
-
-	// Draw imgui
-	CD3DX12_CPU_DESCRIPTOR_HANDLE rtvDescriptorHandle(pRTVDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), pCurrentBackBufferIndex, pRTVDescriptorSize);
-	pCurrentCommandList->OMSetRenderTargets(1u, &rtvDescriptorHandle, FALSE, nullptr);
+	// Dispatches the rays, copies the output into the back buffer, draws ImGui and leaves the back buffer ready to present
+	renderGraph->setImportedResource(backBufferHandle, pBackBuffers[pCurrentBackBufferIndex]);
+	renderGraph->execute(pCurrentCommandList);
 
-	pCurrentCommandList->SetDescriptorHeaps(1u, pImGuiDescriptorHeap.GetAddressOf());
-	ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), pCurrentCommandList.Get());
-
-	pCurrentCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(backBuffer.Get(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
 	// Execute command list
 	frameFenceValues[pCurrentBackBufferIndex] = pCommandQueue->executeCommandList(pCurrentCommandList);
+	uploadRingBuffer->finishFrame(frameFenceValues[pCurrentBackBufferIndex]);
+	frameConstants->finishFrame(frameFenceValues[pCurrentBackBufferIndex]);
+	gpuDescriptorHeap->finishFrame(frameFenceValues[pCurrentBackBufferIndex]);
 
 	// Release pointer to this command list (Comptr reset is being called here)
 	pCurrentCommandList.Reset();
@@ -390,6 +382,65 @@ Camera& Engine::RTGraphics::getCamera()
 	return *camera;
 }
 
+void Engine::RTGraphics::drawSceneGraphUI(std::size_t node)
+{
+	const auto& sceneGraph = scene.getSceneGraph();
+	const auto& children = sceneGraph.getChildren(node);
+
+	// Nodes start collapsed, leaves don't push anything to pop
+	ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_OpenOnDoubleClick;
+	if (children.empty()) {
+		flags |= ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
+	}
+	if (node == selectedSceneNode) {
+		flags |= ImGuiTreeNodeFlags_Selected;
+	}
+
+	const bool open = ImGui::TreeNodeEx(reinterpret_cast<void*>(node), flags, "%s", sceneGraph.getName(node).c_str());
+	if (ImGui::IsItemClicked()) {
+		selectedSceneNode = node;
+	}
+
+	if (!open || children.empty()) {
+		return;
+	}
+
+	// Only the children in view are submitted. The clipper assumes one line per child, an opened child makes the list
+	// scroll unevenly until it is closed again.
+	ImGuiListClipper clipper(static_cast<int>(children.size()));
+	while (clipper.Step()) {
+		for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+			drawSceneGraphUI(children[i]);
+		}
+	}
+
+	ImGui::TreePop();
+}
+
+void Engine::RTGraphics::drawSelectedShapeUI()
+{
+	auto& sceneGraph = scene.getSceneGraph();
+
+	// The scene may have been reloaded since
+	if (selectedSceneNode >= sceneGraph.getNodeCount()) {
+		selectedSceneNode = SceneGraph::noParent;
+	}
+
+	const size_t instanceIndex = selectedSceneNode != SceneGraph::noParent ? sceneGraph.getInstanceIndex(selectedSceneNode) : SceneGraph::noInstance;
+	if (instanceIndex == SceneGraph::noInstance) {
+		ImGui::Text("Select a shape to edit it");
+	}
+	else {
+		auto& shape = scene.getShape(instanceIndex);
+		shape.drawUI();
+		if (shape.hasChanged()) {
+			sceneGraph.setLocalTransform(selectedSceneNode, shape.getTransform());
+		}
+	}
+
+	ImGui::Separator();
+}
+
 wrl::ComPtr<ID3D12StateObject> Engine::RTGraphics::createRtPipeline()
 {
 	HRESULT hr;
@@ -423,20 +474,12 @@ wrl::ComPtr<ID3D12StateObject> Engine::RTGraphics::createRtPipeline()
 	
 	// Third - Local Root Signature for Ray Gen shader
 	// Build the root signature descriptor and create root signature
-	rootSignatureManager->addDescriptorRange("BVHAndTextures", CD3DX12_DESCRIPTOR_RANGE1(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 2, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_NONE));//gOutput, gRadiance
+	rootSignatureManager->addDescriptorRange("BVHAndTextures", CD3DX12_DESCRIPTOR_RANGE1(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 3, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_NONE));//gOutput, gRadiance, gTextureFeedback
 	rootSignatureManager->addDescriptorRange("BVHAndTextures", CD3DX12_DESCRIPTOR_RANGE1(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_NONE)); //gRtScene
 
-	if (!textures.empty()) {
-		rootSignatureManager->addDescriptorRange("BVHAndTextures", CD3DX12_DESCRIPTOR_RANGE1(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, textures.size(), 6, 0, D3D12_DESCRIPTOR_RANGE_FLAG_NONE));
-	}
-
 	rootSignatureManager->setDescriptorTableParameter("BVHAndTexturesDescTable", "BVHAndTextures");
 
-	CD3DX12_ROOT_PARAMETER1 param;
-	param.InitAsConstantBufferView(0);
-	rootSignatureManager->setParameter("ConstBuff", param);
-
-	rootSignatureManager->addParametersToRootSignature("RayGenRootSignature", { "BVHAndTexturesDescTable", "ConstBuff" });
+	rootSignatureManager->addParametersToRootSignature("RayGenRootSignature", { "BVHAndTexturesDescTable" });
 	rootSignatureManager->generateRootSignature("RayGenRootSignature", pDevice);
 
 	// Fourth - Associate the local root signature to registers in shaders (in the rayGen program) using Export Association
@@ -451,7 +494,7 @@ wrl::ComPtr<ID3D12StateObject> Engine::RTGraphics::createRtPipeline()
 	shadingTable->addProgram(L"indirectMiss", Miss, "EmptyRootSignature");
 
 	D3D12_STATIC_SAMPLER_DESC sampler = {};
-	sampler.Filter = D3D12_FILTER_MIN_MAG_MIP_POINT;
+	sampler.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
 	sampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
 	sampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
 	sampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
@@ -464,13 +507,14 @@ wrl::ComPtr<ID3D12StateObject> Engine::RTGraphics::createRtPipeline()
 	sampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
 
 	// Create Hit root signature parameters
+	CD3DX12_ROOT_PARAMETER1 param;
 	param.InitAsShaderResourceView(1); rootSignatureManager->setParameter("verts", param);
 	param.InitAsShaderResourceView(2); rootSignatureManager->setParameter("faceAttributes", param);
 	param.InitAsShaderResourceView(3); rootSignatureManager->setParameter("materials", param);
 	param.InitAsShaderResourceView(4); rootSignatureManager->setParameter("texVerts", param);
 	param.InitAsShaderResourceView(5); rootSignatureManager->setParameter("matrices", param);
 
-	rootSignatureManager->addParametersToRootSignature("HitRootSignature", { "ConstBuff",  "verts",  "BVHAndTexturesDescTable", "faceAttributes", "materials", "texVerts", "matrices" });
+	rootSignatureManager->addParametersToRootSignature("HitRootSignature", { "verts",  "BVHAndTexturesDescTable", "faceAttributes", "materials", "texVerts", "matrices" });
 	rootSignatureManager->setSamplerForRootSignature("HitRootSignature", sampler);
 	rootSignatureManager->generateRootSignature("HitRootSignature", pDevice);
 
@@ -501,11 +545,16 @@ wrl::ComPtr<ID3D12StateObject> Engine::RTGraphics::createRtPipeline()
 	CD3DX12_RAYTRACING_PIPELINE_CONFIG_SUBOBJECT rtPipelineConfig(stateObjectDesc);
 	rtPipelineConfig.Config(2);
 
-	// Tenth - Global Root Signature
-	CD3DX12_GLOBAL_ROOT_SIGNATURE_SUBOBJECT globalRootSignature (stateObjectDesc);
-	CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC globalEmptyRootSignatureDesc(0, static_cast<CD3DX12_ROOT_PARAMETER1*>(nullptr), 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE);
-	globalEmptyRootSignature = DXUtil::createRootSignature(pDevice, globalEmptyRootSignatureDesc);
-	globalRootSignature.SetRootSignature(globalEmptyRootSignature.Get());
+	// Tenth - Global Root Signature, holds the per frame constant buffer (b0) and the textures (t6), so that they can change without touching the shading table.
+	// Texture descriptors switch between placeholders and full resolution textures as they are streamed, every frame slot binds its own copy.
+	CD3DX12_GLOBAL_ROOT_SIGNATURE_SUBOBJECT globalRootSignatureSubobject (stateObjectDesc);
+	CD3DX12_DESCRIPTOR_RANGE1 texturesRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, static_cast<UINT>(textureResidencyManager->getTextureCount()), 6, 0);
+	CD3DX12_ROOT_PARAMETER1 globalParams[2];
+	globalParams[0].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_STATIC_WHILE_SET_AT_EXECUTE);
+	globalParams[1].InitAsDescriptorTable(1, &texturesRange);
+	CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC globalRootSignatureDesc(static_cast<UINT>(std::size(globalParams)), globalParams, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE);
+	globalRootSignature = DXUtil::createRootSignature(pDevice, globalRootSignatureDesc);
+	globalRootSignatureSubobject.SetRootSignature(globalRootSignature.Get());
 
 	// Finally - Create the state
 	wrl::ComPtr<ID3D12StateObject> stateObject;
@@ -518,12 +567,10 @@ wrl::ComPtr<ID3D12StateObject> Engine::RTGraphics::createRtPipeline()
 void Engine::RTGraphics::createShaderResources()
 {
 	// The descriptor heap to store SRV (Shader resource View) and UAV (Unordered access view) descriptors
-	auto& descHeapManager = shadingTable->generateDescriptorHeap("BVHAndTexturesDescTable", "BVHTextures1", pDevice);
-	descriptorHeap = descHeapManager.getDescriptorHeap();
+	auto& descHeapManager = shadingTable->generateDescriptorHeap("BVHAndTexturesDescTable", "BVHTextures1", pDevice, *gpuDescriptorHeap);
 
-	// The output resource
-	outputRTTexture = DXUtil::createTextureCommittedResource(pDevice, D3D12_HEAP_TYPE_DEFAULT, winWidth, winHeight, D3D12_RESOURCE_STATE_COPY_SOURCE);
-	radianceTexture = DXUtil::createTextureCommittedResource(pDevice, D3D12_HEAP_TYPE_DEFAULT, winWidth, winHeight, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_FLAG_NONE, DXGI_FORMAT_R32G32B32A32_FLOAT);
+	// The output resource comes from the render graph, the accumulated radiance outlives the frame
+	radianceTexture = DXUtil::createTextureCommittedResource(pDevice, D3D12_HEAP_TYPE_DEFAULT, winWidth, winHeight, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, DXGI_FORMAT_R32G32B32A32_FLOAT);
 	
 	// Create the UAV descriptor first (needs to be same order as in root signature)
 	D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
@@ -533,6 +580,7 @@ void Engine::RTGraphics::createShaderResources()
 
 	descHeapManager.setUAV(entryNumber++, uavDesc, pDevice, outputRTTexture);
 	descHeapManager.setUAV(entryNumber++, uavDesc, pDevice, radianceTexture);
+	const size_t feedbackEntry = entryNumber++;
 
 	// Create the SRV descriptor in second place (following same order as in root signature)
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
@@ -542,47 +590,84 @@ void Engine::RTGraphics::createShaderResources()
 
 	descHeapManager.setSRV(entryNumber++, srvDesc, pDevice);
 
-	srvDesc = {};
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MipLevels = 1;
-	for (const auto& texture : textures) {
-		descHeapManager.setSRV(entryNumber++, srvDesc, pDevice, texture);
-	}
+	// Texture feedback UAV, the textures have per frame tables bound through the global root signature
+	textureResidencyManager->createViews(descHeapManager, feedbackEntry, *gpuDescriptorHeap);
 }
 
-void Engine::RTGraphics::createMaterialsAndFaceAttributes()
+void Engine::RTGraphics::createRenderGraph()
+{
+	renderGraph = make_unique<RenderGraphExecutor>(pDevice);
+	RenderGraph& graph = renderGraph->getGraph();
+
+	// Fully rewritten by every dispatch
+	const auto output = renderGraph->createTexture("Output", CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, winWidth, winHeight, 1u, 1u, 1u, 0u, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS));
+	backBufferHandle = graph.importResource("Back Buffer", D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT);
+
+	const auto rayTracing = renderGraph->addPass("Ray Tracing", [this](wrl::ComPtr<ID3D12GraphicsCommandList4> pCommandList) {
+		pCommandList->SetComputeRootSignature(globalRootSignature.Get());
+		pCommandList->SetComputeRootConstantBufferView(0, frameConstantsAddress);
+		pCommandList->SetComputeRootDescriptorTable(1, textureResidencyManager->getTextureTable(pCurrentBackBufferIndex));
+		pCommandList->SetPipelineState1(pStateObject.Get());
+
+		// Launch rays
+		D3D12_DISPATCH_RAYS_DESC dispatchRaysDesc = shadingTable->getDispatchRaysDescriptor(winWidth, winHeight);
+		pCommandList->DispatchRays(&dispatchRaysDesc);
+
+		textureResidencyManager->copyFeedback(pCommandList, pCurrentBackBufferIndex);
+	});
+	graph.write(rayTracing, output, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+	const auto copy = renderGraph->addPass("Copy Output", [this, output](wrl::ComPtr<ID3D12GraphicsCommandList4> pCommandList) {
+		pCommandList->CopyResource(renderGraph->getResource(backBufferHandle).Get(), renderGraph->getResource(output).Get());
+	});
+	graph.read(copy, output, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	graph.write(copy, backBufferHandle, D3D12_RESOURCE_STATE_COPY_DEST);
+
+	const auto ui = renderGraph->addPass("ImGui", [this](wrl::ComPtr<ID3D12GraphicsCommandList4> pCommandList) {
+		CD3DX12_CPU_DESCRIPTOR_HANDLE rtvDescriptorHandle(pRTVDescriptorHeap->GetCPUDescriptorHandleForHeapStart(), pCurrentBackBufferIndex, pRTVDescriptorSize);
+		pCommandList->OMSetRenderTargets(1u, &rtvDescriptorHandle, FALSE, nullptr);
+		ImGui_ImplDX12_RenderDrawData(ImGui::GetDrawData(), pCommandList.Get());
+	});
+	graph.write(ui, backBufferHandle, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+	renderGraph->compile();
+	outputRTTexture = renderGraph->getResource(output);
+}
+
+void Engine::RTGraphics::createMaterialsAndFaceAttributes(UploadBatcher& uploads)
 {
 	// create constant buffer view - not on descriptor heap
-	pMaterials = DXUtil::uploadDataToDefaultHeap(
-		pDevice,
-		pCurrentCommandList,
-		pTlasTempBuffer[0],
-		scene.getMaterials().data(),
-		sizeof(Shaders::Material) * scene.getMaterials().size(),
-		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	pMaterials = uploads.createBuffer(scene.getMaterials().data(), sizeof(Shaders::Material) * scene.getMaterials().size(), D3D12_RESOURCE_STATE_COMMON);
 
 	// Get Face attributes
 	const std::vector<Shaders::FaceAttributes>& faceAttributes = scene.getFaceAttributes();
 
 	// Copy..
-	pFaceAttributes = DXUtil::uploadDataToDefaultHeap(
-		pDevice,
-		pCurrentCommandList,
-		pTlasTempBuffer[1],
-		faceAttributes.data(),
-		sizeof(Shaders::FaceAttributes) * faceAttributes.size(),
-		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	pFaceAttributes = uploads.createBuffer(faceAttributes.data(), sizeof(Shaders::FaceAttributes) * faceAttributes.size(), D3D12_RESOURCE_STATE_COMMON);
+}
+
+void Engine::RTGraphics::executeUploads(wrl::ComPtr<ID3D12GraphicsCommandList4> pCopyCommandList, const std::vector<Util::QueueDependencies::Key>& resources)
+{
+	const uint64_t fenceValue = pCopyQueue->executeCommandList(pCopyCommandList);
+	for (auto resource : resources) {
+		uploadDependencies.setProducer(resource, fenceValue);
+	}
+}
+
+void Engine::RTGraphics::waitForUploads(const std::vector<Util::QueueDependencies::Key>& resources)
+{
+	const uint64_t fenceValue = uploadDependencies.getRequiredWait(resources);
+	if (fenceValue != 0) {
+		pCommandQueue->waitForQueue(*pCopyQueue, fenceValue);
+		uploadDependencies.setWaited(fenceValue);
+	}
 }
 
 wrl::ComPtr<ID3D12Resource> Engine::RTGraphics::createShaderTable(wrl::ComPtr<ID3D12Resource>& shaderTableTempResource)
 {
 	// Link elements
 	shadingTable->setInputForDescriptorTableParameter(L"rayGen", "BVHAndTexturesDescTable", "BVHTextures1");
-	shadingTable->setInputForViewParameter(L"rayGen", "ConstBuff", pConstantBuffer);
 
-	shadingTable->setInputForViewParameter(L"HitGroup", "ConstBuff", pConstantBuffer);
 	shadingTable->setInputForViewParameter(L"HitGroup", "verts", vertexBuffer);
 	shadingTable->setInputForDescriptorTableParameter(L"HitGroup", "BVHAndTexturesDescTable", "BVHTextures1");
 	shadingTable->setInputForViewParameter(L"HitGroup", "faceAttributes", pFaceAttributes);
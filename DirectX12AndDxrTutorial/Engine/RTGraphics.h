@@ -10,12 +10,14 @@
 #include <memory>
 
 #include "Util/DXUtil.h"
+#include "Util/QueueDependencies.h"
 
 #include "DxgiInfoManager.h"
 
 #include "../Exception/WindowException.h"
 #include "CommandQueue.h"
 #include "Camera.h"
+#include "Animation.h"
 #include "IRenderer.h"
 
 #include "Scene.h"
@@ -23,6 +25,13 @@
 
 #include "RootSignatureManager.h"
 #include "ShadingTable.h"
+#include "TextureResidencyManager.h"
+#include "UploadRingBuffer.h"
+#include "BlasBuilder.h"
+#include "UploadBatcher.h"
+#include "FrameConstantBuffer.h"
+#include "RenderGraphExecutor.h"
+#include "GpuDescriptorHeap.h"
 
 namespace Engine {
 	class RTGraphics 
@@ -43,48 +52,72 @@ namespace Engine {
 	private:
 
 		static const UINT numBackBuffers = 2;
+		// Persistent descriptors (tables, ImGui's font) and temporary descriptors per frame in flight
+		static const UINT descriptorHeapPersistentSize = 16384;
+		static const UINT descriptorHeapFrameSize = 1024;
 
 		Microsoft::WRL::ComPtr<ID3D12StateObject> createRtPipeline();
 		void createShaderResources();
-		void createMaterialsAndFaceAttributes();
+		// Ray tracing -> copy to the back buffer -> ImGui, creates the output texture
+		void createRenderGraph();
+		void createMaterialsAndFaceAttributes(UploadBatcher& uploads);
 		Microsoft::WRL::ComPtr<ID3D12Resource> createShaderTable(Microsoft::WRL::ComPtr<ID3D12Resource>& shaderTableTempResource);
+		// Executes a copy queue command list that writes resources
+		void executeUploads(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCopyCommandList, const std::vector<Util::QueueDependencies::Key>& resources);
+		// Makes the direct queue wait for the copy queue work that writes resources, if it hasn't already
+		void waitForUploads(const std::vector<Util::QueueDependencies::Key>& resources);
+		// Tree of the scene graph, clicking a node selects it
+		void drawSceneGraphUI(std::size_t node);
+		// Transform widgets of the selected node's shape, pushes edits into the scene graph
+		void drawSelectedShapeUI();
 
 		DxgiInfoManager infoManager;
 		int winWidth, winHeight;
 
 		Microsoft::WRL::ComPtr<ID3D12Device5> pDevice;
+		// Declared before every resource, so that it is destroyed after them
+		std::unique_ptr<Util::GpuMemoryAllocator> memoryAllocator;
 		std::unique_ptr<CommandQueue> pCommandQueue;
+		// Scene uploads during init
+		std::unique_ptr<CommandQueue> pCopyQueue;
+		Util::QueueDependencies uploadDependencies;
+		// Staging for all per frame uploads
+		std::unique_ptr<UploadRingBuffer> uploadRingBuffer;
+		// Shaders::ConstBuff, one copy per back buffer
+		std::unique_ptr<FrameConstantBuffer> frameConstants;
+		// The only shader visible descriptor heap, bound for the whole frame
+		std::unique_ptr<GpuDescriptorHeap> gpuDescriptorHeap;
 		Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCurrentCommandList;
+		// Records the passes of a frame and the barriers between them
+		std::unique_ptr<RenderGraphExecutor> renderGraph;
+		Util::RenderGraph::Handle backBufferHandle;
+		D3D12_GPU_VIRTUAL_ADDRESS frameConstantsAddress;
 		std::vector<Util::DXUtil::AccelerationStructureBuffers> blasBuffers;
+		UINT64 blasUncompactedSize;
+		UINT64 blasCompactedSize;
 		Util::DXUtil::AccelerationStructureBuffers tlasBuffers;
-		Microsoft::WRL::ComPtr<ID3D12Resource> pConstTempBuffer[numBackBuffers];
-		Microsoft::WRL::ComPtr<ID3D12Resource> pTlasTempBuffer[numBackBuffers];
 
 		Microsoft::WRL::ComPtr<ID3D12StateObject> pStateObject;
 		Microsoft::WRL::ComPtr<ID3D12Resource> outputRTTexture;
 		Microsoft::WRL::ComPtr<ID3D12Resource> radianceTexture;
-		std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> textures;
-		Microsoft::WRL::ComPtr<ID3D12Resource> pConstantBuffer;
 		Microsoft::WRL::ComPtr<ID3D12Resource> pMaterials;
 		Microsoft::WRL::ComPtr<ID3D12Resource> pTexCoords;
-		Microsoft::WRL::ComPtr<ID3D12Resource> pTempBufferMatrices[numBackBuffers];
 		Microsoft::WRL::ComPtr<ID3D12Resource> pMatrices;
 		Microsoft::WRL::ComPtr<ID3D12Resource> pFaceAttributes;
-		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> descriptorHeap;
-		Microsoft::WRL::ComPtr<ID3D12RootSignature> globalEmptyRootSignature;
+		Microsoft::WRL::ComPtr<ID3D12RootSignature> globalRootSignature;
 
 		Microsoft::WRL::ComPtr<IDXGISwapChain4> pSwapChain;
 
 		// Heaps are similar to views in DirectX11 - essentially a list of views?
 		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> pRTVDescriptorHeap;
 
-		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> pImGuiDescriptorHeap;
-
 		// Tracks the backbuffers used in the swapchain
 		Microsoft::WRL::ComPtr<ID3D12Resource> pBackBuffers[numBackBuffers];
 
 		UINT pRTVDescriptorSize;
 		UINT pCurrentBackBufferIndex;
+		std::uint32_t frameNumber;
+		uint64_t lastFrameTimeMs;
 		uint64_t frameFenceValues[numBackBuffers];
 
 		// Temporary triangle stuff here
@@ -102,11 +135,17 @@ namespace Engine {
 		std::unique_ptr<Camera> camera;
 
 		Scene scene;
+		// Node whose shape the UI edits, SceneGraph::noParent if none
+		std::size_t selectedSceneNode = SceneGraph::noParent;
+		Animation animation;
 		UniformSampler sampler;
 
 		std::shared_ptr<RootSignatureManager> rootSignatureManager;
 		std::unique_ptr<ShadingTable> shadingTable;
+		std::unique_ptr<TextureResidencyManager> textureResidencyManager;
 
-		std::vector<DirectX::XMFLOAT3X4> groupMatrices;
+		// Per shape (TLAS instance)
+		std::vector<std::size_t> instanceMeshIndices;
+		std::vector<std::size_t> instanceFaceOffsets;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "RenderGraphExecutor.h"
+
+#include <algorithm>
+
+#include "Libraries/d3dx12.h"
+#include "Exception/Exception.h"
+#include "Exception/WindowException.h"
+#include "Util/DXUtil.h"
+
+namespace wrl = Microsoft::WRL;
+
+using namespace std;
+using namespace Util;
+
+namespace {
+	bool isRenderTarget(const D3D12_RESOURCE_DESC& desc)
+	{
+		return (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0;
+	}
+}
+
+Engine::RenderGraphExecutor::RenderGraphExecutor(wrl::ComPtr<ID3D12Device5> pDevice)
+	: pDevice(pDevice), compiled()
+{
+}
+
+Engine::RenderGraphExecutor::Handle Engine::RenderGraphExecutor::createTexture(const std::string& name, const D3D12_RESOURCE_DESC& desc)
+{
+	const D3D12_RESOURCE_ALLOCATION_INFO info = pDevice->GetResourceAllocationInfo(0, 1, &desc);
+	const Handle handle = graph.createTransient(name, info.SizeInBytes, info.Alignment);
+
+	descs.resize(graph.getResourceCount());
+	descs[handle] = desc;
+	return handle;
+}
+
+Engine::RenderGraphExecutor::Handle Engine::RenderGraphExecutor::addPass(const std::string& name, PassFunction function)
+{
+	const Handle handle = graph.addPass(name);
+
+	passFunctions.resize(graph.getPassCount());
+	passFunctions[handle] = move(function);
+	return handle;
+}
+
+Util::RenderGraph& Engine::RenderGraphExecutor::getGraph()
+{
+	return graph;
+}
+
+void Engine::RenderGraphExecutor::compile()
+{
+	HRESULT hr;
+
+	compiled = graph.compile();
+	descs.resize(graph.getResourceCount());
+	passFunctions.resize(graph.getPassCount());
+	resources.assign(graph.getResourceCount(), nullptr);
+	pHeap.Reset();
+	stateTracker = ResourceStateTracker();
+
+	if (compiled.heapSize == 0) {
+		return;
+	}
+
+	// Render targets can only share a heap with other textures on resource heap tier 2
+	bool renderTargets = false;
+	bool otherTextures = false;
+	UINT64 alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+	for (size_t i = 0; i < compiled.heapOffsets.size(); ++i) {
+		if (compiled.heapOffsets[i] != RenderGraph::invalidOffset) {
+			renderTargets |= isRenderTarget(descs[i]);
+			otherTextures |= !isRenderTarget(descs[i]);
+			alignment = std::max(alignment, pDevice->GetResourceAllocationInfo(0, 1, &descs[i]).Alignment);
+		}
+	}
+
+	D3D12_HEAP_FLAGS heapFlags = renderTargets ? D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES : D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+	if (renderTargets && otherTextures) {
+		D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+		GFXTHROWIFFAILED(pDevice->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)));
+		if (options.ResourceHeapTier < D3D12_RESOURCE_HEAP_TIER_2) {
+			ThrowException("Render graph mixes render targets with other transient textures, which needs resource heap tier 2");
+		}
+		heapFlags = D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES;
+	}
+
+	CD3DX12_HEAP_DESC heapDesc((compiled.heapSize + alignment - 1) / alignment * alignment, D3D12_HEAP_TYPE_DEFAULT, alignment, heapFlags);
+	GFXTHROWIFFAILED(pDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&pHeap)));
+
+	for (size_t i = 0; i < compiled.heapOffsets.size(); ++i) {
+		if (compiled.heapOffsets[i] != RenderGraph::invalidOffset) {
+			GFXTHROWIFFAILED(pDevice->CreatePlacedResource(
+				pHeap.Get(),
+				compiled.heapOffsets[i],
+				&descs[i],
+				static_cast<D3D12_RESOURCE_STATES>(compiled.initialStates[i]),
+				nullptr,
+				IID_PPV_ARGS(&resources[i])));
+			stateTracker.setState(resources[i].Get(), compiled.initialStates[i]);
+		}
+	}
+}
+
+void Engine::RenderGraphExecutor::setImportedResource(Handle resource, wrl::ComPtr<ID3D12Resource> pResource)
+{
+	if (resources[resource]) {
+		stateTracker.forget(resources[resource].Get());
+	}
+	resources[resource] = pResource;
+}
+
+wrl::ComPtr<ID3D12Resource> Engine::RenderGraphExecutor::getResource(Handle resource) const
+{
+	return resources[resource];
+}
+
+void Engine::RenderGraphExecutor::execute(wrl::ComPtr<ID3D12GraphicsCommandList4> pCommandList)
+{
+	for (size_t i = 0; i < resources.size(); ++i) {
+		if (resources[i] && !graph.isTransient(i)) {
+			stateTracker.setState(resources[i].Get(), compiled.initialStates[i]);
+		}
+	}
+
+	for (const RenderGraph::Step& step : compiled.steps) {
+		recordBarriers(pCommandList, step.barriers, false);
+
+		for (Handle pass : step.passes) {
+			passFunctions[pass](pCommandList);
+		}
+	}
+
+	// Whoever uses the imported resources next expects exactly their final states
+	recordBarriers(pCommandList, compiled.finalBarriers, true);
+}
+
+const Util::RenderGraph::Compiled& Engine::RenderGraphExecutor::getCompiled() const
+{
+	return compiled;
+}
+
+void Engine::RenderGraphExecutor::recordBarriers(wrl::ComPtr<ID3D12GraphicsCommandList4> pCommandList, const std::vector<Util::RenderGraph::Barrier>& barriers, bool exactly)
+{
+	// The tracker works out the before states itself and drops transitions a merged read state already covers
+	for (const RenderGraph::Barrier& barrier : barriers) {
+		ID3D12Resource* pResource = resources[barrier.resource].Get();
+
+		if (barrier.type == RenderGraph::Barrier::Aliasing) {
+			stateTracker.aliasingBarrier(pResource);
+		}
+		else if (exactly) {
+			stateTracker.transitionExactly(pResource, barrier.after);
+		}
+		else {
+			stateTracker.transition(pResource, barrier.after);
+		}
+	}
+
+	DXUtil::flushBarriers(pCommandList, stateTracker);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#define NOMINMAX
+
+#include <d3d12.h>
+#include <wrl/client.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Util/RenderGraph.h"
+#include "Util/ResourceStateTracker.h"
+
+namespace Engine {
+	// Runs a Util::RenderGraph on a direct command list. Creates the transient textures as placed resources in one heap,
+	// at the offsets the compiled graph gives them, and records every step's barriers through a ResourceStateTracker
+	// with a single ResourceBarrier call before calling its passes.
+	class RenderGraphExecutor {
+	public:
+		using Handle = Util::RenderGraph::Handle;
+		using PassFunction = std::function<void(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4>)>;
+
+		RenderGraphExecutor(Microsoft::WRL::ComPtr<ID3D12Device5> pDevice);
+		RenderGraphExecutor(const RenderGraphExecutor&) = delete;
+		RenderGraphExecutor& operator=(const RenderGraphExecutor&) = delete;
+
+		// Transient texture, its contents don't survive from one frame to the next
+		Handle createTexture(const std::string& name, const D3D12_RESOURCE_DESC& desc);
+		Handle addPass(const std::string& name, PassFunction function);
+		// Accesses and imported resources are declared on the graph directly
+		Util::RenderGraph& getGraph();
+
+		// Call once all passes are added, creates the transient textures
+		void compile();
+
+		// Imported resources can change from frame to frame (ex. the back buffer)
+		void setImportedResource(Handle resource, Microsoft::WRL::ComPtr<ID3D12Resource> pResource);
+		Microsoft::WRL::ComPtr<ID3D12Resource> getResource(Handle resource) const;
+
+		void execute(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList);
+
+		const Util::RenderGraph::Compiled& getCompiled() const;
+
+	private:
+		void recordBarriers(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList, const std::vector<Util::RenderGraph::Barrier>& barriers, bool exactly);
+
+		Microsoft::WRL::ComPtr<ID3D12Device5> pDevice;
+		Util::RenderGraph graph;
+		Util::RenderGraph::Compiled compiled;
+
+		// Per graph resource and pass
+		std::vector<D3D12_RESOURCE_DESC> descs;
+		std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> resources;
+		std::vector<PassFunction> passFunctions;
+
+		Microsoft::WRL::ComPtr<ID3D12Heap> pHeap;
+		// Transients keep their states from frame to frame, imported resources are set at the start of every frame
+		Util::ResourceStateTracker stateTracker;
+	};
+}
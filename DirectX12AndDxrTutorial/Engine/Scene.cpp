@@ -1,93 +1,206 @@
 #include "Scene.h"
 
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+#include <unordered_map>
+
 #include "Exception/Exception.h"
+#include "SceneCache.h"
+#include "ObjParser.h"
+#include "TextureAtlas.h"
+#include "TextureCache.h"
+#include "Util/GeometryDeduplicator.h"
+#include "Util/ThreadPool.h"
 
-#include "Libraries/tinyobjloader/tiny_obj_loader.h"
 #include "Libraries/stb/stb_image.h"
 
 using namespace std;
 using namespace Engine;
 
+namespace {
+	// Final form of a texture on the GPU
+	void buildMipsAndCompress(Texture& texture)
+	{
+		texture.generateMipChain();
+		// BC1 for opaque textures (8:1), BC7 keeps alpha (4:1)
+		texture.compress(texture.isOpaque() ? Texture::BC1 : Texture::BC7);
+	}
+
+	static_assert(sizeof(DirectX::XMFLOAT3) == sizeof(Util::GeometryDeduplicator::Position), "Vertices are passed to GeometryDeduplicator as they are");
+
+	const Util::GeometryDeduplicator::Position* asPositions(const vector<DirectX::XMFLOAT3>& vertices)
+	{
+		return reinterpret_cast<const Util::GeometryDeduplicator::Position*>(vertices.data());
+	}
+
+	// Everything besides the positions that copies have to share
+	std::uint64_t hashShapeData(const DirectX::XMFLOAT2* texVertices, const Shaders::FaceAttributes* faceAttributes, size_t faceCount)
+	{
+		std::uint64_t hash = Util::GeometryDeduplicator::hash(Util::GeometryDeduplicator::hashSeed, texVertices, faceCount * 3 * sizeof(DirectX::XMFLOAT2));
+		for (size_t i = 0; i < faceCount; ++i) {
+			hash = Util::GeometryDeduplicator::hash(hash, &faceAttributes[i].materialId, sizeof(faceAttributes[i].materialId));
+		}
+
+		return hash;
+	}
+
+	bool isSameShapeData(const DirectX::XMFLOAT2* texVerticesA, const Shaders::FaceAttributes* faceAttributesA,
+		const DirectX::XMFLOAT2* texVerticesB, const Shaders::FaceAttributes* faceAttributesB, size_t faceCount)
+	{
+		if (memcmp(texVerticesA, texVerticesB, faceCount * 3 * sizeof(DirectX::XMFLOAT2)) != 0) {
+			return false;
+		}
+
+		for (size_t i = 0; i < faceCount; ++i) {
+			if (faceAttributesA[i].materialId != faceAttributesB[i].materialId) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
 void Engine::Scene::loadScene(const string& pathToObj)
 {
-	using namespace  tinyobj;
-
-	// may be redundant
-	std::vector<std::vector<DirectX::XMFLOAT3>> vertices;
+	shapes.clear();
+	meshes.clear();
 	texVertices.clear();
 	faceAttributes.clear();
 	lights.clear();
 	materials.clear();
 	textures.clear();
+	textureCacheSources.clear();
+	sceneCacheFile.reset();
+	textureCacheFiles.clear();
+	sourceFiles.clear();
+
+	{
+		SceneCache sceneCache(pathToObj);
+		if (sceneCache.isValid()) {
+			loadSceneCache(sceneCache);
+			buildSceneGraph();
+			return;
+		}
+		// Stale cache is unmapped here, before it is overwritten
+	}
+
+	loadObj(pathToObj);
+	buildSceneGraph();
+
+	if (!SceneCache::write(pathToObj, *this)) {
+		cout << "Could not write scene cache for " << pathToObj << endl;
+		return;
+	}
 
-	attrib_t attr = {};
-	vector<shape_t> shapes;
-	vector<material_t> materials;
-	string warn, err;
-	LoadObj(&attr, &shapes, &materials, &warn, &err, pathToObj.c_str());
+	// The atlases (and the textures without a texture cache) are in the scene cache now. Reading them from its mapping instead
+	// of keeping the heap copies lets the OS drop the pages, and the GPU uploads copy from the mapping straight into the staging buffers.
+	// The other textures were already swapped for their texture cache mappings as they were finished.
+	SceneCache sceneCache(pathToObj);
+	if (sceneCache.isValid()) {
+		mapCachedTextures(sceneCache);
+	}
+}
 
-	int diffTexId = 0;
-	for (const auto& material : materials) {
-		int currentDiffTexId = material.diffuse_texname.length() ? diffTexId++ : -1;
-		if (currentDiffTexId >= 0) {
-			textures.emplace_back(material.diffuse_texname);
+void Engine::Scene::loadObj(const string& pathToObj)
+{
+	const ObjData objData = ObjParser::parse(pathToObj);
+
+	// Materials referencing the same image file share one texture
+	unordered_map<string, int> textureIds;
+	vector<string> textureFileNames;
+	for (const auto& material : objData.materials) {
+		int currentDiffTexId = -1;
+		if (material.diffuseTextureName.length()) {
+			const auto it = textureIds.emplace(getTextureKey(material.diffuseTextureName), static_cast<int>(textureFileNames.size())).first;
+			if (it->second == static_cast<int>(textureFileNames.size())) {
+				textureFileNames.push_back(material.diffuseTextureName);
+			}
+			currentDiffTexId = it->second;
 		}
 
 		this->materials.push_back(Shaders::Material{
 			DirectX::XMFLOAT4(material.diffuse[0], material.diffuse[1], material.diffuse[2], 1.f),
 			DirectX::XMFLOAT4(material.emission[0],material.emission[1],material.emission[2], 0.f),
-			currentDiffTexId
+			currentDiffTexId,
+			{},
+			TextureAtlas::identityTransform
 		});
 	}
 
-	vertices.resize(shapes.size());
+	sourceFiles = objData.materialLibraries;
+	sourceFiles.insert(sourceFiles.end(), textureFileNames.begin(), textureFileNames.end());
+
+	// Point materials at the (possibly atlased) textures
+	const auto placements = loadTextures(textureFileNames);
+	for (auto& material : this->materials) {
+		if (material.diffuseTextureId >= 0) {
+			const auto& placement = placements[material.diffuseTextureId];
+			material.diffuseTextureId = placement.textureIndex;
+			material.diffuseTextureTransform = placement.transform;
+		}
+	}
+
+	const auto& attrVertices = objData.vertices;
+	const auto& attrTexcoords = objData.texcoords;
+
 	size_t totalFaceCount = 0;
 	size_t shapeNum = 0;
 
+	texVertices.reserve(objData.indices.size());
+	faceAttributes.reserve(objData.materialIds.size());
+
+	// Non emissive meshes, to find groups that are translated copies of each other
+	Util::GeometryDeduplicator deduplicator;
+
 	// for each shape
-	for (const auto& shape : shapes) {
-		size_t index = 0;
-		size_t faceNum = 0;
-		
-		faceOffsets.push_back(totalFaceCount);
+	for (const auto& shape : objData.shapes) {
+		std::vector<DirectX::XMFLOAT3> vertices;
+		vertices.reserve(shape.faceCount * 3);
+
+		const size_t meshFaceOffset = totalFaceCount;
+		bool hasEmissiveFaces = false;
 
 		// for each face
-		for (const auto& vertexCountForFace : shape.mesh.num_face_vertices) {
-			if (vertexCountForFace != 3) {
-				ThrowException("Not loading a triangle");
+		for (size_t faceNum = shape.faceOffset; faceNum < shape.faceOffset + shape.faceCount; ++faceNum) {
+			const int materialId = objData.materialIds[faceNum];
+			if (materialId < 0) {
+				ThrowException("Face without a material");
 			}
-			
-			const int materialId = shape.mesh.material_ids[faceNum];
 
 			const auto& em = this->materials[materialId].emission;
 			bool isEmissive = !(em.x == em.y && em.y == em.z && em.z == em.w && em.w == 0.f);
 			Shaders::AreaLight areaLight = {};
 
 			// for each vertex in face
-			for (size_t v = 0; v < vertexCountForFace; ++v) {
-				int vertexIndex = shape.mesh.indices[index + v].vertex_index;
-				size_t vertexLocation = 3 * static_cast<size_t>(vertexIndex);
+			for (size_t v = 0; v < 3; ++v) {
+				const ObjIndex& index = objData.indices[faceNum * 3 + v];
+				size_t vertexLocation = 3 * static_cast<size_t>(index.vertexIndex);
 
 				DirectX::XMFLOAT3 vertex = DirectX::XMFLOAT3(
-					attr.vertices[vertexLocation],
-					attr.vertices[vertexLocation + 1],
-					attr.vertices[vertexLocation + 2]);
+					attrVertices[vertexLocation],
+					attrVertices[vertexLocation + 1],
+					attrVertices[vertexLocation + 2]);
 
-				vertices[shapeNum].push_back(vertex);
+				vertices.push_back(vertex);
 
-				int texIndex = shape.mesh.indices[index + v].texcoord_index;
+				int texIndex = index.texcoordIndex;
 				if (texIndex == -1) {
 					texVertices.emplace_back(0.f, 0.f);
 				}
 				else {
 					size_t texLocation = 2 * static_cast<size_t>(texIndex);
 					// invert texture vertically as is commonly done in OBJ
-					DirectX::XMFLOAT2 texVertex = DirectX::XMFLOAT2(attr.texcoords[texLocation], 1.f - attr.texcoords[texLocation + 1]);
+					DirectX::XMFLOAT2 texVertex = DirectX::XMFLOAT2(attrTexcoords[texLocation], 1.f - attrTexcoords[texLocation + 1]);
 					texVertices.push_back(texVertex);
 				}
 			}
 
 			if (isEmissive) {
+				hasEmissiveFaces = true;
 				areaLight.instanceIndex = shapeNum;
 				areaLight.primitiveId = totalFaceCount;
 				areaLight.materialId = materialId;
@@ -100,18 +213,223 @@ void Engine::Scene::loadScene(const string& pathToObj)
 				static_cast<std::uint32_t>(materialId), 
 				static_cast<std::uint32_t>(isEmissive ? lights.size() - 1 : 0) });
 
-			index += vertexCountForFace;
-			++faceNum;
 			++totalFaceCount;
 		}
 
+		// Lights refer to their own instance and faces, so only non emissive geometry is shared
+		const bool shareable = !hasEmissiveFaces && !vertices.empty();
+		const size_t faceCount = vertices.size() / 3;
+		const uint64_t dataHash = hashShapeData(texVertices.data() + meshFaceOffset * 3, faceAttributes.data() + meshFaceOffset, faceCount);
+		size_t meshIndex = meshes.size();
+		if (shareable) {
+			const size_t found = deduplicator.find(asPositions(vertices), vertices.size(), dataHash, [&](size_t other) {
+				const Mesh& mesh = meshes[other];
+				return isSameShapeData(texVertices.data() + mesh.faceOffset * 3, faceAttributes.data() + mesh.faceOffset,
+									   texVertices.data() + meshFaceOffset * 3, faceAttributes.data() + meshFaceOffset, faceCount);
+			});
+			if (found != Util::GeometryDeduplicator::notFound) {
+				meshIndex = found;
+			}
+		}
+
 		// Initialise shape object
-		this->shapes.emplace_back(shape.name, move(vertices[shapeNum]));
+		if (meshIndex == meshes.size()) {
+			this->shapes.emplace_back(shape.name, meshIndex, vertices);
+			meshes.push_back({ move(vertices), meshFaceOffset });
+
+			// The vertices stay in the mesh (moving meshes around keeps their buffers where they are)
+			if (shareable) {
+				deduplicator.add(meshIndex, asPositions(meshes.back().vertices), meshes.back().vertices.size(), dataHash);
+			}
+		}
+		else {
+			// Drop the copy's faces, the instance uses the mesh's
+			texVertices.resize(meshFaceOffset * 3);
+			faceAttributes.resize(meshFaceOffset);
+			totalFaceCount = meshFaceOffset;
+
+			const Mesh& mesh = meshes[meshIndex];
+			const DirectX::XMFLOAT3 translation(vertices[0].x - mesh.vertices[0].x, vertices[0].y - mesh.vertices[0].y, vertices[0].z - mesh.vertices[0].z);
+			this->shapes.emplace_back(shape.name, meshIndex, mesh.vertices, translation);
+		}
 
 		++shapeNum;
 	}
 }
 
+std::vector<TextureAtlas::Placement> Engine::Scene::loadTextures(const std::vector<std::string>& fileNames)
+{
+	// Images with an up to date texture cache are mapped, the others are decoded concurrently (stbi_load does not share state between calls)
+	vector<unique_ptr<Texture>> decodedTextures(fileNames.size());
+	vector<shared_ptr<Util::MappedFile>> cacheFiles(fileNames.size());
+	// Texture caches that hold the final form, the scene cache refers to these instead of storing the texture again
+	vector<char> hasFinalCache(fileNames.size());
+	Util::ThreadPool::getDefault().parallelFor(fileNames.size(), [&](size_t i) {
+		TextureCache textureCache(fileNames[i]);
+		if (textureCache.isValid()) {
+			decodedTextures[i] = textureCache.createTexture();
+			cacheFiles[i] = textureCache.getMappedFile();
+			hasFinalCache[i] = !TextureAtlas::isPackable(*decodedTextures[i]);
+			return;
+		}
+
+		decodedTextures[i] = make_unique<Texture>(fileNames[i]);
+		auto& texture = *decodedTextures[i];
+		if (!texture.data) {
+			return;
+		}
+
+		// Atlas candidates are cached as decoded, the others in their final form
+		if (!TextureAtlas::isPackable(texture)) {
+			buildMipsAndCompress(texture);
+		}
+
+		if (!TextureCache::write(fileNames[i], texture)) {
+			cout << ("Could not write texture cache for " + fileNames[i] + "\n");
+			return;
+		}
+
+		hasFinalCache[i] = !TextureAtlas::isPackable(texture);
+		if (!hasFinalCache[i]) {
+			return;
+		}
+
+		// Finished, so the decoded copy is dropped right away and the texture is read from the cache file like a cached one.
+		// Only the atlas candidates (which are small) are kept on the heap until the scene cache is written.
+		TextureCache writtenCache(fileNames[i]);
+		if (writtenCache.isValid()) {
+			decodedTextures[i] = writtenCache.createTexture();
+			cacheFiles[i] = writtenCache.getMappedFile();
+		}
+	});
+
+	for (auto& cacheFile : cacheFiles) {
+		if (cacheFile) {
+			textureCacheFiles.push_back(move(cacheFile));
+		}
+	}
+
+	// Small textures share atlases (which come with their own, shorter, mip chains)
+	auto placements = TextureAtlas::pack(decodedTextures);
+
+	// Does nothing for textures that are already in their final form
+	Util::ThreadPool::getDefault().parallelFor(decodedTextures.size(), [&](size_t i) {
+		buildMipsAndCompress(*decodedTextures[i]);
+	});
+
+	const int firstTextureIndex = static_cast<int>(textures.size());
+	for (auto& placement : placements) {
+		placement.textureIndex += firstTextureIndex;
+	}
+
+	textures.reserve(textures.size() + decodedTextures.size());
+	for (auto& texture : decodedTextures) {
+		textures.push_back(move(*texture));
+	}
+
+	textureCacheSources.resize(textures.size());
+	for (size_t i = 0; i < fileNames.size(); ++i) {
+		if (hasFinalCache[i]) {
+			textureCacheSources[placements[i].textureIndex] = fileNames[i];
+		}
+	}
+
+	return placements;
+}
+
+std::string Engine::Scene::getTextureKey(const std::string& fileName)
+{
+	error_code ec;
+	const auto canonicalPath = filesystem::weakly_canonical(fileName, ec);
+	return ec ? fileName : canonicalPath.string();
+}
+
+void Engine::Scene::buildSceneGraph()
+{
+	sceneGraph.clear();
+	shapeNodes.clear();
+
+	const size_t root = sceneGraph.addNode("Scene");
+	for (size_t i = 0; i < shapes.size(); ++i) {
+		shapeNodes.push_back(sceneGraph.addNode(shapes[i].getName(), root, i, shapes[i].getTransform()));
+	}
+
+	sceneGraph.update();
+}
+
+void Engine::Scene::loadSceneCache(const SceneCache& sceneCache)
+{
+	const auto* meshEntries = sceneCache.getSection<SceneCache::MeshEntry>(SceneCache::MeshTable);
+	const auto* cachedVertices = sceneCache.getSection<DirectX::XMFLOAT3>(SceneCache::Vertices);
+
+	for (size_t i = 0; i < sceneCache.getSectionCount(SceneCache::MeshTable); ++i) {
+		const auto& entry = meshEntries[i];
+		const DirectX::XMFLOAT3* meshVertices = cachedVertices + entry.vertexOffset;
+		meshes.push_back({ vector<DirectX::XMFLOAT3>(meshVertices, meshVertices + entry.vertexCount), static_cast<size_t>(entry.faceOffset) });
+	}
+
+	const auto* shapeEntries = sceneCache.getSection<SceneCache::ShapeEntry>(SceneCache::ShapeTable);
+	const auto* shapeNames = sceneCache.getSection<char>(SceneCache::ShapeNames);
+
+	for (size_t i = 0; i < sceneCache.getSectionCount(SceneCache::ShapeTable); ++i) {
+		const auto& entry = shapeEntries[i];
+		const size_t meshIndex = static_cast<size_t>(entry.meshIndex);
+
+		shapes.emplace_back(
+			string(shapeNames + entry.nameOffset, static_cast<size_t>(entry.nameLength)),
+			meshIndex,
+			meshes[meshIndex].vertices,
+			DirectX::XMFLOAT3(entry.translation[0], entry.translation[1], entry.translation[2]));
+	}
+
+	const auto* cachedTexVertices = sceneCache.getSection<DirectX::XMFLOAT2>(SceneCache::TextureVertices);
+	texVertices.assign(cachedTexVertices, cachedTexVertices + sceneCache.getSectionCount(SceneCache::TextureVertices));
+
+	const auto* cachedFaceAttributes = sceneCache.getSection<Shaders::FaceAttributes>(SceneCache::FaceAttributes);
+	faceAttributes.assign(cachedFaceAttributes, cachedFaceAttributes + sceneCache.getSectionCount(SceneCache::FaceAttributes));
+
+	const auto* cachedLights = sceneCache.getSection<Shaders::AreaLight>(SceneCache::Lights);
+	lights.assign(cachedLights, cachedLights + sceneCache.getSectionCount(SceneCache::Lights));
+
+	const auto* cachedMaterials = sceneCache.getSection<Shaders::Material>(SceneCache::Materials);
+	materials.assign(cachedMaterials, cachedMaterials + sceneCache.getSectionCount(SceneCache::Materials));
+
+	const auto* dependencyEntries = sceneCache.getSection<SceneCache::DependencyEntry>(SceneCache::Dependencies);
+	const auto* dependencyPaths = sceneCache.getSection<char>(SceneCache::DependencyPaths);
+	for (size_t i = 0; i < sceneCache.getSectionCount(SceneCache::Dependencies); ++i) {
+		sourceFiles.emplace_back(dependencyPaths + dependencyEntries[i].pathOffset, static_cast<size_t>(dependencyEntries[i].pathLength));
+	}
+
+	// Textures are not copied, they point directly into the mapped file
+	mapCachedTextures(sceneCache);
+}
+
+void Engine::Scene::mapCachedTextures(const SceneCache& sceneCache)
+{
+	textures.clear();
+	textureCacheSources.clear();
+	textureCacheFiles.clear();
+
+	sceneCacheFile = sceneCache.getMappedFile();
+	const auto* textureEntries = sceneCache.getSection<SceneCache::TextureEntry>(SceneCache::TextureTable);
+	const auto* textureData = sceneCache.getSection<std::uint8_t>(SceneCache::TextureData);
+	for (size_t i = 0; i < sceneCache.getSectionCount(SceneCache::TextureTable); ++i) {
+		const auto& entry = textureEntries[i];
+		unsigned char* data = entry.dataSize > 0 ? const_cast<unsigned char*>(textureData + entry.dataOffset) : nullptr;
+
+		// Textures stored in the texture cache of their image are read from there
+		textureCacheSources.emplace_back();
+		if (entry.sourceIndex >= 0) {
+			auto textureCacheFile = sceneCache.getTextureCacheFile(i);
+			data = const_cast<unsigned char*>(textureCacheFile->getData() + reinterpret_cast<const TextureCache::Header*>(textureCacheFile->getData())->dataOffset);
+			textureCacheSources.back() = sourceFiles[entry.sourceIndex];
+			textureCacheFiles.push_back(move(textureCacheFile));
+		}
+
+		textures.emplace_back(entry.width, entry.height, entry.channels, Texture::StbImagePtr(data, Texture::nonOwningDeleter), entry.mipLevelCount, static_cast<Texture::Format>(entry.format));
+	}
+}
+
 void Engine::Scene::transformLightPosition(const DirectX::XMMATRIX& mat)
 {
 	for (auto& light : lights) {
@@ -123,17 +441,48 @@ void Engine::Scene::transformLightPosition(const DirectX::XMMATRIX& mat)
 
 void Engine::Scene::flattenGroups()
 {
-	auto verts = getFlattenedVertices();
+	// Every instance gets its own copy of the mesh's faces, with its transform baked in
+	vector<DirectX::XMFLOAT3> verts;
+	vector<DirectX::XMFLOAT2> flatTexVertices;
+	vector<Shaders::FaceAttributes> flatFaceAttributes;
+	for (size_t i = 0; i < shapes.size(); ++i) {
+		const Mesh& mesh = meshes[shapes[i].getMeshIndex()];
+		const size_t faceCount = mesh.vertices.size() / 3;
+		const size_t flatFaceOffset = flatFaceAttributes.size();
+
+		const DirectX::XMFLOAT3X4 transform = shapes[i].getTransform();
+		const DirectX::XMMATRIX matrix = DirectX::XMLoadFloat3x4(&transform);
+		for (const auto& vertex : mesh.vertices) {
+			DirectX::XMFLOAT3 transformed;
+			DirectX::XMStoreFloat3(&transformed, DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&vertex), matrix));
+			verts.push_back(transformed);
+		}
+
+		flatTexVertices.insert(flatTexVertices.end(), texVertices.begin() + mesh.faceOffset * 3, texVertices.begin() + (mesh.faceOffset + faceCount) * 3);
+		flatFaceAttributes.insert(flatFaceAttributes.end(), faceAttributes.begin() + mesh.faceOffset, faceAttributes.begin() + mesh.faceOffset + faceCount);
+
+		for (auto& light : lights) {
+			if (light.instanceIndex == i) {
+				light.primitiveId = static_cast<std::uint32_t>(flatFaceOffset + light.primitiveId - mesh.faceOffset);
+				light.instanceIndex = 0;
+			}
+		}
+	}
+
+	texVertices = move(flatTexVertices);
+	faceAttributes = move(flatFaceAttributes);
+	meshes.clear();
+	meshes.push_back({ move(verts), 0 });
 	shapes.clear();
-	shapes.emplace_back("Flattened Shape", move(verts));
+	shapes.emplace_back("Flattened Shape", 0, meshes[0].vertices);
+	buildSceneGraph();
 }
 
 std::vector<DirectX::XMFLOAT3> Engine::Scene::getFlattenedVertices() const
 {
 	std::vector<DirectX::XMFLOAT3> verts;
-	for (const auto& shape : shapes) {
-		const std::vector<DirectX::XMFLOAT3>& v = shape.getVertices();
-		verts.insert(verts.end(), v.begin(), v.end());
+	for (const auto& mesh : meshes) {
+		verts.insert(verts.end(), mesh.vertices.begin(), mesh.vertices.end());
 	}
 
 	return verts;
@@ -169,9 +518,34 @@ const std::vector<Shape>& Engine::Scene::getShapes() const
 	return shapes;
 }
 
-const std::vector<size_t>& Engine::Scene::getFaceOffsets() const
+const std::vector<Mesh>& Engine::Scene::getMeshes() const
+{
+	return meshes;
+}
+
+const std::vector<std::string>& Engine::Scene::getSourceFiles() const
+{
+	return sourceFiles;
+}
+
+const std::vector<std::string>& Engine::Scene::getTextureCacheSources() const
+{
+	return textureCacheSources;
+}
+
+Engine::SceneGraph& Engine::Scene::getSceneGraph()
+{
+	return sceneGraph;
+}
+
+const Engine::SceneGraph& Engine::Scene::getSceneGraph() const
+{
+	return sceneGraph;
+}
+
+std::size_t Engine::Scene::getShapeNode(std::size_t shapeIndex) const
 {
-	return faceOffsets;
+	return shapeNodes[shapeIndex];
 }
 
 Shaders::AreaLight& Engine::Scene::getLight(std::size_t index)
@@ -2,19 +2,29 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 
 #include <DirectXMath.h>
 #include "Engine/Texture.h"
+#include "Engine/TextureAtlas.h"
 #include "Engine/Shape.h"
+#include "Engine/SceneGraph.h"
 
 #include "../Shaders/RTShaders.hlsli"
 
+namespace Util {
+	class MappedFile;
+}
+
 namespace Engine {
+	class SceneCache;
+
 	class Scene {
 	public:
 		Scene() = default;
 		virtual ~Scene() = default;
 
+		// Loads from the binary scene cache if it is up to date, otherwise parses the OBJ and (re)writes the cache
 		void loadScene(const std::string& pathToObj);
 
 		// Transform virtual light sources' position
@@ -22,6 +32,7 @@ namespace Engine {
 
 		// Flatten shapes found into obj into one big shape
 		void flattenGroups();
+		// Vertices of all meshes, in face order
 		std::vector<DirectX::XMFLOAT3> getFlattenedVertices() const;
 
 		const std::vector<DirectX::XMFLOAT2>& getTextureVertices() const;
@@ -30,14 +41,42 @@ namespace Engine {
 		const std::vector<Shaders::Material>& getMaterials() const;
 		const std::vector<Engine::Texture>& getTextures() const;
 		const std::vector<Shape>& getShapes() const;
-		const std::vector<size_t>& getFaceOffsets() const;
+		const std::vector<Mesh>& getMeshes() const;
+		// MTL libraries and images the scene was built from
+		const std::vector<std::string>& getSourceFiles() const;
+		// Per texture, the image whose texture cache holds the texture's final form (empty if there is none)
+		const std::vector<std::string>& getTextureCacheSources() const;
 		Shaders::AreaLight& getLight(std::size_t index);
 		Shape& getShape(std::size_t index);
+		// Node of every shape lies below a single root node
+		SceneGraph& getSceneGraph();
+		const SceneGraph& getSceneGraph() const;
+		std::size_t getShapeNode(std::size_t shapeIndex) const;
 	
 	private:
+		void loadObj(const std::string& pathToObj);
+		void loadSceneCache(const SceneCache& sceneCache);
+		// Replaces the textures with views into the cache file's texture data, dropping any decoded copies
+		void mapCachedTextures(const SceneCache& sceneCache);
+		// Decodes the images in parallel (or maps their texture caches), packs the small ones into atlases,
+		// then builds and block compresses the mip chains. Appends the results to textures and returns where each image ended up.
+		std::vector<TextureAtlas::Placement> loadTextures(const std::vector<std::string>& fileNames);
+		// Canonical path, so that different spellings of the same file map to one texture
+		static std::string getTextureKey(const std::string& fileName);
+		// One node per shape, with the shape's transform and the shape as its instance
+		void buildSceneGraph();
+
+		// Keeps cache file mapped while textures point into it
+		std::shared_ptr<Util::MappedFile> sceneCacheFile;
+		// Same for texture cache files
+		std::vector<std::shared_ptr<Util::MappedFile>> textureCacheFiles;
 
+		// Shapes are instances of meshes, groups that are translated copies of each other share a mesh
 		std::vector<Shape> shapes;
-		std::vector<size_t> faceOffsets;
+		std::vector<Mesh> meshes;
+
+		SceneGraph sceneGraph;
+		std::vector<std::size_t> shapeNodes;
 		
 		std::vector<DirectX::XMFLOAT2> texVertices;
 
@@ -45,7 +84,10 @@ namespace Engine {
 		std::vector<Shaders::AreaLight> lights;
 		
 		std::vector<Engine::Texture> textures;
+		std::vector<std::string> textureCacheSources;
 
 		std::vector<Shaders::Material> materials;
+
+		std::vector<std::string> sourceFiles;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,418 @@
+#include "SceneCache.h"
+
+#include "Scene.h"
+#include "TextureCache.h"
+
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+#include <unordered_map>
+
+using namespace std;
+using namespace Engine;
+
+namespace {
+	const char sceneCacheMagic[4] = { 'D', 'X', 'R', 'S' };
+
+	constexpr std::uint64_t sectionAlignment = 16;
+
+	std::uint64_t alignOffset(std::uint64_t offset)
+	{
+		return (offset + sectionAlignment - 1) & ~(sectionAlignment - 1);
+	}
+
+	// Size of a single element for each section, used to bounds check the file
+	constexpr std::size_t sectionElementSizes[SceneCache::SectionCount] = {
+		sizeof(SceneCache::ShapeEntry),
+		sizeof(char),
+		sizeof(SceneCache::MeshEntry),
+		sizeof(DirectX::XMFLOAT3),
+		sizeof(DirectX::XMFLOAT2),
+		sizeof(Shaders::FaceAttributes),
+		sizeof(Shaders::AreaLight),
+		sizeof(Shaders::Material),
+		sizeof(SceneCache::TextureEntry),
+		sizeof(std::uint8_t),
+		sizeof(SceneCache::DependencyEntry),
+		sizeof(char)
+	};
+
+	// True if the offset/length pair lies inside [0, count), without overflowing on corrupt values
+	bool isRangeInside(std::uint64_t offset, std::uint64_t length, std::uint64_t count)
+	{
+		return offset <= count && length <= count - offset;
+	}
+}
+
+Engine::SceneCache::SceneCache(const std::string& pathToObj)
+	: pathToObj(pathToObj), valid()
+{
+	const string cacheFileName = getCacheFileName(pathToObj);
+
+	error_code ec;
+	if (!filesystem::exists(cacheFileName, ec)) {
+		return;
+	}
+
+	SourceStamp stamp;
+	if (!getSourceStamp(pathToObj, stamp)) {
+		return;
+	}
+
+	mappedFile = make_shared<Util::MappedFile>(cacheFileName);
+
+	if (mappedFile->getSize() < sizeof(Header)) {
+		return;
+	}
+
+	const Header& header = getHeader();
+	if (memcmp(header.magic, sceneCacheMagic, sizeof(sceneCacheMagic)) != 0 || header.version != version || !validateSections()) {
+		return;
+	}
+
+	// Fast path: untouched source. Otherwise accept the cache only if the contents are unchanged (ex. after a checkout).
+	const bool sourceUnchanged = (header.sourceSize == stamp.size && header.sourceWriteTime == stamp.writeTime) ||
+								 (header.sourceSize == stamp.size && header.sourceHash == hashFile(pathToObj));
+	valid = sourceUnchanged && validateDependencies() && mapTextureCaches();
+}
+
+bool Engine::SceneCache::isValid() const
+{
+	return valid;
+}
+
+std::size_t Engine::SceneCache::getSectionCount(Section section) const
+{
+	return static_cast<std::size_t>(getHeader().sections[section].count);
+}
+
+const SceneCache::Header& Engine::SceneCache::getHeader() const
+{
+	return *reinterpret_cast<const Header*>(mappedFile->getData());
+}
+
+std::shared_ptr<Util::MappedFile> Engine::SceneCache::getMappedFile() const
+{
+	return mappedFile;
+}
+
+std::shared_ptr<Util::MappedFile> Engine::SceneCache::getTextureCacheFile(std::size_t textureIndex) const
+{
+	return textureCacheFiles[textureIndex];
+}
+
+bool Engine::SceneCache::write(const std::string& pathToObj, const Scene& scene)
+{
+	SourceStamp stamp;
+	if (!getSourceStamp(pathToObj, stamp)) {
+		return false;
+	}
+
+	const auto& shapes = scene.getShapes();
+	const auto& meshes = scene.getMeshes();
+	const auto& textures = scene.getTextures();
+
+	// Build tables
+	vector<ShapeEntry> shapeEntries;
+	string shapeNames;
+	for (const auto& shape : shapes) {
+		const auto& translation = shape.getTranslation();
+		shapeEntries.push_back({ shapeNames.size(), shape.getName().size(), shape.getMeshIndex(), { translation.x, translation.y, translation.z }, 0 });
+		shapeNames += shape.getName();
+	}
+
+	vector<MeshEntry> meshEntries;
+	uint64_t vertexCount = 0;
+	for (const auto& mesh : meshes) {
+		meshEntries.push_back({ vertexCount, mesh.vertices.size(), mesh.faceOffset });
+		vertexCount += mesh.vertices.size();
+	}
+
+
+	vector<DependencyEntry> dependencyEntries;
+	string dependencyPaths;
+	for (const auto& fileName : scene.getSourceFiles()) {
+		DependencyEntry entry = { dependencyPaths.size(), fileName.size() };
+		SourceStamp dependencyStamp;
+		if (getSourceStamp(fileName, dependencyStamp)) {
+			entry.size = dependencyStamp.size;
+			entry.writeTime = dependencyStamp.writeTime;
+			entry.hash = hashFile(fileName);
+		}
+		else {
+			entry.missing = 1;
+		}
+
+		dependencyEntries.push_back(entry);
+		dependencyPaths += fileName;
+	}
+
+	// Textures that are already stored in the texture cache of their image refer to it instead of being written again
+	unordered_map<string, int32_t> dependencyIndices;
+	for (size_t i = 0; i < scene.getSourceFiles().size(); ++i) {
+		dependencyIndices.emplace(scene.getSourceFiles()[i], static_cast<int32_t>(i));
+	}
+
+	vector<TextureEntry> textureEntries;
+	uint64_t textureDataSize = 0;
+	for (size_t i = 0; i < textures.size(); ++i) {
+		const auto& texture = textures[i];
+		const uint64_t dataSize = texture.data ? texture.getDataSize() : 0;
+		const auto source = dependencyIndices.find(scene.getTextureCacheSources()[i]);
+		if (source != dependencyIndices.end()) {
+			textureEntries.push_back({ texture.width, texture.height, texture.channels, texture.getMipLevelCount(), texture.getFormat(), source->second, 0, dataSize });
+			continue;
+		}
+
+		textureEntries.push_back({ texture.width, texture.height, texture.channels, texture.getMipLevelCount(), texture.getFormat(), -1, textureDataSize, dataSize });
+		textureDataSize = alignOffset(textureDataSize + dataSize);
+	}
+
+	// Lay out sections
+	Header header = {};
+	memcpy(header.magic, sceneCacheMagic, sizeof(sceneCacheMagic));
+	header.version = version;
+	header.sourceSize = stamp.size;
+	header.sourceWriteTime = stamp.writeTime;
+	header.sourceHash = hashFile(pathToObj);
+
+	const uint64_t counts[SectionCount] = {
+		shapeEntries.size(),
+		shapeNames.size(),
+		meshEntries.size(),
+		vertexCount,
+		scene.getTextureVertices().size(),
+		scene.getFaceAttributes().size(),
+		scene.getLights().size(),
+		scene.getMaterials().size(),
+		textureEntries.size(),
+		textureDataSize,
+		dependencyEntries.size(),
+		dependencyPaths.size()
+	};
+
+	uint64_t offset = alignOffset(sizeof(Header));
+	for (size_t i = 0; i < SectionCount; ++i) {
+		header.sections[i].offsetInBytes = offset;
+		header.sections[i].count = counts[i];
+		offset = alignOffset(offset + counts[i] * sectionElementSizes[i]);
+	}
+
+	// Write to a temporary file first, so that a partially written cache is never picked up
+	const string cacheFileName = getCacheFileName(pathToObj);
+	const string tempFileName = cacheFileName + ".tmp";
+	{
+		ofstream file(tempFileName, ios::binary | ios::trunc);
+		if (!file) {
+			return false;
+		}
+
+		auto writeAt = [&file](uint64_t offset, const void* data, size_t size) {
+			file.seekp(static_cast<streamoff>(offset));
+			if (size > 0) {
+				file.write(static_cast<const char*>(data), static_cast<streamsize>(size));
+			}
+		};
+
+		writeAt(0, &header, sizeof(header));
+		writeAt(header.sections[ShapeTable].offsetInBytes, shapeEntries.data(), shapeEntries.size() * sizeof(ShapeEntry));
+		writeAt(header.sections[ShapeNames].offsetInBytes, shapeNames.data(), shapeNames.size());
+		writeAt(header.sections[MeshTable].offsetInBytes, meshEntries.data(), meshEntries.size() * sizeof(MeshEntry));
+
+		uint64_t vertexOffset = header.sections[Vertices].offsetInBytes;
+		for (const auto& mesh : meshes) {
+			writeAt(vertexOffset, mesh.vertices.data(), mesh.vertices.size() * sizeof(DirectX::XMFLOAT3));
+			vertexOffset += mesh.vertices.size() * sizeof(DirectX::XMFLOAT3);
+		}
+
+		writeAt(header.sections[TextureVertices].offsetInBytes, scene.getTextureVertices().data(), scene.getTextureVertices().size() * sizeof(DirectX::XMFLOAT2));
+		writeAt(header.sections[FaceAttributes].offsetInBytes, scene.getFaceAttributes().data(), scene.getFaceAttributes().size() * sizeof(Shaders::FaceAttributes));
+		writeAt(header.sections[Lights].offsetInBytes, scene.getLights().data(), scene.getLights().size() * sizeof(Shaders::AreaLight));
+		writeAt(header.sections[Materials].offsetInBytes, scene.getMaterials().data(), scene.getMaterials().size() * sizeof(Shaders::Material));
+		writeAt(header.sections[TextureTable].offsetInBytes, textureEntries.data(), textureEntries.size() * sizeof(TextureEntry));
+
+		for (size_t i = 0; i < textures.size(); ++i) {
+			if (textureEntries[i].sourceIndex < 0) {
+				writeAt(header.sections[TextureData].offsetInBytes + textureEntries[i].dataOffset, textures[i].data.get(), textureEntries[i].dataSize);
+			}
+		}
+
+		writeAt(header.sections[Dependencies].offsetInBytes, dependencyEntries.data(), dependencyEntries.size() * sizeof(DependencyEntry));
+		writeAt(header.sections[DependencyPaths].offsetInBytes, dependencyPaths.data(), dependencyPaths.size());
+
+		// Pad to the full size, so that the last section is always inside the file
+		if (offset > header.sections[DependencyPaths].offsetInBytes + dependencyPaths.size()) {
+			const char zero = 0;
+			writeAt(offset - 1, &zero, 1);
+		}
+
+		if (!file) {
+			return false;
+		}
+	}
+
+	error_code ec;
+	filesystem::rename(tempFileName, cacheFileName, ec);
+	if (ec) {
+		filesystem::remove(tempFileName, ec);
+		return false;
+	}
+
+	return true;
+}
+
+std::string Engine::SceneCache::getCacheFileName(const std::string& pathToObj)
+{
+	return pathToObj + ".scenecache";
+}
+
+bool Engine::SceneCache::getSourceStamp(const std::string& fileName, SourceStamp& stamp)
+{
+	error_code ec;
+	stamp.size = filesystem::file_size(fileName, ec);
+	if (ec) {
+		return false;
+	}
+
+	stamp.writeTime = static_cast<int64_t>(filesystem::last_write_time(fileName, ec).time_since_epoch().count());
+	return !ec;
+}
+
+std::uint64_t Engine::SceneCache::hashFile(const std::string& fileName)
+{
+	// FNV-1a, consuming 8 bytes per step
+	constexpr uint64_t fnvOffsetBasis = 14695981039346656037ull;
+	constexpr uint64_t fnvPrime = 1099511628211ull;
+
+	Util::MappedFile file(fileName);
+	const uint8_t* data = file.getData();
+	const size_t size = file.getSize();
+
+	uint64_t hash = fnvOffsetBasis;
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, data + i, sizeof(word));
+		hash = (hash ^ word) * fnvPrime;
+	}
+
+	for (; i < size; ++i) {
+		hash = (hash ^ data[i]) * fnvPrime;
+	}
+
+	return hash;
+}
+
+bool Engine::SceneCache::validateSections() const
+{
+	const Header& header = getHeader();
+	const uint64_t fileSize = mappedFile->getSize();
+
+	for (size_t i = 0; i < SectionCount; ++i) {
+		const auto& section = header.sections[i];
+		if (section.offsetInBytes % sectionAlignment != 0 || section.offsetInBytes > fileSize ||
+			section.count > (fileSize - section.offsetInBytes) / sectionElementSizes[i]) {
+			return false;
+		}
+	}
+
+	// Check that the tables only reference data inside their sections
+	const ShapeEntry* shapeEntries = getSection<ShapeEntry>(ShapeTable);
+	for (size_t i = 0; i < getSectionCount(ShapeTable); ++i) {
+		if (!isRangeInside(shapeEntries[i].nameOffset, shapeEntries[i].nameLength, header.sections[ShapeNames].count) ||
+			shapeEntries[i].meshIndex >= header.sections[MeshTable].count) {
+			return false;
+		}
+	}
+
+	const MeshEntry* meshEntries = getSection<MeshEntry>(MeshTable);
+	for (size_t i = 0; i < getSectionCount(MeshTable); ++i) {
+		const auto& entry = meshEntries[i];
+		if (!isRangeInside(entry.vertexOffset, entry.vertexCount, header.sections[Vertices].count) ||
+			entry.faceOffset > header.sections[TextureVertices].count / 3 ||
+			!isRangeInside(entry.faceOffset * 3, entry.vertexCount, header.sections[TextureVertices].count) ||
+			!isRangeInside(entry.faceOffset, entry.vertexCount / 3, header.sections[FaceAttributes].count)) {
+			return false;
+		}
+	}
+
+	const TextureEntry* textureEntries = getSection<TextureEntry>(TextureTable);
+	for (size_t i = 0; i < getSectionCount(TextureTable); ++i) {
+		const auto& entry = textureEntries[i];
+		const bool dataInside = entry.sourceIndex < 0 ?
+			isRangeInside(entry.dataOffset, entry.dataSize, header.sections[TextureData].count) :
+			static_cast<uint64_t>(entry.sourceIndex) < header.sections[Dependencies].count;
+		if (!dataInside ||
+			entry.mipLevelCount < 1 || entry.mipLevelCount > 32 || entry.format < Texture::RGBA8 || entry.format > Texture::BC7 ||
+			entry.dataSize != Texture::getDataSize(entry.width, entry.height, entry.channels, static_cast<Texture::Format>(entry.format), entry.mipLevelCount)) {
+			return false;
+		}
+	}
+
+	const DependencyEntry* dependencyEntries = getSection<DependencyEntry>(Dependencies);
+	for (size_t i = 0; i < getSectionCount(Dependencies); ++i) {
+		if (!isRangeInside(dependencyEntries[i].pathOffset, dependencyEntries[i].pathLength, header.sections[DependencyPaths].count)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool Engine::SceneCache::validateDependencies() const
+{
+	const DependencyEntry* dependencyEntries = getSection<DependencyEntry>(Dependencies);
+	const char* dependencyPaths = getSection<char>(DependencyPaths);
+	for (size_t i = 0; i < getSectionCount(Dependencies); ++i) {
+		const auto& entry = dependencyEntries[i];
+		const string fileName(dependencyPaths + entry.pathOffset, static_cast<size_t>(entry.pathLength));
+
+		// A file that was missing must still be missing, the others must be unchanged (same test as for the OBJ)
+		SourceStamp stamp;
+		if (!getSourceStamp(fileName, stamp)) {
+			if (!entry.missing) {
+				return false;
+			}
+			continue;
+		}
+
+		if (entry.missing || entry.size != stamp.size ||
+			(entry.writeTime != stamp.writeTime && entry.hash != hashFile(fileName))) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool Engine::SceneCache::mapTextureCaches()
+{
+	const TextureEntry* textureEntries = getSection<TextureEntry>(TextureTable);
+	const DependencyEntry* dependencyEntries = getSection<DependencyEntry>(Dependencies);
+	const char* dependencyPaths = getSection<char>(DependencyPaths);
+
+	textureCacheFiles.resize(getSectionCount(TextureTable));
+	for (size_t i = 0; i < textureCacheFiles.size(); ++i) {
+		const auto& entry = textureEntries[i];
+		if (entry.sourceIndex < 0) {
+			continue;
+		}
+
+		const auto& dependency = dependencyEntries[entry.sourceIndex];
+		TextureCache textureCache(string(dependencyPaths + dependency.pathOffset, static_cast<size_t>(dependency.pathLength)));
+		if (!textureCache.isValid()) {
+			return false;
+		}
+
+		const auto& textureHeader = textureCache.getHeader();
+		if (textureHeader.width != entry.width || textureHeader.height != entry.height || textureHeader.channels != entry.channels ||
+			textureHeader.mipLevelCount != entry.mipLevelCount || textureHeader.format != entry.format || textureHeader.dataSize != entry.dataSize) {
+			return false;
+		}
+
+		textureCacheFiles[i] = textureCache.getMappedFile();
+	}
+
+	return true;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <vector>
+
+#include "Util/MappedFile.h"
+
+namespace Engine {
+	class Scene;
+
+	// Binary snapshot of a loaded scene, stored next to the source OBJ file.
+	// Layout: SceneCacheHeader, followed by the sections listed in the header (each 16 byte aligned).
+	// All arrays are stored exactly as they are laid out in memory, so they can be read without parsing.
+	class SceneCache {
+	public:
+		static constexpr std::uint32_t version = 7;
+
+		enum Section {
+			ShapeTable = 0,
+			ShapeNames,
+			MeshTable,
+			Vertices,
+			TextureVertices,
+			FaceAttributes,
+			Lights,
+			Materials,
+			TextureTable,
+			TextureData,
+			Dependencies,
+			DependencyPaths,
+			SectionCount
+		};
+
+		struct SectionEntry {
+			std::uint64_t offsetInBytes;
+			std::uint64_t count;
+		};
+
+		struct Header {
+			char magic[4];
+			std::uint32_t version;
+			std::uint64_t sourceSize;
+			std::int64_t sourceWriteTime;
+			std::uint64_t sourceHash;
+			SectionEntry sections[SectionCount];
+		};
+
+		struct ShapeEntry {
+			std::uint64_t nameOffset;
+			std::uint64_t nameLength;
+			std::uint64_t meshIndex;
+			float translation[3];
+			std::uint32_t padding;
+		};
+
+		struct MeshEntry {
+			std::uint64_t vertexOffset;
+			std::uint64_t vertexCount;
+			std::uint64_t faceOffset;
+		};
+
+		struct TextureEntry {
+			std::int32_t width;
+			std::int32_t height;
+			std::int32_t channels;
+			std::int32_t mipLevelCount;
+			std::int32_t format; // Texture::Format
+			std::int32_t sourceIndex; // Dependencies entry of the image whose texture cache holds the data, -1 if it is in TextureData
+			std::uint64_t dataOffset;
+			std::uint64_t dataSize;
+		};
+
+		// Stamp of an MTL library or image the scene was built from
+		struct DependencyEntry {
+			std::uint64_t pathOffset;
+			std::uint64_t pathLength;
+			std::uint64_t size;
+			std::int64_t writeTime;
+			std::uint64_t hash;
+			std::uint32_t missing; // the file did not exist when the cache was written
+			std::uint32_t padding;
+		};
+
+		// Maps the cache file for `pathToObj`. Use isValid() to check whether it can be used.
+		SceneCache(const std::string& pathToObj);
+
+		// True if the cache exists, has the current version and was built from the current source, MTL and image files
+		bool isValid() const;
+
+		template<class T>
+		const T* getSection(Section section) const {
+			return reinterpret_cast<const T*>(mappedFile->getData() + getHeader().sections[section].offsetInBytes);
+		}
+		std::size_t getSectionCount(Section section) const;
+
+		const Header& getHeader() const;
+		std::shared_ptr<Util::MappedFile> getMappedFile() const;
+		// Texture cache holding the data of a TextureTable entry, null if the data is in TextureData
+		std::shared_ptr<Util::MappedFile> getTextureCacheFile(std::size_t textureIndex) const;
+
+		// Serialises the scene. Returns false if the cache could not be written.
+		static bool write(const std::string& pathToObj, const Scene& scene);
+
+		static std::string getCacheFileName(const std::string& pathToObj);
+
+		// Identifies the version of a source file, also used by TextureCache
+		struct SourceStamp {
+			std::uint64_t size;
+			std::int64_t writeTime;
+		};
+
+		static bool getSourceStamp(const std::string& fileName, SourceStamp& stamp);
+		// FNV-1a hash of the file's contents
+		static std::uint64_t hashFile(const std::string& fileName);
+
+	private:
+		bool validateSections() const;
+		bool validateDependencies() const;
+		// Maps the referenced texture caches, which have to match their entries
+		bool mapTextureCaches();
+
+		std::string pathToObj;
+		std::shared_ptr<Util::MappedFile> mappedFile;
+		std::vector<std::shared_ptr<Util::MappedFile>> textureCacheFiles;
+		bool valid;
+	};
+}
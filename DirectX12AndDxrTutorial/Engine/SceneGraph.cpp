@@ -0,0 +1,189 @@
+#include "SceneGraph.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace DirectX;
+
+void Engine::SceneGraph::clear()
+{
+	nodes.clear();
+	roots.clear();
+	dirtyNodes.clear();
+	instanceTransforms.clear();
+	changedInstanceRanges.clear();
+}
+
+std::size_t Engine::SceneGraph::addNode(const std::string& name, std::size_t parent, std::size_t instanceIndex, const DirectX::XMFLOAT3X4& localTransform)
+{
+	const size_t index = nodes.size();
+
+	Node node = {};
+	node.name = name;
+	node.parent = parent;
+	node.instanceIndex = instanceIndex;
+	node.depth = parent == noParent ? 0 : nodes.at(parent).depth + 1;
+	node.localTransform = localTransform;
+	node.worldTransform = localTransform;
+	nodes.push_back(move(node));
+
+	if (parent == noParent) {
+		roots.push_back(index);
+	}
+	else {
+		nodes[parent].children.push_back(index);
+	}
+
+	if (instanceIndex != noInstance && instanceIndex >= instanceTransforms.size()) {
+		instanceTransforms.resize(instanceIndex + 1, identityTransform());
+	}
+
+	// World transform is computed by the next update
+	markDirty(index);
+
+	return index;
+}
+
+void Engine::SceneGraph::setLocalTransform(std::size_t node, const DirectX::XMFLOAT3X4& localTransform)
+{
+	nodes[node].localTransform = localTransform;
+	markDirty(node);
+}
+
+void Engine::SceneGraph::setAnimatedTransform(std::size_t node, const DirectX::XMFLOAT3X4& animatedTransform)
+{
+	nodes[node].animatedTransform = animatedTransform;
+	nodes[node].animated = true;
+	markDirty(node);
+}
+
+void Engine::SceneGraph::clearAnimatedTransform(std::size_t node)
+{
+	if (nodes[node].animated) {
+		nodes[node].animated = false;
+		markDirty(node);
+	}
+}
+
+bool Engine::SceneGraph::update()
+{
+	changedInstanceRanges.clear();
+	if (dirtyNodes.empty()) {
+		return false;
+	}
+
+	// Ancestors first, a dirty node inside an already updated subtree is then skipped
+	sort(dirtyNodes.begin(), dirtyNodes.end(), [this](size_t a, size_t b) { return nodes[a].depth < nodes[b].depth; });
+
+	vector<size_t> changedInstances;
+	for (size_t node : dirtyNodes) {
+		if (nodes[node].dirty) {
+			updateSubtree(node, changedInstances);
+		}
+	}
+	dirtyNodes.clear();
+
+	// Merge neighbouring instances, so that each range is a single copy
+	sort(changedInstances.begin(), changedInstances.end());
+	for (size_t instance : changedInstances) {
+		if (!changedInstanceRanges.empty() && changedInstanceRanges.back().second >= instance) {
+			changedInstanceRanges.back().second = std::max(changedInstanceRanges.back().second, instance + 1);
+		}
+		else {
+			changedInstanceRanges.emplace_back(instance, instance + 1);
+		}
+	}
+
+	return !changedInstanceRanges.empty();
+}
+
+const std::string& Engine::SceneGraph::getName(std::size_t node) const
+{
+	return nodes[node].name;
+}
+
+std::size_t Engine::SceneGraph::getParent(std::size_t node) const
+{
+	return nodes[node].parent;
+}
+
+const std::vector<std::size_t>& Engine::SceneGraph::getChildren(std::size_t node) const
+{
+	return nodes[node].children;
+}
+
+std::size_t Engine::SceneGraph::getInstanceIndex(std::size_t node) const
+{
+	return nodes[node].instanceIndex;
+}
+
+const DirectX::XMFLOAT3X4& Engine::SceneGraph::getLocalTransform(std::size_t node) const
+{
+	return nodes[node].localTransform;
+}
+
+const DirectX::XMFLOAT3X4& Engine::SceneGraph::getWorldTransform(std::size_t node) const
+{
+	return nodes[node].worldTransform;
+}
+
+std::size_t Engine::SceneGraph::getNodeCount() const
+{
+	return nodes.size();
+}
+
+const std::vector<std::size_t>& Engine::SceneGraph::getRoots() const
+{
+	return roots;
+}
+
+const std::vector<DirectX::XMFLOAT3X4>& Engine::SceneGraph::getInstanceTransforms() const
+{
+	return instanceTransforms;
+}
+
+const std::vector<Engine::SceneGraph::Range>& Engine::SceneGraph::getChangedInstanceRanges() const
+{
+	return changedInstanceRanges;
+}
+
+DirectX::XMFLOAT3X4 Engine::SceneGraph::identityTransform()
+{
+	XMFLOAT3X4 transform;
+	XMStoreFloat3x4(&transform, XMMatrixIdentity());
+	return transform;
+}
+
+void Engine::SceneGraph::markDirty(std::size_t node)
+{
+	if (!nodes[node].dirty) {
+		nodes[node].dirty = true;
+		dirtyNodes.push_back(node);
+	}
+}
+
+void Engine::SceneGraph::updateSubtree(std::size_t root, std::vector<std::size_t>& changedInstances)
+{
+	vector<size_t> stack = { root };
+	while (!stack.empty()) {
+		Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		XMMATRIX world = XMLoadFloat3x4(&node.localTransform);
+		if (node.animated) {
+			world = XMMatrixMultiply(world, XMLoadFloat3x4(&node.animatedTransform));
+		}
+		if (node.parent != noParent) {
+			world = XMMatrixMultiply(world, XMLoadFloat3x4(&nodes[node.parent].worldTransform));
+		}
+		XMStoreFloat3x4(&node.worldTransform, world);
+		node.dirty = false;
+
+		if (node.instanceIndex != noInstance) {
+			instanceTransforms[node.instanceIndex] = node.worldTransform;
+			changedInstances.push_back(node.instanceIndex);
+		}
+
+		stack.insert(stack.end(), node.children.begin(), node.children.end());
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+#include <DirectXMath.h>
+
+namespace Engine {
+	// Transform hierarchy of the scene. A node's world transform is its local transform, then its animated transform (if any),
+	// then its parent's world transform.
+	// Nodes may reference an instance (a shape / TLAS instance), whose world transform is kept in a separate array in
+	// instance order, ready to be uploaded. Editing a local transform only marks the node dirty; update() then recomputes
+	// the dirty subtrees and records which instances changed, so neither the recompute nor the upload touches the whole scene.
+	class SceneGraph {
+	public:
+		static constexpr std::size_t noParent = std::numeric_limits<std::size_t>::max();
+		static constexpr std::size_t noInstance = std::numeric_limits<std::size_t>::max();
+
+		// [begin, end) of instance indices
+		using Range = std::pair<std::size_t, std::size_t>;
+
+		void clear();
+
+		// Parents have to be added before their children. Returns the node's index.
+		std::size_t addNode(const std::string& name, std::size_t parent = noParent, std::size_t instanceIndex = noInstance,
+			const DirectX::XMFLOAT3X4& localTransform = identityTransform());
+
+		void setLocalTransform(std::size_t node, const DirectX::XMFLOAT3X4& localTransform);
+		// Set by the animation every frame, kept separate so that animating doesn't overwrite edits to the local transform
+		void setAnimatedTransform(std::size_t node, const DirectX::XMFLOAT3X4& animatedTransform);
+		void clearAnimatedTransform(std::size_t node);
+
+		// Recomputes the world transforms of all dirty subtrees. Returns true if any instance transform changed.
+		bool update();
+
+		const std::string& getName(std::size_t node) const;
+		std::size_t getParent(std::size_t node) const;
+		const std::vector<std::size_t>& getChildren(std::size_t node) const;
+		std::size_t getInstanceIndex(std::size_t node) const;
+		const DirectX::XMFLOAT3X4& getLocalTransform(std::size_t node) const;
+		// Up to date after update()
+		const DirectX::XMFLOAT3X4& getWorldTransform(std::size_t node) const;
+		std::size_t getNodeCount() const;
+		// Nodes without parent, in the order they were added
+		const std::vector<std::size_t>& getRoots() const;
+
+		// World transforms of the instances, indexed by instance
+		const std::vector<DirectX::XMFLOAT3X4>& getInstanceTransforms() const;
+		// Instances whose world transform changed in the last update(), sorted and merged
+		const std::vector<Range>& getChangedInstanceRanges() const;
+
+		static DirectX::XMFLOAT3X4 identityTransform();
+
+	private:
+		struct Node {
+			std::string name;
+			std::size_t parent;
+			std::size_t instanceIndex;
+			std::uint32_t depth;
+			bool dirty;
+			bool animated;
+			std::vector<std::size_t> children;
+			DirectX::XMFLOAT3X4 localTransform;
+			DirectX::XMFLOAT3X4 animatedTransform;
+			DirectX::XMFLOAT3X4 worldTransform;
+		};
+
+		void markDirty(std::size_t node);
+		void updateSubtree(std::size_t node, std::vector<std::size_t>& changedInstances);
+
+		std::vector<Node> nodes;
+		std::vector<std::size_t> roots;
+		// Nodes whose local transform changed since the last update
+		std::vector<std::size_t> dirtyNodes;
+
+		std::vector<DirectX::XMFLOAT3X4> instanceTransforms;
+		std::vector<Range> changedInstanceRanges;
+	};
+}
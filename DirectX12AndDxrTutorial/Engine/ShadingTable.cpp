@@ -8,6 +8,10 @@ using namespace std;
 using namespace Engine;
 using namespace Util;
 
+static_assert(ShaderTableBuilder::identifierSize == D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES, "ShaderTableBuilder::identifierSize doesn't match D3D12");
+static_assert(ShaderTableBuilder::recordAlignment == D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT, "ShaderTableBuilder::recordAlignment doesn't match D3D12");
+static_assert(ShaderTableBuilder::tableAlignment == D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT, "ShaderTableBuilder::tableAlignment doesn't match D3D12");
+
 Engine::ShadingTable::ShadingTable(std::shared_ptr<RootSignatureManager> rootSignatureManager)
 	: rootSignatureManager (rootSignatureManager)//, numHitGroupGeometries()
 {}
@@ -24,6 +28,12 @@ DescriptorHeap& Engine::ShadingTable::generateDescriptorHeap(const std::string&
 	return descriptorHeaps.at(instanceName);
 }
 
+DescriptorHeap& Engine::ShadingTable::generateDescriptorHeap(const std::string& parameterName, const std::string& instanceName, Microsoft::WRL::ComPtr<ID3D12Device5> pDevice, GpuDescriptorHeap& gpuDescriptorHeap)
+{
+	descriptorHeaps.emplace(instanceName, DescriptorHeap(rootSignatureManager, parameterName, instanceName, pDevice, gpuDescriptorHeap));
+	return descriptorHeaps.at(instanceName);
+}
+
 //void Engine::ShadingTable::setInputForDescriptorTableParameter(const wstring& programName, const std::string& parameterName, Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> descriptorHeap)
 //{
 //	// Get Program data
@@ -50,6 +60,7 @@ void Engine::ShadingTable::setInputForDescriptorTableParameter(const std::wstrin
 
 	// Set
 	programStruct.managedDescriptorHeapMap[parameterName] = &descriptorHeaps.at(instanceName);
+	programStruct.dirty = true;
 }
 
 void Engine::ShadingTable::setInputForViewParameter(const wstring& programName, const std::string& parameterName, Microsoft::WRL::ComPtr<ID3D12Resource> resource)
@@ -64,6 +75,7 @@ void Engine::ShadingTable::setInputForViewParameter(const wstring& programName,
 	
 	// Set
 	programStruct.viewsMap[parameterName] = resource;
+	programStruct.dirty = true;
 }
 
 void Engine::ShadingTable::setInputForConstantParameter(const wstring& programName, const std::string& parameterName, UINT32 constant)
@@ -75,9 +87,12 @@ void Engine::ShadingTable::setInputForConstantParameter(const wstring& programNa
 	const auto& parameter = rootSignatureManager->getParameterForRootSignature(programStruct.rootSignatureName, parameterName);
 	if (parameter.ParameterType != D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS)
 		throw runtime_error("Paramter '" + parameterName + "' not a 32bit constant type");
+	if (parameter.Constants.Num32BitValues != 1)
+		throw runtime_error("Paramter '" + parameterName + "' holds more than one 32bit constant");
 
 	// Set
 	programStruct.constantsMap[parameterName] = constant;
+	programStruct.dirty = true;
 }
 
 Microsoft::WRL::ComPtr<ID3D12Resource> Engine::ShadingTable::generateShadingTable(
@@ -89,104 +104,54 @@ Microsoft::WRL::ComPtr<ID3D12Resource> Engine::ShadingTable::generateShadingTabl
 	validateInputs();
 	sortShadingRecords();
 
-	// Calculate size per record type and total table size
-	size_t totalTableSize = 0;
-	for (size_t i = 0; i < std::size(tableLayout); ++i) {
-		tableLayout[i].offsetInBytes = totalTableSize;
-
-		// Assuming sorted shading records, find respective amounts
-		size_t typeCount = 0;
-		for (const auto& shadingRecord : shadingRecords) {
-			if (shadingRecord.shadingRecordType == static_cast<ShadingRecordType>(i)) {
-				++typeCount;
-			}
-			else if (typeCount > 0) {
-				break;
-			}
-		}
+	// One section per record type
+	vector<ShaderTableBuilder::SectionDesc> sections;
+	for (size_t i = 0; i <= HitGroup; ++i) {
+		const ShadingRecordType shadingRecordType = static_cast<ShadingRecordType>(i);
+		const size_t typeCount = count_if(shadingRecords.begin(), shadingRecords.end(), [&](const ShadingRecord& shadingRecord) { return shadingRecord.shadingRecordType == shadingRecordType; });
 
-		tableLayout[i].numOfRecords = typeCount;
-		tableLayout[i].alignedRecordSize = getLargestRecordTypeSize(static_cast<ShadingRecordType>(i));
-
-		// aligned record size
-		auto t = numeric_limits<size_t>::max();
-		std::align(D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT, tableLayout[i].alignedRecordSize, (void*&)tableLayout[i].alignedRecordSize, t);
-
-		// Find table alignment 
-		tableLayout[i].alignedRecordCollectionSize = tableLayout[i].numOfRecords * tableLayout[i].alignedRecordSize;
-		t = numeric_limits<size_t>::max();
-		std::align(D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT, tableLayout[i].alignedRecordCollectionSize, (void*&)tableLayout[i].alignedRecordCollectionSize, t);
-
-		totalTableSize += tableLayout[i].alignedRecordCollectionSize;
+		sections.push_back({
+			typeCount,
+			typeCount > 0 ? getLargestRecordTypeSize(shadingRecordType) - D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES : 0 });
 	}
 
-	// Create the shading table
-	// Create host side buffer - it should be zero initialised when using make_unique..
-	unique_ptr<uint8_t[]> bufferManager = make_unique<uint8_t[]>(totalTableSize);
-	uint8_t* const buffer = bufferManager.get();
-	uint8_t* localBuffer = buffer;
+	tableBuilder = make_unique<ShaderTableBuilder>(sections);
 
 	// Extract the properties interface
-	Microsoft::WRL::ComPtr<ID3D12StateObjectProperties> pStateObjectProps;
 	pStateObject.As(&pStateObjectProps);
-	
-	ShadingRecordType shadingRecordType = RayGeneration;
-	size_t localRecordNumber = 0;
-	// Write each shading record in the buffer
-	for (const auto& shadingRecord : shadingRecords) {
 
-		if (shadingRecordType != shadingRecord.shadingRecordType) {
-			shadingRecordType = shadingRecord.shadingRecordType;
-			localBuffer = buffer + tableLayout[shadingRecordType].offsetInBytes;
-			localRecordNumber = 0;
-		}
-
-		memcpy(localBuffer, pStateObjectProps->GetShaderIdentifier(shadingRecord.programName.c_str()), D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES);
-		localBuffer += D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES;
+	// Write each shading record in the table
+	for (size_t i = 0; i < shadingRecords.size(); ++i) {
+		writeShadingRecord(i, pDevice);
+	}
+	tableBuilder->takeDirtyRanges();
 
-		// Get parameters
-		const auto& rs = rootSignatureManager->getRootSignature(shadingRecord.rootSignatureName);
-		for (const auto& parameterName : rs.parameterNames) {
-			const auto& parameter = rootSignatureManager->getParameterForRootSignature(shadingRecord.rootSignatureName, parameterName);
+	// Upload buffer to gpu
+	return pShadingTable = DXUtil::uploadDataToDefaultHeap(pDevice, pCurrentCommandList, shadingTableTempResource, tableBuilder->getData().data(), tableBuilder->getSize(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+}
 
-			switch (parameter.ParameterType) {
-				case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
-				{	// Get heap
-					const auto d = shadingRecord.managedDescriptorHeapMap.at(parameterName);
-					
-					const auto& descriptorHeap = d->getDescriptorHeap();
-					//const auto& descriptorHeap = shadingRecord.descriptorHeapMap.at(parameterName);
-					UINT64 descriptorTableHandle = descriptorHeap->GetGPUDescriptorHandleForHeapStart().ptr;
-					memcpy(localBuffer, &descriptorTableHandle, sizeof(descriptorTableHandle));
-				}
-				break;
-				case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
-				{
-					throw runtime_error("D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS not implemented in ShadingTable");
-				}
-				break;
-				case D3D12_ROOT_PARAMETER_TYPE_CBV:
-				case D3D12_ROOT_PARAMETER_TYPE_SRV:
-				case D3D12_ROOT_PARAMETER_TYPE_UAV:
-				{
-					const auto& resource = shadingRecord.viewsMap.at(parameterName);
-					auto handle = resource->GetGPUVirtualAddress();
-					memcpy(localBuffer, &handle, sizeof(handle));
-				}
-				break;
-			}
+void Engine::ShadingTable::updateShadingTable(
+	Microsoft::WRL::ComPtr<ID3D12Device5> pDevice,
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCurrentCommandList,
+	const DXUtil::UploadAllocator& allocateUpload)
+{
+	validateInputs();
 
-			localBuffer += 8;
+	for (size_t i = 0; i < shadingRecords.size(); ++i) {
+		if (shadingRecords[i].dirty) {
+			writeShadingRecord(i, pDevice);
 		}
-
-		// Calculate next record location
-		localBuffer = buffer + 
-			tableLayout[shadingRecord.shadingRecordType].offsetInBytes + 
-			tableLayout[shadingRecord.shadingRecordType].alignedRecordSize * ++localRecordNumber;
 	}
 
-	// Upload buffer to gpu
-	return pShadingTable = DXUtil::uploadDataToDefaultHeap(pDevice, pCurrentCommandList, shadingTableTempResource, buffer, totalTableSize, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	// The dirty ranges are in bytes
+	DXUtil::updateDataRangesInDefaultHeap(
+		pCurrentCommandList,
+		pShadingTable,
+		allocateUpload,
+		tableBuilder->getData().data(),
+		1,
+		tableBuilder->takeDirtyRanges(),
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 }
 
 void Engine::ShadingTable::addProgramAssociationsToSubobject(CD3DX12_STATE_OBJECT_DESC& stateObjectDesc)
@@ -223,19 +188,21 @@ D3D12_DISPATCH_RAYS_DESC Engine::ShadingTable::getDispatchRaysDescriptor(UINT32
 	dispatchRaysDesc.Height = height;
 	dispatchRaysDesc.Depth = 1;
 
+	const auto& sections = tableBuilder->getSections();
+
 	// Ray generation shader record
-	dispatchRaysDesc.RayGenerationShaderRecord.StartAddress = pShadingTable->GetGPUVirtualAddress() + tableLayout[0].offsetInBytes;
-	dispatchRaysDesc.RayGenerationShaderRecord.SizeInBytes = tableLayout[0].numOfRecords * tableLayout[0].alignedRecordSize;
+	dispatchRaysDesc.RayGenerationShaderRecord.StartAddress = pShadingTable->GetGPUVirtualAddress() + sections[RayGeneration].offset;
+	dispatchRaysDesc.RayGenerationShaderRecord.SizeInBytes = sections[RayGeneration].recordCount * sections[RayGeneration].recordStride;
 
 	// Miss ray record
-	dispatchRaysDesc.MissShaderTable.StartAddress = pShadingTable->GetGPUVirtualAddress() + tableLayout[1].offsetInBytes;
-	dispatchRaysDesc.MissShaderTable.StrideInBytes = tableLayout[1].alignedRecordSize;
-	dispatchRaysDesc.MissShaderTable.SizeInBytes = dispatchRaysDesc.MissShaderTable.StrideInBytes * tableLayout[1].numOfRecords;
+	dispatchRaysDesc.MissShaderTable.StartAddress = pShadingTable->GetGPUVirtualAddress() + sections[Miss].offset;
+	dispatchRaysDesc.MissShaderTable.StrideInBytes = sections[Miss].recordStride;
+	dispatchRaysDesc.MissShaderTable.SizeInBytes = dispatchRaysDesc.MissShaderTable.StrideInBytes * sections[Miss].recordCount;
 
 	// Hit ray record
-	dispatchRaysDesc.HitGroupTable.StartAddress = pShadingTable->GetGPUVirtualAddress() + tableLayout[2].offsetInBytes;;
-	dispatchRaysDesc.HitGroupTable.StrideInBytes = tableLayout[2].alignedRecordSize;
-	dispatchRaysDesc.HitGroupTable.SizeInBytes = dispatchRaysDesc.HitGroupTable.StrideInBytes * tableLayout[2].numOfRecords;
+	dispatchRaysDesc.HitGroupTable.StartAddress = pShadingTable->GetGPUVirtualAddress() + sections[HitGroup].offset;
+	dispatchRaysDesc.HitGroupTable.StrideInBytes = sections[HitGroup].recordStride;
+	dispatchRaysDesc.HitGroupTable.SizeInBytes = dispatchRaysDesc.HitGroupTable.StrideInBytes * sections[HitGroup].recordCount;
 
 	return dispatchRaysDesc;
 }
@@ -292,7 +259,71 @@ size_t Engine::ShadingTable::getShadingRecordSize(const std::wstring& programNam
 {
 	const auto& shadingRecord = shadingRecords[shadingRecordsMap[programName]];
 	const auto& rs = rootSignatureManager->getRootSignature(shadingRecord.rootSignatureName);
-	return D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + rs.parameterNames.size() * sizeof(UINT64);
+
+	// Zeroes in place of every argument, laid out (and padded) the way getArguments lays out the real ones
+	ShaderTableBuilder::Arguments arguments;
+	for (const auto& parameterName : rs.parameterNames) {
+		const auto& parameter = rootSignatureManager->getParameterForRootSignature(shadingRecord.rootSignatureName, parameterName);
+		if (parameter.ParameterType == D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS) {
+			const vector<UINT32> constants(parameter.Constants.Num32BitValues);
+			arguments.addConstants(constants.data(), constants.size());
+		}
+		else {
+			arguments.addHandle(0);
+		}
+	}
+
+	return D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES + arguments.getData().size();
+}
+
+void Engine::ShadingTable::writeShadingRecord(size_t recordIndex, Microsoft::WRL::ComPtr<ID3D12Device5> pDevice)
+{
+	ShadingRecord& shadingRecord = shadingRecords[recordIndex];
+	const ShadingRecordType shadingRecordType = shadingRecord.shadingRecordType;
+
+	// Records are sorted by type
+	const auto isOfType = [&](const ShadingRecord& other) { return other.shadingRecordType == shadingRecordType; };
+	const size_t firstOfType = find_if(shadingRecords.begin(), shadingRecords.end(), isOfType) - shadingRecords.begin();
+
+	const void* identifier = pStateObjectProps->GetShaderIdentifier(shadingRecord.programName.c_str());
+	tableBuilder->setRecord(shadingRecordType, recordIndex - firstOfType, identifier, getArguments(shadingRecord, pDevice));
+
+	shadingRecord.dirty = false;
+}
+
+Util::ShaderTableBuilder::Arguments Engine::ShadingTable::getArguments(const ShadingRecord& shadingRecord, Microsoft::WRL::ComPtr<ID3D12Device5> pDevice) const
+{
+	ShaderTableBuilder::Arguments arguments;
+
+	// Get parameters
+	const auto& rs = rootSignatureManager->getRootSignature(shadingRecord.rootSignatureName);
+	for (const auto& parameterName : rs.parameterNames) {
+		const auto& parameter = rootSignatureManager->getParameterForRootSignature(shadingRecord.rootSignatureName, parameterName);
+
+		switch (parameter.ParameterType) {
+			case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+			{	// Get heap
+				const auto d = shadingRecord.managedDescriptorHeapMap.at(parameterName);
+
+				//const auto& descriptorHeap = shadingRecord.descriptorHeapMap.at(parameterName);
+				arguments.addHandle(d->getGpuDescHandle(pDevice).ptr);
+			}
+			break;
+			case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+				arguments.addConstants(&shadingRecord.constantsMap.at(parameterName), 1);
+				break;
+			case D3D12_ROOT_PARAMETER_TYPE_CBV:
+			case D3D12_ROOT_PARAMETER_TYPE_SRV:
+			case D3D12_ROOT_PARAMETER_TYPE_UAV:
+			{
+				const auto& resource = shadingRecord.viewsMap.at(parameterName);
+				arguments.addHandle(resource->GetGPUVirtualAddress());
+			}
+			break;
+		}
+	}
+
+	return arguments;
 }
 
 size_t Engine::ShadingTable::getLargestRecordTypeSize(ShadingRecordType shadingRecordType)
@@ -309,13 +340,22 @@ size_t Engine::ShadingTable::getLargestRecordTypeSize(ShadingRecordType shadingR
 }
 
 Engine::DescriptorHeap::DescriptorHeap(std::shared_ptr<RootSignatureManager> rootSignatureManager, const std::string& parameterName, const std::string& instanceName, Microsoft::WRL::ComPtr<ID3D12Device5> pDevice)
-	: rootSignatureManager(rootSignatureManager), parameterName(parameterName), instanceName(instanceName)
+	: rootSignatureManager(rootSignatureManager), parameterName(parameterName), instanceName(instanceName), firstEntry()
 {
 	UINT32 descriptorHeapSize = rootSignatureManager->getDescriptorHeapTotalEntrySize(parameterName);
 	descriptorHeap = rootSignatureManager->generateDescriptorHeapForRangeParameter(parameterName, pDevice);
 	resources.resize(descriptorHeapSize);
 }
 
+Engine::DescriptorHeap::DescriptorHeap(std::shared_ptr<RootSignatureManager> rootSignatureManager, const std::string& parameterName, const std::string& instanceName, Microsoft::WRL::ComPtr<ID3D12Device5> pDevice, GpuDescriptorHeap& gpuDescriptorHeap)
+	: rootSignatureManager(rootSignatureManager), parameterName(parameterName), instanceName(instanceName)
+{
+	UINT32 descriptorHeapSize = rootSignatureManager->getDescriptorHeapTotalEntrySize(parameterName);
+	descriptorHeap = gpuDescriptorHeap.getDescriptorHeap();
+	firstEntry = gpuDescriptorHeap.allocate(descriptorHeapSize).index;
+	resources.resize(descriptorHeapSize);
+}
+
 void Engine::DescriptorHeap::setCBV(size_t entryNumber, const D3D12_CONSTANT_BUFFER_VIEW_DESC& cbvDescriptor, Microsoft::WRL::ComPtr<ID3D12Device5> pDevice)
 {
 	if (rootSignatureManager->getDescriptorHeapRangeType(parameterName, entryNumber) != D3D12_DESCRIPTOR_RANGE_TYPE_CBV)
@@ -356,10 +396,17 @@ Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> Engine::DescriptorHeap::getDescript
 D3D12_CPU_DESCRIPTOR_HANDLE Engine::DescriptorHeap::getCpuDescHandle(size_t entryNumber, Microsoft::WRL::ComPtr<ID3D12Device5> pDevice) const
 {
 	D3D12_CPU_DESCRIPTOR_HANDLE cpuDescHandle = descriptorHeap->GetCPUDescriptorHandleForHeapStart();
-	cpuDescHandle.ptr += entryNumber * pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	cpuDescHandle.ptr += (firstEntry + entryNumber) * pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 	return cpuDescHandle;
 }
 
+D3D12_GPU_DESCRIPTOR_HANDLE Engine::DescriptorHeap::getGpuDescHandle(Microsoft::WRL::ComPtr<ID3D12Device5> pDevice) const
+{
+	D3D12_GPU_DESCRIPTOR_HANDLE gpuDescHandle = descriptorHeap->GetGPUDescriptorHandleForHeapStart();
+	gpuDescHandle.ptr += firstEntry * pDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	return gpuDescHandle;
+}
+
 void Engine::DescriptorHeap::setResource(size_t entryNumber, Microsoft::WRL::ComPtr<ID3D12Resource> resource)
 {
 	resources[entryNumber].resource = resource;
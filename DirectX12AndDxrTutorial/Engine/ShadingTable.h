@@ -8,6 +8,9 @@
 #include <unordered_map>
 
 #include "RootSignatureManager.h"
+#include "GpuDescriptorHeap.h"
+#include "Util/DXUtil.h"
+#include "Util/ShaderTableBuilder.h"
 
 namespace Engine {
 	enum ShadingRecordType {
@@ -24,6 +27,8 @@ namespace Engine {
 	class DescriptorHeap {
 	public:
 		DescriptorHeap(std::shared_ptr<RootSignatureManager> rootSignatureManager, const std::string& parameterName, const std::string& instanceName, Microsoft::WRL::ComPtr<ID3D12Device5> pDevice);
+		// The table is a range of gpuDescriptorHeap instead of a heap of its own
+		DescriptorHeap(std::shared_ptr<RootSignatureManager> rootSignatureManager, const std::string& parameterName, const std::string& instanceName, Microsoft::WRL::ComPtr<ID3D12Device5> pDevice, GpuDescriptorHeap& gpuDescriptorHeap);
 
 		void setCBV(size_t entryNumber, const D3D12_CONSTANT_BUFFER_VIEW_DESC& cbvDescriptor, Microsoft::WRL::ComPtr<ID3D12Device5> pDevice);
 		void setUAV(size_t entryNumber, const D3D12_UNORDERED_ACCESS_VIEW_DESC& uavDescriptor, Microsoft::WRL::ComPtr<ID3D12Device5> pDevice, Microsoft::WRL::ComPtr<ID3D12Resource> resource = {});
@@ -31,6 +36,8 @@ namespace Engine {
 
 		void validate() const;
 		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> getDescriptorHeap() const;
+		// Start of the table
+		D3D12_GPU_DESCRIPTOR_HANDLE getGpuDescHandle(Microsoft::WRL::ComPtr<ID3D12Device5> pDevice) const;
 	private:
 		D3D12_CPU_DESCRIPTOR_HANDLE getCpuDescHandle(size_t entryNumber, Microsoft::WRL::ComPtr<ID3D12Device5> pDevice) const;
 		void setResource(size_t entryNumber, Microsoft::WRL::ComPtr<ID3D12Resource> resource = {});
@@ -40,6 +47,7 @@ namespace Engine {
 		std::string instanceName;
 
 		Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> descriptorHeap;
+		size_t firstEntry;
 		std::vector<ResourceSet> resources;
 	};
 
@@ -53,13 +61,9 @@ namespace Engine {
 		std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D12Resource>> viewsMap;
 		//std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>> descriptorHeapMap;
 		std::unordered_map<std::string, DescriptorHeap*> managedDescriptorHeapMap;
-	};
 
-	struct ShadingTableLayout {
-		std::size_t offsetInBytes;
-		std::size_t alignedRecordSize;
-		std::size_t alignedRecordCollectionSize; // For table
-		std::size_t numOfRecords;
+		// Inputs changed since the table was last written
+		bool dirty = true;
 	};
 
 	// The shading table will map types (from root signature) to buffers
@@ -74,6 +78,7 @@ namespace Engine {
 		void addProgram(const std::wstring& programName, ShadingRecordType shadingRecordType, const std::string& rootSignatureName);
 
 		DescriptorHeap& generateDescriptorHeap(const std::string& parameterName, const std::string& instanceName, Microsoft::WRL::ComPtr<ID3D12Device5> pDevice);
+		DescriptorHeap& generateDescriptorHeap(const std::string& parameterName, const std::string& instanceName, Microsoft::WRL::ComPtr<ID3D12Device5> pDevice, GpuDescriptorHeap& gpuDescriptorHeap);
 
 		//void setInputForDescriptorTableParameter(const std::wstring& programName, const std::string& parameterName, Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> descriptorHeap);
 		void setInputForDescriptorTableParameter(const std::wstring& programName, const std::string& parameterName, const std::string& instanceName);
@@ -85,6 +90,14 @@ namespace Engine {
 			Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCurrentCommandList,
 			Microsoft::WRL::ComPtr<ID3D12StateObject> pStateObject,
 			Microsoft::WRL::ComPtr<ID3D12Resource>& shadingTableTempResource);
+		// Rewrites the records whose inputs changed since the table was generated (or last updated) and uploads only the
+		// bytes that differ. The layout has to stay the same: no new programs or parameters.
+		// Not part of the frame yet, RTGraphics sets all inputs before generateShadingTable and never changes them. Meant
+		// for inputs that change at runtime (ex. a resized buffer or a new descriptor table).
+		void updateShadingTable(
+			Microsoft::WRL::ComPtr<ID3D12Device5> pDevice,
+			Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCurrentCommandList,
+			const Util::DXUtil::UploadAllocator& allocateUpload);
 
 		void addProgramAssociationsToSubobject(CD3DX12_STATE_OBJECT_DESC& stateObjectDesc);
 
@@ -94,6 +107,9 @@ namespace Engine {
 		void validateInputs();
 		void sortShadingRecords();
 		size_t getShadingRecordSize(const std::wstring& programName);
+		// Puts the record into tableBuilder
+		void writeShadingRecord(size_t recordIndex, Microsoft::WRL::ComPtr<ID3D12Device5> pDevice);
+		Util::ShaderTableBuilder::Arguments getArguments(const ShadingRecord& shadingRecord, Microsoft::WRL::ComPtr<ID3D12Device5> pDevice) const;
 		size_t getLargestRecordTypeSize(ShadingRecordType shadingRecordType);
 
 		std::shared_ptr<RootSignatureManager> rootSignatureManager;
@@ -102,7 +118,9 @@ namespace Engine {
 
 		std::unordered_map<std::string, DescriptorHeap> descriptorHeaps;
 
-		ShadingTableLayout tableLayout[3];
+		// Layout and CPU copy of the table, one section per ShadingRecordType
+		std::unique_ptr<Util::ShaderTableBuilder> tableBuilder;
+		Microsoft::WRL::ComPtr<ID3D12StateObjectProperties> pStateObjectProps;
 
 		std::vector< CD3DX12_SUBOBJECT_TO_EXPORTS_ASSOCIATION_SUBOBJECT> vecAssociations;
 
@@ -9,8 +9,8 @@ using namespace std;
 using namespace Engine;
 using namespace DirectX;
 
-Engine::Shape::Shape(const std::string& name, std::vector<XMFLOAT3>&& vertices)
-	: changed(), name(name), vertices(move(vertices)), position{}, rotation{}, scale{1.f, 1.f, 1.f}
+Engine::Shape::Shape(const std::string& name, std::size_t meshIndex, const std::vector<XMFLOAT3>& meshVertices, const XMFLOAT3& translation)
+	: changed(), name(name), meshIndex(meshIndex), translation(translation), position{}, rotation{}, scale{1.f, 1.f, 1.f}
 {
 	constexpr float maxFloat = std::numeric_limits<float>::max();
 	constexpr float minFloat = -maxFloat;
@@ -19,13 +19,15 @@ Engine::Shape::Shape(const std::string& name, std::vector<XMFLOAT3>&& vertices)
 	XMVECTOR max = DirectX::XMVectorSet(minFloat, minFloat, minFloat, 0.f);
 
 	// Initialise position
-	for (const auto& vertex : this->vertices) {
+	for (const auto& vertex : meshVertices) {
 		min = DirectX::XMVectorMin(min, DirectX::XMVectorSet(vertex.x, vertex.y, vertex.z, 0.f));
 		max = DirectX::XMVectorMax(max, DirectX::XMVectorSet(vertex.x, vertex.y, vertex.z, 0.f));
 	}
 
+	// Rotate and scale around the centre of the instance
 	XMVECTOR position = 0.5f * (min + max);
 	XMVECTOR worldPosition = -position;
+	position += XMLoadFloat3(&translation);
 
 	XMStoreFloat3(&this->position, position);
 	XMStoreFloat3(&this->worldPosition, worldPosition);
@@ -51,9 +53,14 @@ const std::string& Engine::Shape::getName() const
 	return name;
 }
 
-const std::vector<DirectX::XMFLOAT3>& Engine::Shape::getVertices() const
+std::size_t Engine::Shape::getMeshIndex() const
 {
-	return vertices;
+	return meshIndex;
+}
+
+const DirectX::XMFLOAT3& Engine::Shape::getTranslation() const
+{
+	return translation;
 }
 
 DirectX::XMFLOAT3X4 Engine::Shape::getTransform() const
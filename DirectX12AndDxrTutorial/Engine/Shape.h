@@ -8,19 +8,28 @@
 
 namespace Engine {
 
+	// Triangle geometry, shared by every shape (instance) that uses it.
+	// Its faces start at faceOffset in the scene's face arrays (face attributes, texture vertices).
+	struct Mesh {
+		std::vector<DirectX::XMFLOAT3> vertices;
+		std::size_t faceOffset;
+	};
+
+	// Instance of a mesh. The mesh's vertices are moved by translation, then by the transform edited in the UI.
 	class Shape
 		: public IDrawableUI
 	{
 	public:
 		
-		Shape(const std::string& name, std::vector<DirectX::XMFLOAT3>&& vertices);
+		Shape(const std::string& name, std::size_t meshIndex, const std::vector<DirectX::XMFLOAT3>& meshVertices, const DirectX::XMFLOAT3& translation = {});
 
 		void setPosition(float x, float y, float z);
 		void setRotation(float x, float y, float z);
 		void setScale(float x, float y, float z);
 
 		const std::string& getName() const;
-		const std::vector<DirectX::XMFLOAT3>& getVertices() const;
+		std::size_t getMeshIndex() const;
+		const DirectX::XMFLOAT3& getTranslation() const;
 		DirectX::XMFLOAT3X4 getTransform() const;
 
 		void drawUI() override;
@@ -29,7 +38,8 @@ namespace Engine {
 		bool changed;
 
 		std::string name;
-		std::vector<DirectX::XMFLOAT3> vertices;
+		std::size_t meshIndex;
+		DirectX::XMFLOAT3 translation;
 
 		// Belos is the world position
 		DirectX::XMFLOAT3 worldPosition;
@@ -1,13 +1,258 @@
 #include "Texture.h"
 
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include <DirectXMath.h>
+
+#include "BlockCompression.h"
 #include "Libraries/stb/stb_image.h"
+#include "Util/ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace {
+	// Rows per task when downsampling a level on the thread pool
+	constexpr int mipRowsPerTask = 64;
+
+	float srgbToLinear(float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	// Indexed by the 8 bit texel value, alpha is mapped linearly
+	const array<array<float, 256>, 2>& getDecodeTables()
+	{
+		static const array<array<float, 256>, 2> tables = [] {
+			array<array<float, 256>, 2> t;
+			for (int i = 0; i < 256; ++i) {
+				t[0][i] = srgbToLinear(i / 255.f);
+				t[1][i] = i / 255.f;
+			}
+			return t;
+		}();
+
+		return tables;
+	}
+
+	inline XMVECTOR loadTexel(const unsigned char* texel, const array<array<float, 256>, 2>& tables)
+	{
+		return XMVectorSet(tables[0][texel[0]], tables[0][texel[1]], tables[0][texel[2]], tables[1][texel[3]]);
+	}
+
+	inline void storeTexel(unsigned char* texel, FXMVECTOR linearColour)
+	{
+		// Encode rgb as sRGB, keep alpha linear
+		const XMVECTOR c = XMVectorSaturate(linearColour);
+		const XMVECTOR low = XMVectorScale(c, 12.92f);
+		const XMVECTOR high = XMVectorSubtract(XMVectorScale(XMVectorPow(c, XMVectorReplicate(1.f / 2.4f)), 1.055f), XMVectorReplicate(0.055f));
+		XMVECTOR srgb = XMVectorSelect(low, high, XMVectorGreater(c, XMVectorReplicate(0.0031308f)));
+		srgb = XMVectorSelect(srgb, c, XMVectorSelectControl(0, 0, 0, 1));
+
+		XMFLOAT4 result;
+		XMStoreFloat4(&result, XMVectorMultiplyAdd(srgb, XMVectorReplicate(255.f), XMVectorReplicate(0.5f)));
+		texel[0] = static_cast<unsigned char>(result.x);
+		texel[1] = static_cast<unsigned char>(result.y);
+		texel[2] = static_cast<unsigned char>(result.z);
+		texel[3] = static_cast<unsigned char>(result.w);
+	}
+}
 
 Engine::Texture::Texture(const std::string& fileName)
-	: width(), height(), channels(), bytesPerPixel(), data(nullptr, stbImageDeleter)
+	: width(), height(), channels(), bytesPerPixel(), data(nullptr, stbImageDeleter), format(RGBA8)
 {
 	int imageChannels;
 	data = StbImagePtr(stbi_load(fileName.c_str(), &width, &height, &imageChannels, channels = STBI_rgb_alpha), stbImageDeleter);
 	bytesPerPixel = channels * 8;
+	mipLevels = computeMipLevels(width, height, channels, format, 1);
+}
+
+Engine::Texture::Texture(int width, int height, int channels, StbImagePtr data, int mipLevelCount, Format format)
+	: width(width), height(height), channels(channels), bytesPerPixel(channels * 8), data(std::move(data)),
+	  format(format), mipLevels(computeMipLevels(width, height, channels, format, mipLevelCount))
+{}
+
+void Engine::Texture::generateMipChain(int maxMipLevelCount)
+{
+	// Only 8 bit RGBA is produced by the loaders
+	if (!data || format != RGBA8 || channels != STBI_rgb_alpha || width <= 0 || height <= 0 || getMipLevelCount() > 1) {
+		return;
+	}
+
+	const int newMipLevelCount = std::min(maxMipLevelCount, 1 + static_cast<int>(std::log2(std::max(width, height))));
+	if (newMipLevelCount <= 1) {
+		return;
+	}
+
+	vector<MipLevel> newMipLevels = computeMipLevels(width, height, channels, format, newMipLevelCount);
+	StbImagePtr newData(new unsigned char[getDataSize(width, height, channels, format, newMipLevelCount)], arrayDeleter);
+	memcpy(newData.get(), data.get(), static_cast<size_t>(width) * height * channels);
+
+	const auto& tables = getDecodeTables();
+	for (size_t level = 1; level < newMipLevels.size(); ++level) {
+		const MipLevel& src = newMipLevels[level - 1];
+		const MipLevel& dst = newMipLevels[level];
+		const unsigned char* srcData = newData.get() + src.offset;
+		unsigned char* dstData = newData.get() + dst.offset;
+
+		// 2x2 box filter, a level that is already 1 texel wide/high repeats its last column/row
+		auto downsampleRows = [&](size_t task) {
+			const int yEnd = std::min(dst.height, static_cast<int>(task + 1) * mipRowsPerTask);
+			for (int y = static_cast<int>(task) * mipRowsPerTask; y < yEnd; ++y) {
+				const unsigned char* row0 = srcData + static_cast<size_t>(std::min(2 * y, src.height - 1)) * src.width * channels;
+				const unsigned char* row1 = srcData + static_cast<size_t>(std::min(2 * y + 1, src.height - 1)) * src.width * channels;
+				unsigned char* dstRow = dstData + static_cast<size_t>(y) * dst.width * channels;
+
+				for (int x = 0; x < dst.width; ++x) {
+					const size_t x0 = static_cast<size_t>(std::min(2 * x, src.width - 1)) * channels;
+					const size_t x1 = static_cast<size_t>(std::min(2 * x + 1, src.width - 1)) * channels;
+
+					XMVECTOR sum = XMVectorAdd(loadTexel(row0 + x0, tables), loadTexel(row0 + x1, tables));
+					sum = XMVectorAdd(sum, XMVectorAdd(loadTexel(row1 + x0, tables), loadTexel(row1 + x1, tables)));
+					storeTexel(dstRow + static_cast<size_t>(x) * channels, XMVectorScale(sum, 0.25f));
+				}
+			}
+		};
+
+		const size_t taskCount = (static_cast<size_t>(dst.height) + mipRowsPerTask - 1) / mipRowsPerTask;
+		if (taskCount > 1) {
+			Util::ThreadPool::getDefault().parallelFor(taskCount, downsampleRows);
+		}
+		else {
+			downsampleRows(0);
+		}
+	}
+
+	data = move(newData);
+	mipLevels = move(newMipLevels);
+}
+
+bool Engine::Texture::compress(Format targetFormat)
+{
+	constexpr int blockDimension = BlockCompression::blockDimension;
+	if (!data || format != RGBA8 || channels != STBI_rgb_alpha || targetFormat == RGBA8 ||
+		width <= 0 || height <= 0 || width % blockDimension != 0 || height % blockDimension != 0) {
+		return false;
+	}
+
+	vector<MipLevel> newMipLevels = computeMipLevels(width, height, channels, targetFormat, getMipLevelCount());
+	StbImagePtr newData(new unsigned char[getDataSize(width, height, channels, targetFormat, getMipLevelCount())], arrayDeleter);
+
+	const size_t blockSize = targetFormat == BC1 ? BlockCompression::bc1BlockSize : BlockCompression::bc7BlockSize;
+	const auto encodeBlock = targetFormat == BC1 ? BlockCompression::encodeBC1Block : BlockCompression::encodeBC7Block;
+
+	// One task per row of blocks, across all levels
+	struct BlockRow {
+		int level;
+		int blockY;
+	};
+	vector<BlockRow> blockRows;
+	for (int level = 0; level < getMipLevelCount(); ++level) {
+		const int blockRowCount = (mipLevels[level].height + blockDimension - 1) / blockDimension;
+		for (int blockY = 0; blockY < blockRowCount; ++blockY) {
+			blockRows.push_back({ level, blockY });
+		}
+	}
+
+	Util::ThreadPool::getDefault().parallelFor(blockRows.size(), [&](size_t i) {
+		const MipLevel& src = mipLevels[blockRows[i].level];
+		const int blockY = blockRows[i].blockY;
+		const int blocksPerRow = (src.width + blockDimension - 1) / blockDimension;
+		unsigned char* dst = newData.get() + newMipLevels[blockRows[i].level].offset + static_cast<size_t>(blockY) * blocksPerRow * blockSize;
+
+		uint8_t rgba[blockDimension * blockDimension * 4];
+		for (int blockX = 0; blockX < blocksPerRow; ++blockX) {
+			BlockCompression::extractBlock(data.get() + src.offset, src.width, src.height, blockX, blockY, rgba);
+			encodeBlock(rgba, dst + blockX * blockSize);
+		}
+	});
+
+	data = move(newData);
+	mipLevels = move(newMipLevels);
+	format = targetFormat;
+	return true;
+}
+
+bool Engine::Texture::isOpaque() const
+{
+	if (!data || format != RGBA8 || channels != STBI_rgb_alpha) {
+		return format == BC1;
+	}
+
+	const size_t texelCount = static_cast<size_t>(width) * height;
+	for (size_t i = 0; i < texelCount; ++i) {
+		if (data.get()[i * channels + 3] != 255) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+Engine::Texture::Format Engine::Texture::getFormat() const
+{
+	return format;
+}
+
+int Engine::Texture::getMipLevelCount() const
+{
+	return static_cast<int>(mipLevels.size());
+}
+
+const Engine::Texture::MipLevel& Engine::Texture::getMipLevel(int level) const
+{
+	return mipLevels[level];
+}
+
+const unsigned char* Engine::Texture::getMipLevelData(int level) const
+{
+	return data.get() + mipLevels[level].offset;
+}
+
+std::size_t Engine::Texture::getDataSize() const
+{
+	return getDataSize(width, height, channels, format, getMipLevelCount());
+}
+
+std::size_t Engine::Texture::getDataSize(int width, int height, int channels, Format format, int mipLevelCount)
+{
+	size_t size = 0;
+	for (int i = 0; i < mipLevelCount; ++i) {
+		size += getMipLevelSize(width, height, channels, format);
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+
+	return size;
+}
+
+std::size_t Engine::Texture::getMipLevelSize(int width, int height, int channels, Format format)
+{
+	if (format == RGBA8) {
+		return static_cast<size_t>(width) * height * channels;
+	}
+
+	// Partial blocks (levels smaller than 4x4) still take up a whole block
+	constexpr int blockDimension = BlockCompression::blockDimension;
+	const size_t blockCount = static_cast<size_t>((width + blockDimension - 1) / blockDimension) * ((height + blockDimension - 1) / blockDimension);
+	return blockCount * (format == BC1 ? BlockCompression::bc1BlockSize : BlockCompression::bc7BlockSize);
+}
+
+std::vector<Engine::Texture::MipLevel> Engine::Texture::computeMipLevels(int width, int height, int channels, Format format, int mipLevelCount)
+{
+	vector<MipLevel> levels;
+	size_t offset = 0;
+	for (int i = 0; i < mipLevelCount; ++i) {
+		levels.push_back({ width, height, offset });
+		offset += getMipLevelSize(width, height, channels, format);
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+
+	return levels;
 }
 
 void Engine::Texture::stbImageDeleter(unsigned char* image)
@@ -16,3 +261,12 @@ void Engine::Texture::stbImageDeleter(unsigned char* image)
 		stbi_image_free(image);
 	}
 }
+
+void Engine::Texture::nonOwningDeleter(unsigned char* image)
+{
+}
+
+void Engine::Texture::arrayDeleter(unsigned char* image)
+{
+	delete[] image;
+}
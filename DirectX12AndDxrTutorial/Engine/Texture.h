@@ -2,18 +2,64 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 #include <memory>
+#include <limits>
 
 namespace Engine {
 	class Texture {
 	public:
-		Texture(const std::string& fileName);
+		enum Format {
+			RGBA8 = 0,
+			BC1,
+			BC7
+		};
 
-		static void stbImageDeleter(unsigned char* image);
+		struct MipLevel {
+			int width;
+			int height;
+			std::size_t offset; // in bytes, from the start of data
+		};
 
-		int width, height, channels, bytesPerPixel;
+		static void stbImageDeleter(unsigned char* image);
+		// Used when data is owned elsewhere (ex. a memory mapped cache file)
+		static void nonOwningDeleter(unsigned char* image);
+		static void arrayDeleter(unsigned char* image);
 
 		using StbImagePtr = std::unique_ptr<unsigned char, decltype(&stbImageDeleter)>;
+
+		Texture(const std::string& fileName);
+		// data holds mipLevelCount levels, tightly packed from largest to smallest
+		Texture(int width, int height, int channels, StbImagePtr data, int mipLevelCount = 1, Format format = RGBA8);
+
+		// Replaces data with the mip chain (down to 1x1, or maxMipLevelCount levels), box filtered in linear space.
+		// Texels are treated as sRGB encoded colour with linear alpha. Does nothing if the texture already has mips.
+		void generateMipChain(int maxMipLevelCount = std::numeric_limits<int>::max());
+
+		// Block compresses every mip level of an RGBA8 texture, on the thread pool.
+		// Returns false (and leaves the texture as is) if the size is not a multiple of the block size.
+		bool compress(Format targetFormat);
+
+		// True if no texel of the top level has alpha below 255
+		bool isOpaque() const;
+		Format getFormat() const;
+
+		int getMipLevelCount() const;
+		const MipLevel& getMipLevel(int level) const;
+		const unsigned char* getMipLevelData(int level) const;
+
+		// Size of all mip levels together
+		std::size_t getDataSize() const;
+		static std::size_t getDataSize(int width, int height, int channels, Format format, int mipLevelCount);
+		static std::size_t getMipLevelSize(int width, int height, int channels, Format format);
+
+		int width, height, channels, bytesPerPixel;
 		StbImagePtr data;
+
+	private:
+		static std::vector<MipLevel> computeMipLevels(int width, int height, int channels, Format format, int mipLevelCount);
+
+		Format format;
+		std::vector<MipLevel> mipLevels;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,131 @@
+#include "TextureAtlas.h"
+
+#include <cstring>
+#include <algorithm>
+
+// imgui_draw.cpp compiles its own static copy of the implementation
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "Libraries/imgui/imstb_rectpack.h"
+
+using namespace std;
+using namespace Engine;
+
+namespace {
+	// Packing works on a grid of this many texels, so every texture starts on a texel of the smallest atlas mip
+	constexpr int packAlignment = 1 << (TextureAtlas::mipLevelCount - 1);
+
+	inline int wrap(int value, int size)
+	{
+		return ((value % size) + size) % size;
+	}
+}
+
+std::vector<TextureAtlas::Placement> Engine::TextureAtlas::pack(std::vector<std::unique_ptr<Texture>>& textures)
+{
+	vector<Placement> placements(textures.size(), { -1, identityTransform });
+	vector<unique_ptr<Texture>> result;
+
+	vector<size_t> opaqueTextures, transparentTextures;
+	for (size_t i = 0; i < textures.size(); ++i) {
+		const Texture& texture = *textures[i];
+		if (!isPackable(texture)) {
+			placements[i].textureIndex = static_cast<int>(result.size());
+			result.push_back(move(textures[i]));
+		}
+		else {
+			(texture.isOpaque() ? opaqueTextures : transparentTextures).push_back(i);
+		}
+	}
+
+	packGroup(opaqueTextures, textures, result, placements);
+	packGroup(transparentTextures, textures, result, placements);
+
+	textures = move(result);
+	return placements;
+}
+
+bool Engine::TextureAtlas::isPackable(const Texture& texture)
+{
+	return texture.data && texture.getFormat() == Texture::RGBA8 && texture.channels == 4 && texture.getMipLevelCount() == 1 &&
+		   texture.width > 0 && texture.height > 0 && texture.width <= maxPackedDimension && texture.height <= maxPackedDimension;
+}
+
+void Engine::TextureAtlas::packGroup(const std::vector<std::size_t>& group, std::vector<std::unique_ptr<Texture>>& textures,
+	std::vector<std::unique_ptr<Texture>>& result, std::vector<Placement>& placements)
+{
+	// Nothing to share with
+	if (group.size() == 1) {
+		placements[group[0]] = { static_cast<int>(result.size()), identityTransform };
+		result.push_back(move(textures[group[0]]));
+		return;
+	}
+
+	// Rects are in units of packAlignment texels, id is the index into textures
+	vector<stbrp_rect> remaining;
+	for (const size_t i : group) {
+		stbrp_rect rect = {};
+		rect.id = static_cast<int>(i);
+		rect.w = static_cast<stbrp_coord>((textures[i]->width + 2 * gutter + packAlignment - 1) / packAlignment);
+		rect.h = static_cast<stbrp_coord>((textures[i]->height + 2 * gutter + packAlignment - 1) / packAlignment);
+		remaining.push_back(rect);
+	}
+
+	constexpr int gridSize = atlasSize / packAlignment;
+	while (!remaining.empty()) {
+		stbrp_context context;
+		vector<stbrp_node> nodes(gridSize);
+		stbrp_init_target(&context, gridSize, gridSize, nodes.data(), static_cast<int>(nodes.size()));
+		stbrp_pack_rects(&context, remaining.data(), static_cast<int>(remaining.size()));
+
+		vector<stbrp_rect> packed, unpacked;
+		int usedWidth = 0, usedHeight = 0;
+		for (const auto& rect : remaining) {
+			if (rect.was_packed) {
+				packed.push_back(rect);
+				usedWidth = std::max(usedWidth, (rect.x + rect.w) * packAlignment);
+				usedHeight = std::max(usedHeight, (rect.y + rect.h) * packAlignment);
+			}
+			else {
+				unpacked.push_back(rect);
+			}
+		}
+
+		// Every rect fits an empty atlas, so at least one is always packed
+		const int atlasWidth = usedWidth;
+		const int atlasHeight = usedHeight;
+		const size_t atlasDataSize = static_cast<size_t>(atlasWidth) * atlasHeight * 4;
+		Texture::StbImagePtr atlasData(new unsigned char[atlasDataSize], Texture::arrayDeleter);
+		memset(atlasData.get(), 0, atlasDataSize);
+
+		const int atlasIndex = static_cast<int>(result.size());
+		for (const auto& rect : packed) {
+			auto& texture = textures[rect.id];
+			const int rectX = rect.x * packAlignment;
+			const int rectY = rect.y * packAlignment;
+
+			// Copy the texture and wrap it into the gutter (and the alignment padding)
+			for (int y = 0; y < rect.h * packAlignment; ++y) {
+				const unsigned char* srcRow = texture->data.get() + static_cast<size_t>(wrap(y - gutter, texture->height)) * texture->width * 4;
+				unsigned char* dstRow = atlasData.get() + (static_cast<size_t>(rectY + y) * atlasWidth + rectX) * 4;
+				for (int x = 0; x < rect.w * packAlignment; ++x) {
+					memcpy(dstRow + x * 4, srcRow + wrap(x - gutter, texture->width) * 4, 4);
+				}
+			}
+
+			placements[rect.id] = { atlasIndex, DirectX::XMFLOAT4(
+				static_cast<float>(texture->width) / atlasWidth,
+				static_cast<float>(texture->height) / atlasHeight,
+				static_cast<float>(rectX + gutter) / atlasWidth,
+				static_cast<float>(rectY + gutter) / atlasHeight) };
+
+			texture.reset();
+		}
+
+		auto atlas = make_unique<Texture>(atlasWidth, atlasHeight, 4, move(atlasData));
+		atlas->generateMipChain(mipLevelCount);
+		result.push_back(move(atlas));
+
+		remaining = move(unpacked);
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include <DirectXMath.h>
+#include "Engine/Texture.h"
+
+namespace Engine {
+	// Packs small textures into shared atlases using imstb_rectpack.
+	// Each packed texture is surrounded by a gutter of its own wrapped texels, so wrap addressing
+	// can be emulated in the shader with frac(uv) * scale + offset, including bilinear filtering.
+	class TextureAtlas {
+	public:
+		static constexpr int atlasSize = 2048;
+		// Textures up to this size (in both dimensions) are packed
+		static constexpr int maxPackedDimension = 256;
+		static constexpr int gutter = 8;
+		// Mip levels of an atlas, limited so that every level keeps at least one gutter texel
+		static constexpr int mipLevelCount = 4;
+
+		// Where a source texture ended up
+		struct Placement {
+			int textureIndex;
+			DirectX::XMFLOAT4 transform; // uv scale (xy) and offset (zw)
+		};
+
+		static constexpr DirectX::XMFLOAT4 identityTransform = DirectX::XMFLOAT4(1.f, 1.f, 0.f, 0.f);
+
+		// Replaces the small RGBA8 textures (without mips) by atlases, opaque and transparent textures are packed separately.
+		// Returns the placement of every input texture, `textures` is replaced by the unpacked textures and the atlases.
+		static std::vector<Placement> pack(std::vector<std::unique_ptr<Texture>>& textures);
+
+		// Small RGBA8 texture without mips
+		static bool isPackable(const Texture& texture);
+
+	private:
+		static void packGroup(const std::vector<std::size_t>& group, std::vector<std::unique_ptr<Texture>>& textures,
+			std::vector<std::unique_ptr<Texture>>& result, std::vector<Placement>& placements);
+	};
+}
@@ -0,0 +1,141 @@
+#include "TextureCache.h"
+
+#include "SceneCache.h"
+
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+
+using namespace std;
+using namespace Engine;
+
+namespace {
+	const char textureCacheMagic[4] = { 'D', 'X', 'R', 'T' };
+
+	std::uint64_t alignOffset(std::uint64_t offset)
+	{
+		return (offset + TextureCache::dataAlignment - 1) & ~(TextureCache::dataAlignment - 1);
+	}
+}
+
+Engine::TextureCache::TextureCache(const std::string& imageFileName)
+	: valid()
+{
+	const string cacheFileName = getCacheFileName(imageFileName);
+
+	error_code ec;
+	if (!filesystem::exists(cacheFileName, ec)) {
+		return;
+	}
+
+	SceneCache::SourceStamp stamp;
+	if (!SceneCache::getSourceStamp(imageFileName, stamp)) {
+		return;
+	}
+
+	mappedFile = make_shared<Util::MappedFile>(cacheFileName);
+
+	if (mappedFile->getSize() < sizeof(Header) || !validateHeader()) {
+		return;
+	}
+
+	// Fast path: untouched image. Otherwise accept the cache only if the contents are unchanged.
+	const Header& header = getHeader();
+	valid = (header.sourceSize == stamp.size && header.sourceWriteTime == stamp.writeTime) ||
+			(header.sourceSize == stamp.size && header.sourceHash == SceneCache::hashFile(imageFileName));
+}
+
+bool Engine::TextureCache::isValid() const
+{
+	return valid;
+}
+
+std::unique_ptr<Texture> Engine::TextureCache::createTexture() const
+{
+	const Header& header = getHeader();
+	unsigned char* data = const_cast<unsigned char*>(mappedFile->getData() + header.dataOffset);
+
+	return make_unique<Texture>(header.width, header.height, header.channels, Texture::StbImagePtr(data, Texture::nonOwningDeleter),
+		header.mipLevelCount, static_cast<Texture::Format>(header.format));
+}
+
+const TextureCache::Header& Engine::TextureCache::getHeader() const
+{
+	return *reinterpret_cast<const Header*>(mappedFile->getData());
+}
+
+std::shared_ptr<Util::MappedFile> Engine::TextureCache::getMappedFile() const
+{
+	return mappedFile;
+}
+
+bool Engine::TextureCache::write(const std::string& imageFileName, const Texture& texture)
+{
+	if (!texture.data || texture.width <= 0 || texture.height <= 0) {
+		return false;
+	}
+
+	SceneCache::SourceStamp stamp;
+	if (!SceneCache::getSourceStamp(imageFileName, stamp)) {
+		return false;
+	}
+
+	Header header = {};
+	memcpy(header.magic, textureCacheMagic, sizeof(textureCacheMagic));
+	header.version = version;
+	header.sourceSize = stamp.size;
+	header.sourceWriteTime = stamp.writeTime;
+	header.sourceHash = SceneCache::hashFile(imageFileName);
+	header.width = texture.width;
+	header.height = texture.height;
+	header.channels = texture.channels;
+	header.mipLevelCount = texture.getMipLevelCount();
+	header.format = texture.getFormat();
+	header.dataOffset = alignOffset(sizeof(Header));
+	header.dataSize = texture.getDataSize();
+
+	// Write to a temporary file first, so that a partially written cache is never picked up
+	const string cacheFileName = getCacheFileName(imageFileName);
+	const string tempFileName = cacheFileName + ".tmp";
+	{
+		ofstream file(tempFileName, ios::binary | ios::trunc);
+		if (!file) {
+			return false;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.seekp(static_cast<streamoff>(header.dataOffset));
+		file.write(reinterpret_cast<const char*>(texture.data.get()), static_cast<streamsize>(header.dataSize));
+
+		if (!file) {
+			return false;
+		}
+	}
+
+	error_code ec;
+	filesystem::rename(tempFileName, cacheFileName, ec);
+	if (ec) {
+		filesystem::remove(tempFileName, ec);
+		return false;
+	}
+
+	return true;
+}
+
+std::string Engine::TextureCache::getCacheFileName(const std::string& imageFileName)
+{
+	return imageFileName + ".texcache";
+}
+
+bool Engine::TextureCache::validateHeader() const
+{
+	const Header& header = getHeader();
+	const uint64_t fileSize = mappedFile->getSize();
+
+	return memcmp(header.magic, textureCacheMagic, sizeof(textureCacheMagic)) == 0 && header.version == version &&
+		   header.width > 0 && header.height > 0 && header.channels == 4 &&
+		   header.mipLevelCount >= 1 && header.mipLevelCount <= 32 && header.format >= Texture::RGBA8 && header.format <= Texture::BC7 &&
+		   header.dataOffset % dataAlignment == 0 && header.dataOffset <= fileSize && header.dataSize <= fileSize - header.dataOffset &&
+		   header.dataSize == Texture::getDataSize(header.width, header.height, header.channels, static_cast<Texture::Format>(header.format), header.mipLevelCount);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <memory>
+
+#include "Engine/Texture.h"
+#include "Util/MappedFile.h"
+
+namespace Engine {
+	// Decoded copy of a single image, stored next to it.
+	// Layout: Header, followed by the texel data (all mip levels, as laid out by Texture) at a page aligned offset.
+	// The texel data is used straight from the mapped file, so warm starts skip decoding and the pages are
+	// shared through the page cache with every process that renders the same image.
+	class TextureCache {
+	public:
+		static constexpr std::uint32_t version = 1;
+		static constexpr std::uint64_t dataAlignment = 4096;
+
+		struct Header {
+			char magic[4];
+			std::uint32_t version;
+			std::uint64_t sourceSize;
+			std::int64_t sourceWriteTime;
+			std::uint64_t sourceHash;
+			std::int32_t width;
+			std::int32_t height;
+			std::int32_t channels;
+			std::int32_t mipLevelCount;
+			std::int32_t format; // Texture::Format
+			std::int32_t padding;
+			std::uint64_t dataOffset;
+			std::uint64_t dataSize;
+		};
+
+		// Maps the cache file for `imageFileName`. Use isValid() to check whether it can be used.
+		TextureCache(const std::string& imageFileName);
+
+		// True if the cache exists, has the current version and was built from the current image
+		bool isValid() const;
+
+		// Texture whose data points into the mapped file, which has to be kept alive (see getMappedFile) as long as the data is used
+		std::unique_ptr<Texture> createTexture() const;
+
+		const Header& getHeader() const;
+		std::shared_ptr<Util::MappedFile> getMappedFile() const;
+
+		// Returns false if the cache could not be written
+		static bool write(const std::string& imageFileName, const Texture& texture);
+
+		static std::string getCacheFileName(const std::string& imageFileName);
+
+	private:
+		bool validateHeader() const;
+
+		std::shared_ptr<Util::MappedFile> mappedFile;
+		bool valid;
+	};
+}
@@ -0,0 +1,358 @@
+#include "TextureResidencyManager.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "Libraries/d3dx12.h"
+#include "Libraries/imgui/imgui.h"
+
+#include "BlockCompression.h"
+#include "Util/DXUtil.h"
+#include "Exception/WindowException.h"
+
+static_assert(Engine::UploadRingBuffer::defaultCapacity >= 2 * Engine::TextureResidencyManager::maxUploadSizePerFrame,
+	"A frame's texture uploads have to fit into the upload ring buffer next to the rest of the frame's uploads");
+
+namespace wrl = Microsoft::WRL;
+
+using namespace std;
+using namespace Util;
+
+namespace {
+	DXGI_FORMAT getTextureFormat(Engine::Texture::Format format)
+	{
+		switch (format) {
+			case Engine::Texture::BC1: return DXGI_FORMAT_BC1_UNORM;
+			case Engine::Texture::BC7: return DXGI_FORMAT_BC7_UNORM;
+			default: return DXGI_FORMAT_R8G8B8A8_UNORM;
+		}
+	}
+
+	// Bytes per texel, or per 4x4 block for compressed formats
+	std::size_t getTextureElementSize(const Engine::Texture& texture)
+	{
+		switch (texture.getFormat()) {
+			case Engine::Texture::BC1: return Engine::BlockCompression::bc1BlockSize;
+			case Engine::Texture::BC7: return Engine::BlockCompression::bc7BlockSize;
+			default: return texture.channels;
+		}
+	}
+
+	std::uint64_t getAllocationSize(wrl::ComPtr<ID3D12Device5> pDevice, const D3D12_RESOURCE_DESC& desc)
+	{
+		return pDevice->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+	}
+}
+
+Engine::TextureResidencyManager::TextureResidencyManager(wrl::ComPtr<ID3D12Device5> pDevice, const std::vector<Texture>& textures, UINT frameSlotCount, std::uint64_t budget)
+	: pDevice(pDevice), textures(textures), entries(std::max<size_t>(1, textures.size())), frameSlots(frameSlotCount),
+	  gpuDescriptorHeap(), currentFrameNumber(), budget(budget), residentSize(), placeholderSize()
+{
+	for (size_t i = 0; i < textures.size(); ++i) {
+		auto& entry = entries[i];
+		entry.firstPlaceholderLevel = getFirstPlaceholderLevel(textures[i]);
+
+		const Texture& texture = textures[i];
+		if (texture.data && entry.firstPlaceholderLevel > 0) {
+			const D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex2D(
+				getTextureFormat(texture.getFormat()), texture.width, texture.height, 1u, static_cast<UINT16>(texture.getMipLevelCount()));
+			entry.residentSize = getAllocationSize(pDevice, desc);
+			entry.uploadSize = DXUtil::getTextureUploadSize(pDevice, desc);
+		}
+	}
+}
+
+void Engine::TextureResidencyManager::init(wrl::ComPtr<ID3D12GraphicsCommandList4> pCommandList)
+{
+	// Runs once before the first frame, so every upload gets an upload heap of its own
+	auto allocateUpload = [this](size_t size) {
+		HRESULT hr;
+		initUploadBuffers.push_back(DXUtil::createCommittedResource(pDevice, D3D12_HEAP_TYPE_UPLOAD, size, D3D12_RESOURCE_STATE_GENERIC_READ));
+
+		void* pData;
+		const D3D12_RANGE readRange = { 0, 0 };
+		GFXTHROWIFFAILED(initUploadBuffers.back()->Map(0, &readRange, &pData));
+		return DXUtil::UploadAllocation{ initUploadBuffers.back().Get(), 0, static_cast<uint8_t*>(pData) };
+	};
+
+	for (size_t i = 0; i < entries.size(); ++i) {
+		auto& entry = entries[i];
+		if (i < textures.size() && textures[i].data && textures[i].width > 0 && textures[i].height > 0) {
+			entry.placeholder = uploadLevels(pCommandList, textures[i], entry.firstPlaceholderLevel, allocateUpload);
+		}
+		else {
+			// Missing image (or no textures at all)
+			entry.placeholder = DXUtil::createTextureCommittedResource(
+				pDevice, D3D12_HEAP_TYPE_DEFAULT, 1, 1, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_FLAG_NONE, DXGI_FORMAT_R8G8B8A8_UNORM);
+		}
+
+		placeholderSize += getAllocationSize(pDevice, entry.placeholder->GetDesc());
+	}
+
+	// One frame number per texture, zero meaning never sampled
+	const vector<uint32_t> zeros(entries.size(), 0);
+	const size_t feedbackSize = zeros.size() * sizeof(uint32_t);
+	feedbackBuffer = DXUtil::createCommittedResource(pDevice, D3D12_HEAP_TYPE_DEFAULT, feedbackSize, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+	DXUtil::updateDataInDefaultHeap(pCommandList, feedbackBuffer, allocateUpload, zeros.data(), feedbackSize,
+		D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+	for (auto& frameSlot : frameSlots) {
+		frameSlot.feedbackReadback = DXUtil::createCommittedResource(pDevice, D3D12_HEAP_TYPE_READBACK, feedbackSize, D3D12_RESOURCE_STATE_COPY_DEST);
+		frameSlot.frameNumber = 0;
+	}
+}
+
+void Engine::TextureResidencyManager::createViews(DescriptorHeap& descriptorHeap, std::size_t feedbackEntry, GpuDescriptorHeap& gpuDescriptorHeap)
+{
+	this->gpuDescriptorHeap = &gpuDescriptorHeap;
+
+	D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+	uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+	uavDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+	uavDesc.Buffer.NumElements = static_cast<UINT>(entries.size());
+	uavDesc.Buffer.StructureByteStride = sizeof(uint32_t);
+	descriptorHeap.setUAV(feedbackEntry, uavDesc, pDevice, feedbackBuffer);
+
+	for (UINT slot = 0; slot < frameSlots.size(); ++slot) {
+		frameSlots[slot].firstTextureDescriptor = gpuDescriptorHeap.allocate(static_cast<UINT>(entries.size())).index;
+		for (size_t i = 0; i < entries.size(); ++i) {
+			setView(i, slot);
+		}
+	}
+}
+
+void Engine::TextureResidencyManager::update(wrl::ComPtr<ID3D12GraphicsCommandList4> pCommandList, CommandQueue& commandQueue, UploadRingBuffer& uploadRingBuffer, UINT frameSlot, std::uint32_t frameNumber)
+{
+	currentFrameNumber = frameNumber;
+	initUploadBuffers.clear();
+
+	// The GPU is done with the last frame that used this slot, so its descriptors can be brought up to date
+	FrameSlot& slot = frameSlots[frameSlot];
+
+	for (const size_t i : slot.staleViews) {
+		setView(i, frameSlot);
+	}
+	slot.staleViews.clear();
+
+	const uint64_t completedFenceValue = commandQueue.getCompletedFenceValue();
+	while (!retiredResources.empty() && retiredResources.front().fenceValue <= completedFenceValue) {
+		retiredResources.pop_front();
+	}
+
+	const uint32_t feedbackFrame = slot.frameNumber;
+	vector<size_t> requested;
+	if (feedbackFrame != 0) {
+		const size_t feedbackSize = entries.size() * sizeof(uint32_t);
+		const D3D12_RANGE readRange = { 0, feedbackSize };
+		const D3D12_RANGE writeRange = { 0, 0 };
+		void* mapped;
+
+		HRESULT hr;
+		GFXTHROWIFFAILED(slot.feedbackReadback->Map(0, &readRange, &mapped));
+		const uint32_t* feedback = static_cast<const uint32_t*>(mapped);
+
+		for (size_t i = 0; i < textures.size(); ++i) {
+			auto& entry = entries[i];
+			if (feedback[i] <= entry.lastUsedFrame) {
+				continue;
+			}
+
+			entry.lastUsedFrame = feedback[i];
+			if (entry.resident) {
+				lru.splice(lru.end(), lru, entry.lruPosition);
+			}
+			else if (isStreamable(i)) {
+				requested.push_back(i);
+			}
+		}
+
+		slot.feedbackReadback->Unmap(0, &writeRange);
+	}
+
+	// Pick what to evict and what to load. Textures sampled in the feedback frame are never evicted.
+	auto canEvictFront = [&]() {
+		return !lru.empty() && entries[lru.front()].lastUsedFrame < feedbackFrame;
+	};
+
+	vector<size_t> evicted, loaded;
+	uint64_t newResidentSize = residentSize;
+	auto evictFront = [&]() {
+		evicted.push_back(lru.front());
+		newResidentSize -= entries[lru.front()].residentSize;
+		lru.pop_front();
+	};
+
+	// The budget may have been lowered
+	while (newResidentSize > budget && canEvictFront()) {
+		evictFront();
+	}
+
+	uint64_t uploadSize = 0;
+	for (const size_t i : requested) {
+		const uint64_t size = entries[i].residentSize;
+		if (uploadSize + entries[i].uploadSize > maxUploadSizePerFrame) {
+			// The rest is requested again next frame, if it is still being sampled
+			break;
+		}
+
+		while (newResidentSize + size > budget && canEvictFront()) {
+			evictFront();
+		}
+
+		if (newResidentSize + size > budget) {
+			continue;
+		}
+
+		loaded.push_back(i);
+		newResidentSize += size;
+		uploadSize += entries[i].uploadSize;
+	}
+
+	if (evicted.empty() && loaded.empty()) {
+		return;
+	}
+
+	// Frames in flight may still sample the evicted textures through their own descriptors, until the last one submitted completes
+	const uint64_t retireFenceValue = commandQueue.getLastSignaledFenceValue();
+	for (const size_t i : evicted) {
+		evict(i, frameSlot, retireFenceValue);
+	}
+
+	const DXUtil::UploadAllocator allocateUpload = uploadRingBuffer.getAllocator(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+	for (const size_t i : loaded) {
+		auto& entry = entries[i];
+		entry.resident = uploadLevels(pCommandList, textures[i], 0, allocateUpload);
+		entry.lruPosition = lru.insert(lru.end(), i);
+		residentSize += entry.residentSize;
+		changeView(i, frameSlot);
+	}
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE Engine::TextureResidencyManager::getTextureTable(UINT frameSlot) const
+{
+	return gpuDescriptorHeap->getGpuHandle(frameSlots[frameSlot].firstTextureDescriptor);
+}
+
+void Engine::TextureResidencyManager::copyFeedback(wrl::ComPtr<ID3D12GraphicsCommandList4> pCommandList, UINT frameSlot)
+{
+	FrameSlot& slot = frameSlots[frameSlot];
+
+	pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(feedbackBuffer.Get(), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE));
+	pCommandList->CopyBufferRegion(slot.feedbackReadback.Get(), 0, feedbackBuffer.Get(), 0, entries.size() * sizeof(uint32_t));
+	pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(feedbackBuffer.Get(), D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+
+	slot.frameNumber = currentFrameNumber;
+}
+
+void Engine::TextureResidencyManager::drawUI()
+{
+	ImGui::PushID(this);
+
+	constexpr float megabyte = 1024.f * 1024.f;
+	ImGui::Text("Resident: %zu / %zu", lru.size(), textures.size());
+	ImGui::Text("Full resolution: %.1f MB", residentSize / megabyte);
+	ImGui::Text("Placeholders: %.1f MB", placeholderSize / megabyte);
+
+	int budgetInMegabytes = static_cast<int>(budget >> 20);
+	if (ImGui::SliderInt("Budget (MB)", &budgetInMegabytes, 16, 8192)) {
+		setBudget(static_cast<uint64_t>(budgetInMegabytes) << 20);
+	}
+
+	ImGui::PopID();
+}
+
+std::size_t Engine::TextureResidencyManager::getTextureCount() const
+{
+	return entries.size();
+}
+
+std::uint64_t Engine::TextureResidencyManager::getBudget() const
+{
+	return budget;
+}
+
+void Engine::TextureResidencyManager::setBudget(std::uint64_t budget)
+{
+	// Applied on the next update
+	this->budget = budget;
+}
+
+std::uint64_t Engine::TextureResidencyManager::getResidentSize() const
+{
+	return residentSize;
+}
+
+int Engine::TextureResidencyManager::getFirstPlaceholderLevel(const Texture& texture)
+{
+	int level = 0;
+	while (level + 1 < texture.getMipLevelCount() &&
+		   std::max(texture.getMipLevel(level).width, texture.getMipLevel(level).height) > placeholderDimension) {
+		++level;
+	}
+
+	// The top level of a block compressed resource must be a whole number of blocks
+	constexpr int blockDimension = BlockCompression::blockDimension;
+	if (texture.getFormat() != Texture::RGBA8) {
+		while (level > 0 && (texture.getMipLevel(level).width % blockDimension != 0 || texture.getMipLevel(level).height % blockDimension != 0)) {
+			--level;
+		}
+	}
+
+	return level;
+}
+
+bool Engine::TextureResidencyManager::isStreamable(std::size_t textureIndex) const
+{
+	return textureIndex < textures.size() && entries[textureIndex].uploadSize > 0 && entries[textureIndex].uploadSize <= maxUploadSizePerFrame;
+}
+
+wrl::ComPtr<ID3D12Resource> Engine::TextureResidencyManager::uploadLevels(wrl::ComPtr<ID3D12GraphicsCommandList4> pCommandList, const Texture& texture, int firstLevel,
+	const DXUtil::UploadAllocator& allocateUpload)
+{
+	const auto& mipLevel = texture.getMipLevel(firstLevel);
+
+	return DXUtil::uploadTextureDataToDefaultHeap(
+		pDevice,
+		pCommandList,
+		allocateUpload,
+		texture.getMipLevelData(firstLevel),
+		mipLevel.width,
+		mipLevel.height,
+		getTextureElementSize(texture),
+		getTextureFormat(texture.getFormat()),
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+		static_cast<UINT16>(texture.getMipLevelCount() - firstLevel));
+}
+
+void Engine::TextureResidencyManager::setView(std::size_t textureIndex, UINT frameSlot)
+{
+	const auto& entry = entries[textureIndex];
+	const auto& resource = entry.resident ? entry.resident : entry.placeholder;
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = resource->GetDesc().Format;
+	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MipLevels = static_cast<UINT>(-1); // all mips
+	pDevice->CreateShaderResourceView(resource.Get(), &srvDesc,
+		gpuDescriptorHeap->getCpuHandle(frameSlots[frameSlot].firstTextureDescriptor + static_cast<UINT>(textureIndex)));
+}
+
+void Engine::TextureResidencyManager::changeView(std::size_t textureIndex, UINT frameSlot)
+{
+	setView(textureIndex, frameSlot);
+
+	for (UINT slot = 0; slot < frameSlots.size(); ++slot) {
+		if (slot != frameSlot) {
+			frameSlots[slot].staleViews.push_back(textureIndex);
+		}
+	}
+}
+
+void Engine::TextureResidencyManager::evict(std::size_t textureIndex, UINT frameSlot, std::uint64_t fenceValue)
+{
+	auto& entry = entries[textureIndex];
+	retiredResources.push_back({ move(entry.resident), fenceValue });
+	residentSize -= entry.residentSize;
+	changeView(textureIndex, frameSlot);
+}
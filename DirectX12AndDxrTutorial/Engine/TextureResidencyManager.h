@@ -0,0 +1,116 @@
+#pragma once
+#define NOMINMAX
+
+#include <d3d12.h>
+#include <wrl/client.h>
+#include <cstdint>
+#include <list>
+#include <deque>
+#include <vector>
+
+#include "Engine/Texture.h"
+#include "Engine/CommandQueue.h"
+#include "Engine/ShadingTable.h"
+#include "Engine/GpuDescriptorHeap.h"
+#include "Engine/UploadRingBuffer.h"
+#include "Util/DXUtil.h"
+
+namespace Engine {
+	// Streams full resolution textures in and out of GPU memory.
+	// Every texture starts out as a small placeholder (its smallest mips). The shaders write the frame number into a
+	// feedback buffer for every texture they sample, which is read back once the frame is done. Sampled textures are
+	// then uploaded in full, and the least recently sampled ones are evicted (back to their placeholder) to stay within the budget.
+	// Every frame slot has its own copy of the texture descriptors, so views only change in the copy of the frame being recorded
+	// while the frames in flight keep theirs, and evicted textures are released once the frames that could sample them are done.
+	class TextureResidencyManager {
+	public:
+		// Placeholders hold the mips up to this size
+		static constexpr int placeholderDimension = 64;
+		static constexpr std::uint64_t defaultBudget = 512ull << 20;
+		// Limits the upload work (and the hitch) of a single frame. Textures that need more upload space keep their placeholder.
+		static constexpr std::uint64_t maxUploadSizePerFrame = 32ull << 20;
+
+		// textures must outlive the manager. frameSlotCount is the number of frames in flight.
+		TextureResidencyManager(Microsoft::WRL::ComPtr<ID3D12Device5> pDevice, const std::vector<Texture>& textures, UINT frameSlotCount, std::uint64_t budget = defaultBudget);
+		TextureResidencyManager(const TextureResidencyManager&) = delete;
+		TextureResidencyManager& operator=(const TextureResidencyManager&) = delete;
+
+		// Records the placeholder uploads and the feedback buffer initialisation
+		void init(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList);
+		// Feedback UAV at feedbackEntry. The texture SRVs get one table per frame slot, allocated from gpuDescriptorHeap.
+		void createViews(DescriptorHeap& descriptorHeap, std::size_t feedbackEntry, GpuDescriptorHeap& gpuDescriptorHeap);
+
+		// Call at the start of frame frameNumber (starting at 1), once the GPU is done with the last frame that used frameSlot.
+		// Reads that frame's feedback, then evicts and uploads. Only frameSlot's descriptors are written. The uploads are staged
+		// in uploadRingBuffer, which only waits for the GPU if the frames in flight have filled it.
+		void update(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList, CommandQueue& commandQueue, UploadRingBuffer& uploadRingBuffer, UINT frameSlot, std::uint32_t frameNumber);
+		// Table of getTextureCount() SRVs to bind for the frame recorded in frameSlot
+		D3D12_GPU_DESCRIPTOR_HANDLE getTextureTable(UINT frameSlot) const;
+		// Call after the dispatch, copies the feedback into frameSlot's readback buffer
+		void copyFeedback(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList, UINT frameSlot);
+
+		void drawUI();
+
+		// At least one, a scene without textures gets a single placeholder
+		std::size_t getTextureCount() const;
+		std::uint64_t getBudget() const;
+		void setBudget(std::uint64_t budget);
+		// Full resolution textures only, placeholders are always resident
+		std::uint64_t getResidentSize() const;
+
+	private:
+		struct TextureEntry {
+			Microsoft::WRL::ComPtr<ID3D12Resource> placeholder;
+			Microsoft::WRL::ComPtr<ID3D12Resource> resident; // full resolution, null while evicted
+			int firstPlaceholderLevel; // 0 if the placeholder is the whole texture
+			std::uint64_t residentSize;
+			std::uint64_t uploadSize; // staging space of the full resolution texture, 0 if it isn't streamed
+			std::uint32_t lastUsedFrame;
+			std::list<std::size_t>::iterator lruPosition; // valid while resident
+		};
+
+		struct FrameSlot {
+			Microsoft::WRL::ComPtr<ID3D12Resource> feedbackReadback;
+			std::uint32_t frameNumber; // frame whose feedback is in feedbackReadback, 0 if none
+			UINT firstTextureDescriptor;
+			std::vector<std::size_t> staleViews; // textures whose view changed since this slot's copy was written
+		};
+
+		// Evicted texture, released once the queue reaches fenceValue
+		struct RetiredResource {
+			Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+			std::uint64_t fenceValue;
+		};
+
+		// First level small enough for the placeholder that is still a valid top level for the texture's format
+		static int getFirstPlaceholderLevel(const Texture& texture);
+		bool isStreamable(std::size_t textureIndex) const;
+
+		Microsoft::WRL::ComPtr<ID3D12Resource> uploadLevels(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList, const Texture& texture, int firstLevel,
+			const Util::DXUtil::UploadAllocator& allocateUpload);
+		void setView(std::size_t textureIndex, UINT frameSlot);
+		// Writes the view into frameSlot's copy and marks it stale in the others
+		void changeView(std::size_t textureIndex, UINT frameSlot);
+		void evict(std::size_t textureIndex, UINT frameSlot, std::uint64_t fenceValue);
+
+		Microsoft::WRL::ComPtr<ID3D12Device5> pDevice;
+		const std::vector<Texture>& textures;
+		std::vector<TextureEntry> entries;
+		std::vector<FrameSlot> frameSlots;
+
+		// Resident textures, least recently used first
+		std::list<std::size_t> lru;
+
+		std::deque<RetiredResource> retiredResources;
+		// Staging of init, released on the first update, by which time the init commands have completed
+		std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> initUploadBuffers;
+
+		Microsoft::WRL::ComPtr<ID3D12Resource> feedbackBuffer;
+		GpuDescriptorHeap* gpuDescriptorHeap;
+
+		std::uint32_t currentFrameNumber;
+		std::uint64_t budget;
+		std::uint64_t residentSize;
+		std::uint64_t placeholderSize;
+	};
+}
@@ -0,0 +1,169 @@
+#include "TiledTexture.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "BlockCompression.h"
+#include "Util/ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace {
+	constexpr int tileDimension = Engine::TiledTexture::tileDimension;
+	constexpr size_t tileSize = tileDimension * tileDimension * 4;
+
+	// Bits of a 3 bit coordinate spread out to every other bit
+	constexpr uint8_t mortonSpread[tileDimension] = { 0, 1, 4, 5, 16, 17, 20, 21 };
+
+	inline int wrap(int value, int size)
+	{
+		value %= size;
+		return value < 0 ? value + size : value;
+	}
+
+	inline XMVECTOR loadTexel(const uint8_t* texel)
+	{
+		return XMVectorScale(XMVectorSet(texel[0], texel[1], texel[2], texel[3]), 1.f / 255.f);
+	}
+}
+
+Engine::TiledTexture::TiledTexture(const Texture& texture)
+{
+	size_t offset = 0;
+	for (int i = 0; i < texture.getMipLevelCount(); ++i) {
+		const auto& mipLevel = texture.getMipLevel(i);
+		const int tilesPerRow = (mipLevel.width + tileDimension - 1) / tileDimension;
+		const int tileRows = (mipLevel.height + tileDimension - 1) / tileDimension;
+		levels.push_back({ mipLevel.width, mipLevel.height, tilesPerRow, offset });
+		offset += static_cast<size_t>(tilesPerRow) * tileRows * tileSize;
+	}
+
+	data.resize(offset);
+	if (!texture.data) {
+		return;
+	}
+
+	const Texture::Format format = texture.getFormat();
+	const size_t blockSize = format == Texture::BC1 ? BlockCompression::bc1BlockSize : BlockCompression::bc7BlockSize;
+	constexpr int blockDimension = BlockCompression::blockDimension;
+
+	for (int i = 0; i < getMipLevelCount(); ++i) {
+		const Level& level = levels[i];
+		const uint8_t* src = texture.getMipLevelData(i);
+		uint8_t* dst = data.data() + level.offset;
+
+		// One task per row of tiles
+		const int tileRows = (level.height + tileDimension - 1) / tileDimension;
+		Util::ThreadPool::getDefault().parallelFor(tileRows, [&](size_t tileRow) {
+			const int yBegin = static_cast<int>(tileRow) * tileDimension;
+			const int yEnd = std::min(level.height, yBegin + tileDimension);
+
+			if (format == Texture::RGBA8) {
+				for (int y = yBegin; y < yEnd; ++y) {
+					for (int x = 0; x < level.width; ++x) {
+						memcpy(dst + getTexelOffset(x, y, level.tilesPerRow), src + (static_cast<size_t>(y) * level.width + x) * texture.channels, 4);
+					}
+				}
+				return;
+			}
+
+			const int blocksPerRow = (level.width + blockDimension - 1) / blockDimension;
+			for (int blockY = yBegin / blockDimension; blockY * blockDimension < yEnd; ++blockY) {
+				for (int blockX = 0; blockX < blocksPerRow; ++blockX) {
+					uint8_t rgba[blockDimension * blockDimension * 4];
+					const uint8_t* block = src + (static_cast<size_t>(blockY) * blocksPerRow + blockX) * blockSize;
+					if (format == Texture::BC1) {
+						BlockCompression::decodeBC1Block(block, rgba);
+					}
+					else {
+						BlockCompression::decodeBC7Block(block, rgba);
+					}
+
+					// Texels outside a partial block are padding
+					for (int y = 0; y < blockDimension && blockY * blockDimension + y < level.height; ++y) {
+						for (int x = 0; x < blockDimension && blockX * blockDimension + x < level.width; ++x) {
+							memcpy(dst + getTexelOffset(blockX * blockDimension + x, blockY * blockDimension + y, level.tilesPerRow),
+								rgba + (y * blockDimension + x) * 4, 4);
+						}
+					}
+				}
+			}
+		});
+	}
+}
+
+DirectX::XMVECTOR Engine::TiledTexture::sample(float u, float v, int level) const
+{
+	const Level& l = levels[std::clamp(level, 0, getMipLevelCount() - 1)];
+	if (l.width <= 0 || l.height <= 0) {
+		return XMVectorZero();
+	}
+
+	// Texel centres are at half integers
+	const float x = u * l.width - 0.5f;
+	const float y = v * l.height - 0.5f;
+	const float x0f = std::floor(x);
+	const float y0f = std::floor(y);
+	const float fx = x - x0f;
+	const float fy = y - y0f;
+
+	const int x0 = wrap(static_cast<int>(x0f), l.width);
+	const int y0 = wrap(static_cast<int>(y0f), l.height);
+	const int x1 = x0 + 1 == l.width ? 0 : x0 + 1;
+	const int y1 = y0 + 1 == l.height ? 0 : y0 + 1;
+
+	const XMVECTOR top = XMVectorLerp(loadTexel(getTexel(l, x0, y0)), loadTexel(getTexel(l, x1, y0)), fx);
+	const XMVECTOR bottom = XMVectorLerp(loadTexel(getTexel(l, x0, y1)), loadTexel(getTexel(l, x1, y1)), fx);
+	return XMVectorLerp(top, bottom, fy);
+}
+
+DirectX::XMVECTOR Engine::TiledTexture::sampleLevel(float u, float v, float lod) const
+{
+	lod = std::clamp(lod, 0.f, static_cast<float>(getMipLevelCount() - 1));
+	const int level = static_cast<int>(lod);
+	const float t = lod - level;
+	if (t == 0.f) {
+		return sample(u, v, level);
+	}
+
+	return XMVectorLerp(sample(u, v, level), sample(u, v, level + 1), t);
+}
+
+DirectX::XMVECTOR Engine::TiledTexture::load(int x, int y, int level) const
+{
+	const Level& l = levels[std::clamp(level, 0, getMipLevelCount() - 1)];
+	if (l.width <= 0 || l.height <= 0) {
+		return XMVectorZero();
+	}
+
+	return loadTexel(getTexel(l, wrap(x, l.width), wrap(y, l.height)));
+}
+
+int Engine::TiledTexture::getMipLevelCount() const
+{
+	return static_cast<int>(levels.size());
+}
+
+int Engine::TiledTexture::getWidth(int level) const
+{
+	return levels[level].width;
+}
+
+int Engine::TiledTexture::getHeight(int level) const
+{
+	return levels[level].height;
+}
+
+std::size_t Engine::TiledTexture::getTexelOffset(int x, int y, int tilesPerRow)
+{
+	const size_t tileIndex = static_cast<size_t>(y / tileDimension) * tilesPerRow + x / tileDimension;
+	const size_t texelIndex = mortonSpread[x % tileDimension] | (mortonSpread[y % tileDimension] << 1);
+	return tileIndex * tileSize + texelIndex * 4;
+}
+
+const std::uint8_t* Engine::TiledTexture::getTexel(const Level& level, int x, int y) const
+{
+	return data.data() + level.offset + getTexelOffset(x, y, level.tilesPerRow);
+}
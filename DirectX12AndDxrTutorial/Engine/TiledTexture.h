@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <DirectXMath.h>
+#include "Engine/Texture.h"
+
+namespace Engine {
+	// RGBA8 copy of a texture for sampling on the CPU.
+	// Every mip level is stored as 8x8 tiles (row by row), with the texels of a tile in Z-order (Morton order),
+	// so texels that are close in 2D are close in memory regardless of the lookup direction.
+	// Block compressed textures are decoded when the copy is made.
+	class TiledTexture {
+	public:
+		static constexpr int tileDimension = 8;
+
+		TiledTexture(const Texture& texture);
+
+		// Bilinear filtering with wrap addressing (same as the static sampler in RTGraphics), colour in [0, 1]
+		DirectX::XMVECTOR sample(float u, float v, int level = 0) const;
+		// Trilinear filtering between the two closest levels
+		DirectX::XMVECTOR sampleLevel(float u, float v, float lod) const;
+		// Single texel, x and y are wrapped
+		DirectX::XMVECTOR load(int x, int y, int level = 0) const;
+
+		int getMipLevelCount() const;
+		int getWidth(int level = 0) const;
+		int getHeight(int level = 0) const;
+
+		// Byte offset of texel (x, y) within a level with tilesPerRow tiles in each row of tiles
+		static std::size_t getTexelOffset(int x, int y, int tilesPerRow);
+
+	private:
+		struct Level {
+			int width;
+			int height;
+			int tilesPerRow;
+			std::size_t offset;
+		};
+
+		const std::uint8_t* getTexel(const Level& level, int x, int y) const;
+
+		std::vector<Level> levels;
+		std::vector<std::uint8_t> data;
+	};
+}
@@ -0,0 +1,91 @@
+#include "UploadBatcher.h"
+
+#include <cstring>
+
+#include "Libraries/d3dx12.h"
+#include "Util/DXUtil.h"
+#include "Exception/Exception.h"
+#include "Exception/WindowException.h"
+
+namespace wrl = Microsoft::WRL;
+
+using namespace std;
+using namespace Util;
+
+Engine::UploadBatcher::UploadBatcher(wrl::ComPtr<ID3D12Device5> pDevice, UINT64 pageSize)
+	: pDevice(pDevice), pageSize(pageSize), stagingSize()
+{
+}
+
+wrl::ComPtr<ID3D12Resource> Engine::UploadBatcher::createBuffer(const void* ptData, std::size_t dataSize, D3D12_RESOURCE_STATES finalState)
+{
+	wrl::ComPtr<ID3D12Resource> pResource = DXUtil::createCommittedResource(pDevice, D3D12_HEAP_TYPE_DEFAULT, dataSize, D3D12_RESOURCE_STATE_COPY_DEST);
+	pendingUploads.push_back({ pResource, ptData, dataSize, finalState });
+
+	return pResource;
+}
+
+void Engine::UploadBatcher::record(wrl::ComPtr<ID3D12GraphicsCommandList4> pCommandList)
+{
+	HRESULT hr;
+
+	if (pendingUploads.empty()) {
+		return;
+	}
+
+	StagingPacker packer(pageSize);
+	vector<StagingPacker::Placement> placements;
+	placements.reserve(pendingUploads.size());
+	for (const auto& upload : pendingUploads) {
+		placements.push_back(packer.add(upload.dataSize, defaultAlignment));
+	}
+
+	// Create and fill the pages
+	const size_t firstPage = stagingPages.size();
+	vector<uint8_t*> pageData(packer.getPageSizes().size());
+	const D3D12_RANGE readRange = { 0, 0 };
+
+	for (size_t page = 0; page < pageData.size(); ++page) {
+		stagingPages.push_back(DXUtil::createCommittedResource(pDevice, D3D12_HEAP_TYPE_UPLOAD, packer.getPageSizes()[page], D3D12_RESOURCE_STATE_GENERIC_READ));
+		GFXTHROWIFFAILED(stagingPages.back()->Map(0, &readRange, reinterpret_cast<void**>(&pageData[page])));
+	}
+
+	for (size_t i = 0; i < pendingUploads.size(); ++i) {
+		memcpy(pageData[placements[i].page] + placements[i].offset, pendingUploads[i].ptData, pendingUploads[i].dataSize);
+	}
+
+	for (size_t page = firstPage; page < stagingPages.size(); ++page) {
+		stagingPages[page]->Unmap(0, nullptr);
+	}
+
+	// Every destination was created in the copy dest state, only the final transitions are needed
+	vector<D3D12_RESOURCE_BARRIER> barriers;
+	barriers.reserve(pendingUploads.size());
+
+	for (size_t i = 0; i < pendingUploads.size(); ++i) {
+		const PendingUpload& upload = pendingUploads[i];
+		pCommandList->CopyBufferRegion(upload.pResource.Get(), 0, stagingPages[firstPage + placements[i].page].Get(), placements[i].offset, upload.dataSize);
+
+		if (upload.finalState != D3D12_RESOURCE_STATE_COPY_DEST) {
+			barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(upload.pResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, upload.finalState));
+		}
+	}
+
+	if (!barriers.empty()) {
+		pCommandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+	}
+
+	stagingSize += packer.getTotalSize();
+	pendingUploads.clear();
+}
+
+void Engine::UploadBatcher::release()
+{
+	stagingPages.clear();
+	stagingSize = 0;
+}
+
+UINT64 Engine::UploadBatcher::getStagingSize() const
+{
+	return stagingSize;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#define NOMINMAX
+
+#include <d3d12.h>
+#include <wrl/client.h>
+#include <cstdint>
+#include <vector>
+
+#include "Util/StagingPacker.h"
+
+namespace Engine {
+	// Collects buffer uploads and stages them together: record packs all pending data into a few large upload pages
+	// (see Util::StagingPacker) and records every copy in one pass. Replaces one upload heap per uploadDataToDefaultHeap call.
+	class UploadBatcher {
+	public:
+		static constexpr UINT64 defaultPageSize = 32ull << 20;
+		// Buffer copies have no placement requirement, this keeps the staged data vector aligned
+		static constexpr UINT64 defaultAlignment = 16;
+
+		UploadBatcher(Microsoft::WRL::ComPtr<ID3D12Device5> pDevice, UINT64 pageSize = defaultPageSize);
+		UploadBatcher(const UploadBatcher&) = delete;
+		UploadBatcher& operator=(const UploadBatcher&) = delete;
+
+		// The buffer is created right away, ptData is only read by record and has to stay valid until then
+		Microsoft::WRL::ComPtr<ID3D12Resource> createBuffer(const void* ptData, std::size_t dataSize, D3D12_RESOURCE_STATES finalState);
+
+		// Stages the pending uploads and records their copies. The staging pages are kept until release,
+		// which may only be called once the command list has executed.
+		void record(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList);
+		void release();
+
+		UINT64 getStagingSize() const;
+
+	private:
+		struct PendingUpload {
+			Microsoft::WRL::ComPtr<ID3D12Resource> pResource;
+			const void* ptData;
+			std::size_t dataSize;
+			D3D12_RESOURCE_STATES finalState;
+		};
+
+		Microsoft::WRL::ComPtr<ID3D12Device5> pDevice;
+		UINT64 pageSize;
+		std::vector<PendingUpload> pendingUploads;
+		std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> stagingPages;
+		UINT64 stagingSize;
+	};
+}
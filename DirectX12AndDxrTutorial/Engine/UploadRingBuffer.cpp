@@ -0,0 +1,69 @@
+#include "UploadRingBuffer.h"
+
+#include "Exception/Exception.h"
+#include "Exception/WindowException.h"
+
+namespace wrl = Microsoft::WRL;
+
+using namespace std;
+using namespace Util;
+
+Engine::UploadRingBuffer::UploadRingBuffer(wrl::ComPtr<ID3D12Device5> pDevice, CommandQueue& commandQueue, UINT64 capacity)
+	: commandQueue(commandQueue), pMappedData(), ring(capacity)
+{
+	HRESULT hr;
+
+	pUploadBuffer = DXUtil::createCommittedResource(pDevice, D3D12_HEAP_TYPE_UPLOAD, capacity, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+	// Upload heaps may stay mapped for their whole lifetime
+	const D3D12_RANGE readRange = { 0, 0 };
+	GFXTHROWIFFAILED(pUploadBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pMappedData)));
+}
+
+Engine::UploadRingBuffer::~UploadRingBuffer()
+{
+	pUploadBuffer->Unmap(0, nullptr);
+}
+
+Util::DXUtil::UploadAllocation Engine::UploadRingBuffer::allocate(UINT64 size, UINT64 alignment)
+{
+	if (size > ring.getCapacity()) {
+		ThrowException("Upload of " + to_string(size) + " bytes exceeds the upload ring buffer's capacity");
+	}
+
+	ring.release(commandQueue.getCompletedFenceValue());
+
+	uint64_t offset = ring.allocate(size, alignment);
+	while (offset == RingAllocator::invalidOffset) {
+		if (!ring.hasPendingFrames()) {
+			ThrowException("Upload of " + to_string(size) + " bytes doesn't fit into the upload ring buffer in a single frame");
+		}
+
+		// Full, wait for the oldest frame
+		commandQueue.waitForFenceValue(ring.getOldestFenceValue());
+		ring.release(ring.getOldestFenceValue());
+		offset = ring.allocate(size, alignment);
+	}
+
+	return { pUploadBuffer.Get(), offset, pMappedData + offset };
+}
+
+Util::DXUtil::UploadAllocator Engine::UploadRingBuffer::getAllocator(UINT64 alignment)
+{
+	return [this, alignment](size_t size) { return allocate(size, alignment); };
+}
+
+void Engine::UploadRingBuffer::finishFrame(std::uint64_t fenceValue)
+{
+	ring.finishFrame(fenceValue);
+}
+
+UINT64 Engine::UploadRingBuffer::getCapacity() const
+{
+	return ring.getCapacity();
+}
+
+UINT64 Engine::UploadRingBuffer::getUsedSize() const
+{
+	return ring.getUsedSize();
+}
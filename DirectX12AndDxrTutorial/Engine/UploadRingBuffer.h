@@ -0,0 +1,44 @@
+#pragma once
+#define NOMINMAX
+
+#include <d3d12.h>
+#include <wrl/client.h>
+#include <cstdint>
+
+#include "Engine/CommandQueue.h"
+#include "Util/DXUtil.h"
+#include "Util/RingAllocator.h"
+
+namespace Engine {
+	// Persistently mapped upload heap that per frame uploads (constants, matrices, instance descs, streamed textures) are suballocated from.
+	// Space is recycled once the command queue's fence passes the frame that used it, so the frame loop never creates upload heaps.
+	class UploadRingBuffer {
+	public:
+		// Has to hold a frame's texture streaming (TextureResidencyManager::maxUploadSizePerFrame) next to everything else
+		static constexpr UINT64 defaultCapacity = 64ull << 20;
+		// Enough for copies and instance descs, constant buffer views need D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT
+		static constexpr UINT64 defaultAlignment = 16;
+
+		UploadRingBuffer(Microsoft::WRL::ComPtr<ID3D12Device5> pDevice, CommandQueue& commandQueue, UINT64 capacity = defaultCapacity);
+		UploadRingBuffer(const UploadRingBuffer&) = delete;
+		UploadRingBuffer& operator=(const UploadRingBuffer&) = delete;
+		virtual ~UploadRingBuffer();
+
+		// Waits for the GPU to finish older frames if the ring is full. Throws if size exceeds the capacity.
+		Util::DXUtil::UploadAllocation allocate(UINT64 size, UINT64 alignment = defaultAlignment);
+		// For the DXUtil upload functions
+		Util::DXUtil::UploadAllocator getAllocator(UINT64 alignment = defaultAlignment);
+
+		// Call once the command list that uses this frame's allocations has been executed, with the fence value it signalled
+		void finishFrame(std::uint64_t fenceValue);
+
+		UINT64 getCapacity() const;
+		UINT64 getUsedSize() const;
+
+	private:
+		CommandQueue& commandQueue;
+		Microsoft::WRL::ComPtr<ID3D12Resource> pUploadBuffer;
+		std::uint8_t* pMappedData;
+		Util::RingAllocator ring;
+	};
+}
@@ -13,6 +13,8 @@ SamplerState gSampler : register(s0);
 // Output texture
 RWTexture2D<float4> gOutput : register(u0);
 RWTexture2D<float4> gRadiance : register(u1);
+// Frame number each texture was last sampled in, read back for texture streaming
+RWStructuredBuffer<uint> gTextureFeedback : register(u2);
 
 cbuffer CB1 : register(b0) 
 {
@@ -43,7 +45,23 @@ uint getPrimitiveIndex() {
 	return InstanceID() + PrimitiveIndex();
 }
 
-float3 getDiffuseValue(uint primitiveId, uint materialId, float2 bary) {
+// Ray cone texture LOD (Akenine-Moller et al., "Texture Level of Detail Strategies for Real-Time Ray Tracing")
+// coneWidth is the cone's width at the hit point, cosAngle the cosine between the ray and the surface normal
+float getTextureLod(uint primitiveId, uint instanceIndex, float2 a0, float2 a1, float2 a2, float2 textureSize, float coneWidth, float cosAngle) {
+	const uint index = primitiveId * 3;
+	const float3 p0 = mul(float4(verts.Load(index), 1.f), matrices[instanceIndex]);
+	const float3 p1 = mul(float4(verts.Load(index + 1), 1.f), matrices[instanceIndex]);
+	const float3 p2 = mul(float4(verts.Load(index + 2), 1.f), matrices[instanceIndex]);
+
+	const float2 t1 = (a1 - a0) * textureSize;
+	const float2 t2 = (a2 - a0) * textureSize;
+	const float texelArea = abs(t1.x * t2.y - t1.y * t2.x);
+	const float worldArea = length(cross(p1 - p0, p2 - p0));
+
+	return 0.5f * log2(max(texelArea, 1e-12f) / max(worldArea, 1e-12f)) + log2(max(coneWidth, 1e-12f) / max(cosAngle, 1e-3f));
+}
+
+float3 getDiffuseValue(uint primitiveId, uint instanceIndex, uint materialId, float2 bary, float coneWidth, float cosAngle) {
 	if (materials[materialId].diffuseTextureId == -1) {
 		return (float3)materials[materialId].diffuse;
 	}
@@ -52,11 +70,27 @@ float3 getDiffuseValue(uint primitiveId, uint materialId, float2 bary) {
 	const float2 a0 = texVerts.Load(index);
 	const float2 a1 = texVerts.Load(index + 1);
 	const float2 a2 = texVerts.Load(index + 2);
-	const float2 pTex = a0 + bary.x * (a1 - a0) + bary.y * (a2 - a0);
-	return (float3)gTextures[materials[materialId].diffuseTextureId].SampleLevel(gSampler, pTex, 0);
+	float2 pTex = a0 + bary.x * (a1 - a0) + bary.y * (a2 - a0);
+
+	const int textureId = materials[materialId].diffuseTextureId;
+	gTextureFeedback[textureId] = cBuffer.frameNumber;
+
+	Texture2D diffuseTexture = gTextures[NonUniformResourceIndex(textureId)];
+	float2 textureSize;
+	diffuseTexture.GetDimensions(textureSize.x, textureSize.y);
+
+	// Textures packed into an atlas wrap inside their own rectangle
+	const float4 transform = materials[materialId].diffuseTextureTransform;
+	if (any(transform != float4(1.f, 1.f, 0.f, 0.f))) {
+		pTex = frac(pTex) * transform.xy + transform.zw;
+		textureSize *= transform.xy;
+	}
+
+	const float lod = getTextureLod(primitiveId, instanceIndex, a0, a1, a2, textureSize, coneWidth, cosAngle);
+	return (float3)diffuseTexture.SampleLevel(gSampler, pTex, lod);
 }
 
-float3 explicitLighting(inout uint seed, uint primitiveId, float3 interPoint, float3 unitNormal, uint materialId, float2 bary) {
+float3 explicitLighting(inout uint seed, uint primitiveId, float3 interPoint, float3 unitNormal, float3 diffuse) {
 	float3 radiance = float3(0.f, 0.f, 0.f);
 
 	const uint lightIndex = chooseInRange(seed, 0, cBuffer.numLights - 1);
@@ -123,9 +157,6 @@ float3 explicitLighting(inout uint seed, uint primitiveId, float3 interPoint, fl
 	// Get projected area
 	float projectedArea = getTriangleArea((float3[3]) a) * lightShadowDot / (lightDistance * lightDistance);
 
-	// Get diffuse of intersected material
-	float3 diffuse = getDiffuseValue(primitiveId, materialId, bary);
-
 	radiance = lightRadiance * diffuse;
 	radiance *= cBuffer.numLights * primitiveShadowDot * projectedArea  * OneOverPI;
 
@@ -215,11 +246,17 @@ void rayGen()
 void chs(inout RayPayload payload, in BuiltInTriangleIntersectionAttributes attribs)
 {
 	uint pIndex = getPrimitiveIndex();
+	uint instanceIndex = InstanceIndex();
 	
 	uint vIndex = pIndex * 3; 
-	float3 unitNormal = getUnitNormal(verts.Load(vIndex), verts.Load(vIndex + 1), verts.Load(vIndex + 2), InstanceIndex());
+	float3 unitNormal = getUnitNormal(verts.Load(vIndex), verts.Load(vIndex + 1), verts.Load(vIndex + 2), instanceIndex);
 	const float3 unitRayDir = normalize(WorldRayDirection());
 
+	// Primary ray cone starts at the camera with zero width.
+	// Flat triangles add no spread, so the cone keeps growing at the pixel's angle along the path.
+	float coneWidth = cBuffer.camera.pixelSpreadAngle * RayTCurrent() * length(WorldRayDirection());
+	float cosAngle = -dot(unitRayDir, unitNormal);
+
 	//Extract seed
 	uint seed = asuint(payload.color[0]);
 	payload.color = float3(0.f, 0.f, 0.f);
@@ -247,8 +284,11 @@ void chs(inout RayPayload payload, in BuiltInTriangleIntersectionAttributes attr
 			totalRadiance += localCoefficients * (float3)(cBuffer.areaLights[fAttr.areaLightId].intensity * materials[fAttr.materialId].emission);
 		}
 
+		// Diffuse of intersected material, used by both direct and indirect lighting
+		const float3 diffuse = getDiffuseValue(pIndex, instanceIndex, fAttr.materialId, bary, coneWidth, cosAngle);
+
 		// Add Direct (if r >= c)
-		totalRadiance += localCoefficients * explicitLighting(seed, pIndex, interPoint, unitNormal, fAttr.materialId, bary);
+		totalRadiance += localCoefficients * explicitLighting(seed, pIndex, interPoint, unitNormal, diffuse);
 		
 
 		// Add Indirect and Direct
@@ -284,16 +324,21 @@ void chs(inout RayPayload payload, in BuiltInTriangleIntersectionAttributes attr
 		}
 
 		// Compute coefficients for this iteration (diff / p_c)
-		localCoefficients *= getDiffuseValue(pIndex, fAttr.materialId, bary) / probabilityOfContinuing;
+		localCoefficients *= diffuse / probabilityOfContinuing;
 
 		// Get intersected face unit normal
 		pIndex = indirectPayload.primitiveId;
+		instanceIndex = indirectPayload.instanceIndex;
 		vIndex = pIndex * 3;
-		unitNormal = getUnitNormal(verts.Load(vIndex), verts.Load(vIndex + 1), verts.Load(vIndex + 2), indirectPayload.instanceIndex);
+		unitNormal = getUnitNormal(verts.Load(vIndex), verts.Load(vIndex + 1), verts.Load(vIndex + 2), instanceIndex);
 		if (dot(indirectRay.Direction, unitNormal) >= 0.f) {
 			break;
 		}
 
+		// Grow the cone along the new segment (indirectRay.Direction is unit)
+		coneWidth += cBuffer.camera.pixelSpreadAngle * indirectPayload.tHit;
+		cosAngle = -dot(indirectRay.Direction, unitNormal);
+
 		// Get intersected face material and attributes
 		fAttr = faceAttributes.Load(pIndex);
 		bary = indirectPayload.bary;
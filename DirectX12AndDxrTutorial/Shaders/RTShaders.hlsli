@@ -16,6 +16,7 @@ namespace Shaders {
 		DirectX::XMFLOAT4 emission;
 		std::int32_t diffuseTextureId;
 		std::uint32_t padding[3];
+		DirectX::XMFLOAT4 diffuseTextureTransform; // uv scale (xy) and offset (zw) into an atlas
 	};
 
 	struct FaceAttributes {
@@ -38,7 +39,7 @@ namespace Shaders {
 		float focalLength;
 		float apertureRadius;
 		Shaders::CameraType cameraType;
-		std::uint32_t padding[1];
+		float pixelSpreadAngle;
 	};
 
 	struct AreaLight {
@@ -56,6 +57,8 @@ namespace Shaders {
 		std::uint32_t seed1;
 		std::uint32_t seed2;
 		std::uint32_t clear;
+		std::uint32_t frameNumber; // written to the texture feedback buffer
+		std::uint32_t padding[3];
 	};
 }
 #else
@@ -64,6 +67,7 @@ struct Material {
 	float4 emission;
 	int diffuseTextureId;
 	int3 padding;
+	float4 diffuseTextureTransform;
 };
 
 struct FaceAttributes {
@@ -87,7 +91,7 @@ struct Camera {
 	float focalLength;
 	float apertureRadius;
 	Shaders::CameraType cameraType;
-	float padding;
+	float pixelSpreadAngle;
 };
 
 struct AreaLight {
@@ -105,6 +109,8 @@ struct ConstBuff {
 	uint seed1;
 	uint seed2;
 	uint clear;
+	uint frameNumber;
+	uint3 padding;
 };
 #endif
 
@@ -0,0 +1,116 @@
+#include "Util/BlasBuildPlan.h"
+
+#include <random>
+#include <vector>
+#include <algorithm>
+
+#include "Check.h"
+
+using namespace std;
+using Util::BlasBuildPlan;
+
+namespace {
+	void testOversizedBuild()
+	{
+		// The second build alone exceeds the budget, it gets a batch of its own and sets the arena size
+		const BlasBuildPlan plan({ 1000, 5000, 1000, 1000 }, { 100, 100, 100, 100 }, 2048);
+		const auto& batches = plan.getBatches();
+
+		CHECK(batches.size() == 3);
+		CHECK(batches[0].begin == 0 && batches[0].end == 1);
+		CHECK(batches[1].begin == 1 && batches[1].end == 2 && batches[1].scratchSize == BlasBuildPlan::align(5000));
+		CHECK(batches[2].begin == 2 && batches[2].end == 4 && batches[2].scratchSize == 2048);
+		CHECK(plan.getScratchArenaSize() == BlasBuildPlan::align(5000));
+
+		// Every batch starts at the beginning of the arena
+		for (const auto& batch : batches) {
+			CHECK(plan.getBuilds()[batch.begin].scratchOffset == 0);
+		}
+		CHECK(plan.getBuilds()[3].scratchOffset == 1024);
+	}
+
+	void testAlignment()
+	{
+		const vector<uint64_t> scratchSizes = { 1, 255, 256, 257 };
+		const vector<uint64_t> resultSizes = { 300, 1, 0, 513 };
+		const BlasBuildPlan plan(scratchSizes, resultSizes);
+		const auto& builds = plan.getBuilds();
+
+		CHECK(builds[0].scratchOffset == 0 && builds[1].scratchOffset == 256 && builds[2].scratchOffset == 512 && builds[3].scratchOffset == 768);
+		CHECK(builds[0].resultOffset == 0 && builds[1].resultOffset == 512 && builds[2].resultOffset == 768 && builds[3].resultOffset == 768);
+		CHECK(plan.getResultSize() == 768 + 768);
+		CHECK(plan.getScratchArenaSize() == 1280);
+
+		// Compacted copies are packed the same way
+		uint64_t compactedSize = 0;
+		const vector<uint64_t> compactedOffsets = BlasBuildPlan::pack({ 100, 256, 1 }, compactedSize);
+		CHECK(compactedOffsets == vector<uint64_t>({ 0, 256, 512 }));
+		CHECK(compactedSize == 768);
+	}
+
+	void testEmpty()
+	{
+		const BlasBuildPlan plan({}, {});
+		CHECK(plan.getBatches().empty());
+		CHECK(plan.getScratchArenaSize() == 0 && plan.getResultSize() == 0);
+	}
+
+	// Random sizes and budgets: batches cover all builds in order, stay within the budget (unless a single build) and
+	// never overlap, results are aligned and packed in order, and the arena is exactly as large as the largest batch
+	void testRandom()
+	{
+		mt19937_64 rng(3);
+		for (int trial = 0; trial < 2000; ++trial) {
+			const size_t count = rng() % 50;
+			const uint64_t budget = 1 + rng() % 100000;
+			vector<uint64_t> scratchSizes(count), resultSizes(count);
+			for (auto& size : scratchSizes) {
+				size = rng() % 20000;
+			}
+			for (auto& size : resultSizes) {
+				size = rng() % 20000;
+			}
+
+			const BlasBuildPlan plan(scratchSizes, resultSizes, budget);
+			const auto& builds = plan.getBuilds();
+			const auto& batches = plan.getBatches();
+
+			size_t next = 0;
+			uint64_t largestBatch = 0;
+			for (size_t b = 0; b < batches.size(); ++b) {
+				CHECK(batches[b].begin == next && batches[b].end > batches[b].begin);
+				CHECK(batches[b].scratchSize <= budget || batches[b].end - batches[b].begin == 1);
+				next = batches[b].end;
+				largestBatch = std::max(largestBatch, batches[b].scratchSize);
+
+				for (size_t i = batches[b].begin; i < batches[b].end; ++i) {
+					CHECK(builds[i].batch == b);
+					CHECK(builds[i].scratchOffset % BlasBuildPlan::alignment == 0);
+					CHECK(builds[i].scratchOffset + scratchSizes[i] <= batches[b].scratchSize);
+					if (i + 1 < batches[b].end) {
+						CHECK(builds[i].scratchOffset + scratchSizes[i] <= builds[i + 1].scratchOffset);
+					}
+				}
+			}
+			CHECK(next == count);
+			CHECK(plan.getScratchArenaSize() == largestBatch);
+
+			for (size_t i = 0; i < count; ++i) {
+				CHECK(builds[i].resultOffset % BlasBuildPlan::alignment == 0);
+				CHECK(builds[i].resultOffset + resultSizes[i] <= plan.getResultSize());
+				if (i + 1 < count) {
+					CHECK(builds[i].resultOffset + resultSizes[i] <= builds[i + 1].resultOffset);
+				}
+			}
+		}
+	}
+}
+
+int main()
+{
+	testOversizedBuild();
+	testAlignment();
+	testEmpty();
+	testRandom();
+	return 0;
+}
@@ -0,0 +1,139 @@
+#include "Util/BuddyAllocator.h"
+
+#include <random>
+#include <vector>
+
+#include "Check.h"
+
+using namespace std;
+using Util::BuddyAllocator;
+
+namespace {
+	void testSplitAndMerge()
+	{
+		BuddyAllocator allocator(1024, 64);
+		CHECK(allocator.getLargestFreeBlockSize() == 1024);
+
+		// Splits 1024 into 512 + 256 + 128 + 64 + 64, the lower half is handed out first
+		const uint64_t a = allocator.allocate(64);
+		CHECK(a == 0);
+		CHECK(allocator.getLargestFreeBlockSize() == 512);
+
+		// Takes the 64 byte buddy instead of splitting again
+		const uint64_t b = allocator.allocate(64);
+		CHECK(b == 64);
+
+		const uint64_t c = allocator.allocate(256);
+		CHECK(c == 256);
+		CHECK(allocator.getAllocationCount() == 3);
+		CHECK(allocator.getAllocatedSize() == 384);
+
+		// a's buddy (b) is still allocated, so nothing merges
+		allocator.free(a);
+		CHECK(allocator.getLargestFreeBlockSize() == 512);
+
+		// a and b merge into 128, then with the free 128 at 128 into 256. c keeps the rest from merging further.
+		allocator.free(b);
+		CHECK(allocator.allocate(256) == 0);
+		allocator.free(0);
+
+		allocator.free(c);
+		CHECK(allocator.isEmpty());
+		CHECK(allocator.getAllocatedSize() == 0);
+		CHECK(allocator.getLargestFreeBlockSize() == 1024);
+
+		// Unknown offsets are ignored
+		allocator.free(512);
+		CHECK(allocator.isEmpty());
+	}
+
+	void testRounding()
+	{
+		BuddyAllocator allocator(1024, 64);
+
+		// Sizes round up to a power of two block, at least the minimum block size
+		CHECK(allocator.allocate(1) == 0);
+		CHECK(allocator.getAllocatedSize() == 64);
+		CHECK(allocator.allocate(65) == 128);
+		CHECK(allocator.getAllocatedSize() == 64 + 128);
+
+		// Blocks are aligned to their size, a larger alignment takes a larger block
+		const uint64_t aligned = allocator.allocate(64, 256);
+		CHECK(aligned == 256);
+		CHECK(allocator.getAllocatedSize() == 64 + 128 + 256);
+		CHECK(allocator.allocate(64, 64) == 64);
+	}
+
+	void testOutOfSpace()
+	{
+		BuddyAllocator allocator(1024, 64);
+		CHECK(allocator.allocate(0) == BuddyAllocator::invalidOffset);
+		CHECK(allocator.allocate(1025) == BuddyAllocator::invalidOffset);
+		CHECK(allocator.allocate(1, 2048) == BuddyAllocator::invalidOffset);
+
+		CHECK(allocator.allocate(512) == 0);
+		CHECK(allocator.allocate(256) == 512);
+		CHECK(allocator.allocate(256) == 768);
+		CHECK(allocator.allocate(1) == BuddyAllocator::invalidOffset);
+
+		// Enough free bytes in total, but not in one block
+		allocator.free(0);
+		allocator.free(768);
+		CHECK(allocator.getLargestFreeBlockSize() == 512);
+		CHECK(allocator.allocate(768) == BuddyAllocator::invalidOffset);
+		CHECK(allocator.allocate(512) == 0);
+	}
+
+	// Random allocations and frees, blocks must never overlap and everything merges back in the end
+	void testRandom()
+	{
+		struct Allocation {
+			uint64_t offset;
+			uint64_t size;
+		};
+
+		mt19937 rng(3);
+		for (int trial = 0; trial < 100; ++trial) {
+			const uint64_t minBlockSize = 1ull << (rng() % 4 + 4);
+			const uint64_t capacity = minBlockSize << (rng() % 8);
+			BuddyAllocator allocator(capacity, minBlockSize);
+			vector<Allocation> live;
+
+			for (int i = 0; i < 3000; ++i) {
+				if (live.empty() || rng() % 3 != 0) {
+					const uint64_t size = 1 + rng() % (capacity / 2 + 1);
+					const uint64_t alignment = 1ull << (rng() % 6);
+					const uint64_t offset = allocator.allocate(size, alignment);
+					if (offset == BuddyAllocator::invalidOffset) {
+						continue;
+					}
+
+					CHECK(offset % alignment == 0 && offset + size <= capacity);
+					for (const auto& a : live) {
+						CHECK(offset >= a.offset + a.size || a.offset >= offset + size);
+					}
+					live.push_back({ offset, size });
+				}
+				else {
+					const size_t index = rng() % live.size();
+					allocator.free(live[index].offset);
+					live.erase(live.begin() + index);
+				}
+			}
+
+			for (const auto& a : live) {
+				allocator.free(a.offset);
+			}
+			CHECK(allocator.isEmpty() && allocator.getAllocatedSize() == 0 && allocator.getLargestFreeBlockSize() == capacity);
+		}
+	}
+}
+
+int main()
+{
+	testSplitAndMerge();
+	testRounding();
+	testOutOfSpace();
+	testRandom();
+	return 0;
+}
@@ -0,0 +1,195 @@
+#include "Util/DescriptorAllocator.h"
+
+#include <random>
+#include <vector>
+
+#include "Check.h"
+
+using namespace std;
+using Util::DescriptorAllocator;
+
+namespace {
+	void testFirstFit()
+	{
+		DescriptorAllocator allocator(16, 4, 2);
+		CHECK(allocator.getCapacity() == 24 && allocator.getPersistentCount() == 16);
+
+		const auto a = allocator.allocate(4);
+		const auto b = allocator.allocate(8);
+		const auto c = allocator.allocate(4);
+		CHECK(a.index == 0 && b.index == 4 && c.index == 12);
+		CHECK(allocator.getFreeCount() == 0);
+
+		CHECK(allocator.allocate(1).index == DescriptorAllocator::invalidIndex);
+		CHECK(allocator.allocate(0).index == DescriptorAllocator::invalidIndex);
+		CHECK(!allocator.isValid(DescriptorAllocator::Handle()));
+	}
+
+	void testReuseAfterFence()
+	{
+		DescriptorAllocator allocator(8, 4, 2);
+		const auto a = allocator.allocate(8);
+
+		// Frees wait for the fence value of the frame that freed them, not just any completed frame
+		allocator.beginFrame();
+		CHECK(allocator.free(a));
+		CHECK(allocator.getFreeCount() == 0 && allocator.getPendingFreeCount() == 8);
+		allocator.release(100);
+		CHECK(allocator.getFreeCount() == 0);
+		allocator.finishFrame(5);
+
+		allocator.release(4);
+		CHECK(allocator.getFreeCount() == 0);
+		CHECK(allocator.allocate(1).index == DescriptorAllocator::invalidIndex);
+
+		allocator.release(5);
+		CHECK(allocator.getFreeCount() == 8 && allocator.getPendingFreeCount() == 0);
+		CHECK(allocator.allocate(8).index == 0);
+	}
+
+	void testGenerations()
+	{
+		DescriptorAllocator allocator(8, 4, 2);
+		const auto a = allocator.allocate(4);
+		const auto b = allocator.allocate(4);
+		CHECK(allocator.isValid(a) && allocator.isValid(b));
+
+		// Double free
+		allocator.beginFrame();
+		CHECK(allocator.free(a));
+		CHECK(!allocator.isValid(a));
+		CHECK(!allocator.free(a));
+		CHECK(allocator.getPendingFreeCount() == 4);
+		allocator.finishFrame(1);
+		allocator.release(1);
+
+		// The reused range gets a new generation, the old handle stays stale
+		const auto reused = allocator.allocate(2);
+		CHECK(reused.index == a.index && reused.generation != a.generation);
+		CHECK(allocator.isValid(reused) && !allocator.isValid(a));
+		CHECK(!allocator.free(a));
+		CHECK(allocator.isValid(reused) && allocator.isValid(b));
+
+		// Handles of another allocator don't fit this one
+		DescriptorAllocator::Handle outside;
+		outside.index = 8;
+		outside.count = 1;
+		CHECK(!allocator.isValid(outside) && !allocator.free(outside));
+	}
+
+	void testMerging()
+	{
+		DescriptorAllocator allocator(16, 4, 2);
+		vector<DescriptorAllocator::Handle> handles;
+		for (int i = 0; i < 4; ++i) {
+			handles.push_back(allocator.allocate(4));
+		}
+
+		// Freed out of order, every new range lands next to existing ones on one or both sides
+		const int order[] = { 1, 3, 2, 0 };
+		uint64_t fenceValue = 0;
+		for (int i : order) {
+			allocator.beginFrame();
+			CHECK(allocator.free(handles[i]));
+			allocator.finishFrame(++fenceValue);
+			allocator.release(fenceValue);
+		}
+
+		// Only possible if all four merged into one range
+		CHECK(allocator.getFreeCount() == 16);
+		const auto all = allocator.allocate(16);
+		CHECK(all.index == 0 && all.count == 16);
+	}
+
+	void testTemporaryRegions()
+	{
+		DescriptorAllocator allocator(16, 4, 2);
+
+		// Each frame slot has a region of its own behind the persistent range
+		CHECK(allocator.beginFrame() == 0);
+		const uint32_t first = allocator.allocateTemporary(3);
+		CHECK(first == 16);
+		CHECK(allocator.allocateTemporary(1) == 19);
+		CHECK(allocator.allocateTemporary(1) == DescriptorAllocator::invalidIndex);
+		CHECK(allocator.allocateTemporary(0) == DescriptorAllocator::invalidIndex);
+		allocator.finishFrame(1);
+
+		CHECK(allocator.beginFrame() == 0);
+		CHECK(allocator.allocateTemporary(4) == 20);
+		allocator.finishFrame(2);
+
+		// Back in the first slot once the frame that used it is complete
+		CHECK(allocator.beginFrame() == 1);
+		CHECK(allocator.allocateTemporary(4) == 16);
+		allocator.finishFrame(3);
+		CHECK(allocator.beginFrame() == 2);
+		CHECK(allocator.allocateTemporary(2) == 20);
+
+		// Temporaries don't touch the persistent range
+		CHECK(allocator.getFreeCount() == 16);
+	}
+
+	// Live handles never overlap, and every persistent descriptor is either live, pending or free
+	void testRandom()
+	{
+		mt19937 rng(3);
+		for (int trial = 0; trial < 200; ++trial) {
+			const uint32_t persistentCount = 1 + rng() % 64;
+			DescriptorAllocator allocator(persistentCount, 4, 2);
+			vector<DescriptorAllocator::Handle> live;
+			vector<DescriptorAllocator::Handle> freed;
+			uint64_t fenceValue = 0;
+
+			for (int frame = 0; frame < 100; ++frame) {
+				allocator.beginFrame();
+
+				for (int operation = 0; operation < 4; ++operation) {
+					if (rng() % 2 == 0) {
+						const auto handle = allocator.allocate(1 + rng() % 8);
+						if (handle.index != DescriptorAllocator::invalidIndex) {
+							CHECK(allocator.isValid(handle));
+							live.push_back(handle);
+						}
+					}
+					else if (!live.empty()) {
+						const size_t i = rng() % live.size();
+						CHECK(allocator.free(live[i]));
+						freed.push_back(live[i]);
+						live.erase(live.begin() + i);
+					}
+				}
+
+				allocator.finishFrame(++fenceValue);
+				// The GPU lags up to two frames behind
+				allocator.release(fenceValue - rng() % 3);
+
+				vector<bool> used(persistentCount);
+				uint32_t liveCount = 0;
+				for (const auto& handle : live) {
+					CHECK(allocator.isValid(handle));
+					for (uint32_t i = handle.index; i < handle.index + handle.count; ++i) {
+						CHECK(i < persistentCount && !used[i]);
+						used[i] = true;
+					}
+					liveCount += handle.count;
+				}
+				CHECK(liveCount + allocator.getFreeCount() + allocator.getPendingFreeCount() == persistentCount);
+			}
+
+			for (const auto& handle : freed) {
+				CHECK(!allocator.free(handle));
+			}
+		}
+	}
+}
+
+int main()
+{
+	testFirstFit();
+	testReuseAfterFence();
+	testGenerations();
+	testMerging();
+	testTemporaryRegions();
+	testRandom();
+	return 0;
+}
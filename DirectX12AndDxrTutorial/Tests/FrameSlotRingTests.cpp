@@ -0,0 +1,90 @@
+#include "Util/FrameSlotRing.h"
+
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+
+using namespace std;
+using Util::FrameSlotRing;
+
+namespace {
+	void testRoundRobin()
+	{
+		FrameSlotRing ring(3);
+
+		// Unused slots don't have to be waited for
+		for (size_t slot = 0; slot < 3; ++slot) {
+			CHECK(ring.advance() == 0);
+			CHECK(ring.getCurrentSlot() == slot);
+			ring.finishFrame(slot + 1);
+		}
+
+		// Each slot comes back with the fence value of the frame that used it last
+		CHECK(ring.advance() == 1 && ring.getCurrentSlot() == 0);
+		ring.finishFrame(4);
+		CHECK(ring.advance() == 2 && ring.getCurrentSlot() == 1);
+		CHECK(ring.advance() == 3 && ring.getCurrentSlot() == 2);
+		CHECK(ring.advance() == 4 && ring.getCurrentSlot() == 0);
+	}
+
+	// Fake GPU: submitted frames complete in order after a random delay, like a fence that lags behind. The owner waits for
+	// the fence value returned by advance before writing the slot, so a slot must never be written while a frame in flight
+	// still reads it, and every frame must read the data that was written for it.
+	void testFakeFence()
+	{
+		struct Frame {
+			uint64_t fenceValue;
+			size_t slot;
+			uint64_t data;
+		};
+
+		mt19937 rng(5);
+		for (int trial = 0; trial < 300; ++trial) {
+			const size_t slotCount = 1 + rng() % 4;
+			FrameSlotRing ring(slotCount);
+			vector<uint64_t> slotData(slotCount, 0);
+
+			uint64_t submittedFenceValue = 0;
+			uint64_t completedFenceValue = 0;
+			deque<Frame> inFlight;
+
+			auto completeOldestFrame = [&]() {
+				const Frame frame = inFlight.front();
+				inFlight.pop_front();
+				CHECK(slotData[frame.slot] == frame.data);
+				completedFenceValue = frame.fenceValue;
+			};
+
+			for (uint64_t frameNumber = 1; frameNumber < 500; ++frameNumber) {
+				const uint64_t requiredFenceValue = ring.advance();
+				const size_t slot = ring.getCurrentSlot();
+
+				// CPU wait
+				while (completedFenceValue < requiredFenceValue) {
+					completeOldestFrame();
+				}
+
+				for (const auto& frame : inFlight) {
+					CHECK(frame.slot != slot);
+				}
+
+				slotData[slot] = frameNumber;
+				ring.finishFrame(++submittedFenceValue);
+				inFlight.push_back({ submittedFenceValue, slot, frameNumber });
+
+				while (!inFlight.empty() && rng() % 3 == 0) {
+					completeOldestFrame();
+				}
+			}
+		}
+	}
+}
+
+int main()
+{
+	testRoundRobin();
+	testFakeFence();
+	return 0;
+}
@@ -0,0 +1,127 @@
+#include "Util/GeometryDeduplicator.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+
+using namespace std;
+using Util::GeometryDeduplicator;
+
+namespace {
+	using Positions = vector<GeometryDeduplicator::Position>;
+
+	const auto anyData = [](size_t) { return true; };
+
+	// Two triangles of a quad with a bent corner, about size across
+	Positions makeMesh(float size)
+	{
+		return {
+			{ 0.f, 0.f, 0.f }, { size, 0.f, 0.f }, { size, size, 0.1f * size },
+			{ 0.f, 0.f, 0.f }, { size, size, 0.1f * size }, { 0.f, size, 0.f } };
+	}
+
+	Positions translate(const Positions& positions, float x, float y, float z)
+	{
+		Positions translated;
+		for (const auto& p : positions) {
+			translated.push_back({ p.x + x, p.y + y, p.z + z });
+		}
+
+		return translated;
+	}
+
+	void testTranslatedCopies()
+	{
+		const Positions mesh = makeMesh(1.f);
+		GeometryDeduplicator deduplicator;
+		deduplicator.add(0, mesh.data(), mesh.size(), 1);
+
+		CHECK(deduplicator.find(mesh.data(), mesh.size(), 1, anyData) == 0);
+
+		// Translations that aren't exact in float, near and far from the origin
+		const float offsets[] = { 0.1f, -3.7f, 1000.3f, -12345.6f };
+		for (float offset : offsets) {
+			const Positions copy = translate(mesh, offset, 0.5f * offset, -offset);
+			CHECK(deduplicator.find(copy.data(), copy.size(), 1, anyData) == 0);
+		}
+
+		// The exact data has to match too
+		CHECK(deduplicator.find(mesh.data(), mesh.size(), 2, anyData) == GeometryDeduplicator::notFound);
+		CHECK(deduplicator.find(mesh.data(), mesh.size(), 1, [](size_t) { return false; }) == GeometryDeduplicator::notFound);
+		CHECK(deduplicator.find(mesh.data(), 3, 1, anyData) == GeometryDeduplicator::notFound);
+	}
+
+	// Copies that differ by much less than the tolerance are found, however their coordinates fall relative to any grid
+	void testStraddlingCopies()
+	{
+		const float tolerance = GeometryDeduplicator::relativeTolerance;
+
+		for (int step = -8; step <= 8; ++step) {
+			// Sizes around powers of two and coordinates around multiples of 1/4096 of them
+			const float size = std::exp2(static_cast<float>(step)) * (1.f + (step % 2) * 1e-6f);
+			const float grid = size / 4096.f;
+
+			Positions mesh = makeMesh(size);
+			mesh[1].x = 100.f * grid - 0.01f * tolerance * size;
+			Positions copy = mesh;
+			copy[1].x = 100.f * grid + 0.01f * tolerance * size;
+			copy = translate(copy, 3.f, 2.f, 1.f);
+
+			GeometryDeduplicator deduplicator;
+			deduplicator.add(7, mesh.data(), mesh.size(), 1);
+			CHECK(deduplicator.find(copy.data(), copy.size(), 1, anyData) == 7);
+
+			// Scaled copies are different meshes
+			const Positions scaled = makeMesh(size * (1.f + 10.f * tolerance));
+			CHECK(deduplicator.find(scaled.data(), scaled.size(), 1, anyData) == GeometryDeduplicator::notFound);
+		}
+	}
+
+	// The tolerance follows the mesh size, not the distance from the origin
+	void testFarFromOrigin()
+	{
+		const Positions mesh = translate(makeMesh(1.f), 1000.f, 1000.f, 1000.f);
+		Positions deformed = mesh;
+		deformed[2].z += 1e-3f;
+
+		GeometryDeduplicator deduplicator;
+		deduplicator.add(0, mesh.data(), mesh.size(), 1);
+		CHECK(deduplicator.find(deformed.data(), deformed.size(), 1, anyData) == GeometryDeduplicator::notFound);
+
+		const Positions copy = translate(mesh, -2000.3f, 0.7f, 0.f);
+		CHECK(deduplicator.find(copy.data(), copy.size(), 1, anyData) == 0);
+	}
+
+	// Many meshes with the same data and vertex count, only their sizes differ: each finds itself, the first one added wins
+	void testManyCandidates()
+	{
+		vector<Positions> meshes;
+		GeometryDeduplicator deduplicator;
+		for (size_t i = 0; i < 200; ++i) {
+			meshes.push_back(makeMesh(1.f + 0.01f * static_cast<float>(i)));
+			deduplicator.add(i, meshes.back().data(), meshes.back().size(), 1);
+		}
+
+		mt19937 rng(2);
+		for (size_t i = 0; i < meshes.size(); ++i) {
+			const Positions copy = translate(meshes[i], static_cast<float>(rng() % 1000) * 0.1f, 0.f, -7.f);
+			CHECK(deduplicator.find(copy.data(), copy.size(), 1, anyData) == i);
+		}
+
+		const Positions duplicate = meshes[5];
+		deduplicator.add(500, duplicate.data(), duplicate.size(), 1);
+		CHECK(deduplicator.find(duplicate.data(), duplicate.size(), 1, anyData) == 5);
+		CHECK(deduplicator.find(duplicate.data(), duplicate.size(), 1, [](size_t mesh) { return mesh == 500; }) == 500);
+	}
+}
+
+int main()
+{
+	testTranslatedCopies();
+	testStraddlingCopies();
+	testFarFromOrigin();
+	testManyCandidates();
+	return 0;
+}
@@ -0,0 +1,158 @@
+#include "Util/QueueDependencies.h"
+
+#include <map>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+
+using namespace std;
+using Util::QueueDependencies;
+
+namespace {
+	// Stands in for a copy queue feeding a direct queue the way RTGraphics uses them: every submission signals the
+	// next fence value, the consumer's GPU side waits are recorded in order
+	struct FakeQueues {
+		QueueDependencies dependencies;
+		uint64_t lastSignaledFenceValue = 0;
+		vector<uint64_t> waits;
+
+		uint64_t executeUploads(const vector<QueueDependencies::Key>& keys)
+		{
+			++lastSignaledFenceValue;
+			for (auto key : keys) {
+				dependencies.setProducer(key, lastSignaledFenceValue);
+			}
+
+			return lastSignaledFenceValue;
+		}
+
+		void waitForUploads(const vector<QueueDependencies::Key>& keys)
+		{
+			const uint64_t fenceValue = dependencies.getRequiredWait(keys);
+			if (fenceValue != 0) {
+				waits.push_back(fenceValue);
+				dependencies.setWaited(fenceValue);
+			}
+		}
+	};
+
+	void testFenceValues()
+	{
+		const int a = 0, b = 0, c = 0;
+		FakeQueues queues;
+
+		CHECK(queues.executeUploads({ &a }) == 1);
+		CHECK(queues.executeUploads({ &b, &c }) == 2);
+		CHECK(queues.dependencies.getPendingCount() == 3);
+
+		// The latest producer of any of the keys, keys without one need no wait
+		CHECK(queues.dependencies.getRequiredWait({ &a }) == 1);
+		CHECK(queues.dependencies.getRequiredWait({ &b }) == 2);
+		CHECK(queues.dependencies.getRequiredWait({ &a, &c }) == 2);
+		const int unknown = 0;
+		CHECK(queues.dependencies.getRequiredWait({ &unknown }) == 0);
+		CHECK(queues.dependencies.getRequiredWait({}) == 0);
+
+		// Writing a key again moves its fence value on
+		CHECK(queues.executeUploads({ &a }) == 3);
+		CHECK(queues.dependencies.getRequiredWait({ &a }) == 3);
+		CHECK(queues.dependencies.getPendingCount() == 3);
+	}
+
+	void testCrossQueueWaits()
+	{
+		const int a = 0, b = 0, c = 0;
+		FakeQueues queues;
+		queues.executeUploads({ &a });
+		queues.executeUploads({ &b });
+		queues.executeUploads({ &c });
+
+		// Waiting for b covers a as well, which then needs no wait of its own
+		queues.waitForUploads({ &b });
+		CHECK(queues.waits == vector<uint64_t>({ 2 }));
+		CHECK(queues.dependencies.getWaitedFenceValue() == 2);
+		CHECK(queues.dependencies.getPendingCount() == 1);
+
+		queues.waitForUploads({ &a, &b });
+		CHECK(queues.waits.size() == 1);
+
+		queues.waitForUploads({ &a, &c });
+		CHECK(queues.waits == vector<uint64_t>({ 2, 3 }));
+		CHECK(queues.dependencies.getPendingCount() == 0);
+
+		// A key written after the wait is pending again
+		queues.executeUploads({ &a });
+		queues.waitForUploads({ &a });
+		CHECK(queues.waits == vector<uint64_t>({ 2, 3, 4 }));
+
+		// Older waits never move the waited value back
+		queues.dependencies.setWaited(1);
+		CHECK(queues.dependencies.getWaitedFenceValue() == 4);
+		CHECK(queues.dependencies.getRequiredWait({ &a, &b, &c }) == 0);
+	}
+
+	// Random submissions and uses: every use comes after the wait for the submission that last wrote its keys, the waits
+	// only ever increase, and no wait is made that an earlier one already covered
+	void testRandom()
+	{
+		mt19937 rng(4);
+		for (int trial = 0; trial < 100; ++trial) {
+			const int resources[8] = {};
+			FakeQueues queues;
+			map<QueueDependencies::Key, uint64_t> lastWrites;
+
+			for (int operation = 0; operation < 100; ++operation) {
+				vector<QueueDependencies::Key> keys;
+				for (const int& resource : resources) {
+					if (rng() % 4 == 0) {
+						keys.push_back(&resource);
+					}
+				}
+
+				if (rng() % 2 == 0) {
+					const uint64_t fenceValue = queues.executeUploads(keys);
+					for (auto key : keys) {
+						lastWrites[key] = fenceValue;
+					}
+					continue;
+				}
+
+				const size_t waitCount = queues.waits.size();
+				uint64_t required = 0;
+				for (auto key : keys) {
+					if (lastWrites.count(key) != 0) {
+						required = std::max(required, lastWrites[key]);
+					}
+				}
+
+				queues.waitForUploads(keys);
+				CHECK(queues.dependencies.getWaitedFenceValue() >= required);
+				CHECK(queues.dependencies.getWaitedFenceValue() <= queues.lastSignaledFenceValue);
+
+				if (queues.waits.size() > waitCount) {
+					CHECK(queues.waits.size() == waitCount + 1);
+					CHECK(queues.waits.back() == required);
+					CHECK(waitCount == 0 || queues.waits[waitCount - 1] < queues.waits.back());
+				}
+				else {
+					CHECK(required <= (waitCount == 0 ? 0 : queues.waits.back()));
+				}
+
+				size_t pending = 0;
+				for (const auto& write : lastWrites) {
+					pending += write.second > queues.dependencies.getWaitedFenceValue() ? 1 : 0;
+				}
+				CHECK(queues.dependencies.getPendingCount() == pending);
+			}
+		}
+	}
+}
+
+int main()
+{
+	testFenceValues();
+	testCrossQueueWaits();
+	testRandom();
+	return 0;
+}
@@ -0,0 +1,200 @@
+#include "Util/RenderGraph.h"
+
+#include <vector>
+
+#include "Check.h"
+
+using namespace std;
+using Util::RenderGraph;
+
+namespace {
+	using Barrier = RenderGraph::Barrier;
+	using Handle = RenderGraph::Handle;
+
+	// Stand ins for D3D12_RESOURCE_STATES
+	constexpr RenderGraph::State present = 0;
+	constexpr RenderGraph::State renderTarget = 0x4;
+	constexpr RenderGraph::State unorderedAccess = 0x8;
+	constexpr RenderGraph::State pixelShaderResource = 0x40;
+	constexpr RenderGraph::State nonPixelShaderResource = 0x80;
+	constexpr RenderGraph::State copyDest = 0x400;
+	constexpr RenderGraph::State copySource = 0x800;
+
+	bool isTransition(const Barrier& barrier, Handle resource, RenderGraph::State before, RenderGraph::State after)
+	{
+		return barrier.type == Barrier::Transition && barrier.resource == resource && barrier.before == before && barrier.after == after;
+	}
+
+	bool isAliasing(const Barrier& barrier, Handle resource)
+	{
+		return barrier.type == Barrier::Aliasing && barrier.resource == resource;
+	}
+
+	void testCulling()
+	{
+		RenderGraph graph;
+		const Handle backBuffer = graph.importResource("Back Buffer", present, present);
+		const Handle a = graph.createTransient("A", 100, 1);
+		const Handle b = graph.createTransient("B", 100, 1);
+
+		// Nothing reaches an imported resource from the first three, so the chain goes away as a whole
+		const Handle writeA = graph.addPass("Write A");
+		graph.write(writeA, a, unorderedAccess);
+		const Handle aToB = graph.addPass("A to B");
+		graph.read(aToB, a, nonPixelShaderResource);
+		graph.write(aToB, b, unorderedAccess);
+		const Handle readB = graph.addPass("Read B");
+		graph.read(readB, b, nonPixelShaderResource);
+		// Only reading an imported resource doesn't keep a pass either
+		const Handle readBackBuffer = graph.addPass("Read Back Buffer");
+		graph.read(readBackBuffer, backBuffer, copySource);
+		const Handle ui = graph.addPass("UI");
+		graph.write(ui, backBuffer, renderTarget);
+
+		const RenderGraph::Compiled compiled = graph.compile();
+		CHECK(compiled.steps.size() == 1);
+		CHECK(compiled.steps[0].passes == vector<Handle>{ ui });
+		CHECK(compiled.heapOffsets[a] == RenderGraph::invalidOffset && compiled.heapOffsets[b] == RenderGraph::invalidOffset);
+		CHECK(compiled.heapSize == 0 && compiled.transientSize == 0);
+	}
+
+	void testSteps()
+	{
+		RenderGraph graph;
+		const Handle output = graph.importResource("Output", present, present);
+		const Handle t = graph.createTransient("T", 100, 1);
+		const Handle u1 = graph.createTransient("U1", 100, 1);
+		const Handle u2 = graph.createTransient("U2", 100, 1);
+		const Handle u3 = graph.createTransient("U3", 100, 1);
+
+		const Handle writeT = graph.addPass("Write T");
+		graph.write(writeT, t, unorderedAccess);
+		const Handle independent = graph.addPass("Independent");
+		graph.write(independent, u3, unorderedAccess);
+		// Read after write, two readers of the same step
+		const Handle read1 = graph.addPass("Read 1");
+		graph.read(read1, t, pixelShaderResource);
+		graph.write(read1, u1, renderTarget);
+		const Handle read2 = graph.addPass("Read 2");
+		graph.read(read2, t, nonPixelShaderResource);
+		graph.write(read2, u2, unorderedAccess);
+		// Write after read waits for both readers, write after write for the writer
+		const Handle rewriteT = graph.addPass("Rewrite T");
+		graph.write(rewriteT, t, unorderedAccess);
+		const Handle overwriteT = graph.addPass("Overwrite T");
+		graph.write(overwriteT, t, renderTarget);
+		const Handle combine = graph.addPass("Combine");
+		graph.read(combine, t, pixelShaderResource);
+		graph.read(combine, u1, pixelShaderResource);
+		graph.read(combine, u2, pixelShaderResource);
+		graph.read(combine, u3, pixelShaderResource);
+		graph.write(combine, output, renderTarget);
+
+		const RenderGraph::Compiled compiled = graph.compile();
+		CHECK(compiled.steps.size() == 5);
+		CHECK((compiled.steps[0].passes == vector<Handle>{ writeT, independent }));
+		CHECK((compiled.steps[1].passes == vector<Handle>{ read1, read2 }));
+		CHECK(compiled.steps[2].passes == vector<Handle>{ rewriteT });
+		CHECK(compiled.steps[3].passes == vector<Handle>{ overwriteT });
+		CHECK(compiled.steps[4].passes == vector<Handle>{ combine });
+
+		// The readers of one step get a single transition into both their states
+		const vector<Barrier>& readBarriers = compiled.steps[1].barriers;
+		CHECK(readBarriers.size() == 3);
+		CHECK(isTransition(readBarriers[0], t, unorderedAccess, pixelShaderResource | nonPixelShaderResource));
+
+		CHECK(compiled.steps[2].barriers.size() == 1);
+		CHECK(isTransition(compiled.steps[2].barriers[0], t, pixelShaderResource | nonPixelShaderResource, unorderedAccess));
+		CHECK(compiled.steps[3].barriers.size() == 1);
+		CHECK(isTransition(compiled.steps[3].barriers[0], t, unorderedAccess, renderTarget));
+
+		// The frame repeats, so T starts in the state Combine left it in
+		CHECK(compiled.initialStates[t] == pixelShaderResource);
+		CHECK(isTransition(compiled.steps[0].barriers[0], t, pixelShaderResource, unorderedAccess));
+	}
+
+	void testAliasing()
+	{
+		RenderGraph graph;
+		const Handle backBuffer = graph.importResource("Back Buffer", present, present);
+		const Handle output = graph.createTransient("Output", 1000, 256);
+		const Handle denoised = graph.createTransient("Denoised", 1000, 256);
+		const Handle toneMapped = graph.createTransient("Tone Mapped", 1000, 256);
+
+		const Handle rayTracing = graph.addPass("Ray Tracing");
+		graph.write(rayTracing, output, unorderedAccess);
+		const Handle denoise = graph.addPass("Denoise");
+		graph.read(denoise, output, nonPixelShaderResource);
+		graph.write(denoise, denoised, unorderedAccess);
+		const Handle toneMap = graph.addPass("Tone Map");
+		graph.read(toneMap, denoised, nonPixelShaderResource);
+		graph.write(toneMap, toneMapped, unorderedAccess);
+		const Handle copy = graph.addPass("Copy");
+		graph.read(copy, toneMapped, copySource);
+		graph.write(copy, backBuffer, copyDest);
+
+		const RenderGraph::Compiled compiled = graph.compile();
+		CHECK(compiled.steps.size() == 4);
+
+		// Output is dead once Denoise is done, Tone Mapped takes over its memory
+		CHECK(compiled.heapOffsets[output] == 0);
+		CHECK(compiled.heapOffsets[denoised] == 1024);
+		CHECK(compiled.heapOffsets[toneMapped] == 0);
+		CHECK(compiled.heapSize == 2024);
+		CHECK(compiled.transientSize == 3072);
+
+		// Aliasing barriers come at the first use, before the transition into the first state
+		CHECK(compiled.steps[0].barriers.size() == 2);
+		CHECK(isAliasing(compiled.steps[0].barriers[0], output));
+		CHECK(isTransition(compiled.steps[0].barriers[1], output, nonPixelShaderResource, unorderedAccess));
+
+		// Denoised has memory of its own
+		for (const RenderGraph::Step& step : compiled.steps) {
+			for (const Barrier& barrier : step.barriers) {
+				CHECK(!isAliasing(barrier, denoised));
+			}
+		}
+
+		const vector<Barrier>& toneMapBarriers = compiled.steps[2].barriers;
+		CHECK(toneMapBarriers.size() == 3);
+		CHECK(isTransition(toneMapBarriers[0], denoised, unorderedAccess, nonPixelShaderResource));
+		CHECK(isAliasing(toneMapBarriers[1], toneMapped));
+		CHECK(isTransition(toneMapBarriers[2], toneMapped, copySource, unorderedAccess));
+	}
+
+	void testFinalBarriers()
+	{
+		RenderGraph graph;
+		const Handle backBuffer = graph.importResource("Back Buffer", present, present);
+		const Handle untouched = graph.importResource("Untouched", pixelShaderResource, pixelShaderResource);
+		const Handle handedOver = graph.importResource("Handed Over", copyDest, pixelShaderResource);
+		const Handle endsInFinal = graph.importResource("Ends In Final", present, unorderedAccess);
+
+		const Handle copy = graph.addPass("Copy");
+		graph.write(copy, backBuffer, copyDest);
+		graph.write(copy, endsInFinal, unorderedAccess);
+		const Handle ui = graph.addPass("UI");
+		graph.write(ui, backBuffer, renderTarget);
+
+		const RenderGraph::Compiled compiled = graph.compile();
+		CHECK(compiled.steps.size() == 2);
+		CHECK(compiled.initialStates[handedOver] == copyDest);
+		CHECK(isTransition(compiled.steps[0].barriers[0], backBuffer, present, copyDest));
+		CHECK(isTransition(compiled.steps[1].barriers[0], backBuffer, copyDest, renderTarget));
+
+		// Only resources that aren't in their final state yet get a barrier, used or not
+		CHECK(compiled.finalBarriers.size() == 2);
+		CHECK(isTransition(compiled.finalBarriers[0], backBuffer, renderTarget, present));
+		CHECK(isTransition(compiled.finalBarriers[1], handedOver, copyDest, pixelShaderResource));
+		CHECK(compiled.heapOffsets[untouched] == RenderGraph::invalidOffset);
+	}
+}
+
+int main()
+{
+	testCulling();
+	testSteps();
+	testAliasing();
+	testFinalBarriers();
+	return 0;
+}
@@ -0,0 +1,209 @@
+#include "Util/ResourceStateTracker.h"
+
+#include <functional>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+
+using namespace std;
+using Util::ResourceStateTracker;
+
+namespace {
+	using Barrier = ResourceStateTracker::Barrier;
+
+	// Stand ins for D3D12_RESOURCE_STATES: single write bits, and read bits that can be combined
+	constexpr ResourceStateTracker::State common = 0;
+	constexpr ResourceStateTracker::State renderTarget = 1;
+	constexpr ResourceStateTracker::State unorderedAccess = 2;
+	constexpr ResourceStateTracker::State copyDest = 4;
+	constexpr ResourceStateTracker::State shaderResource = 8;
+	constexpr ResourceStateTracker::State copySource = 16;
+
+	void testMerging()
+	{
+		ResourceStateTracker tracker;
+		ResourceStateTracker::RecordingBackend recording;
+		int a = 0;
+		int b = 0;
+		tracker.setState(&a, common);
+		tracker.setState(&b, renderTarget);
+
+		// Nothing pending, no backend call
+		tracker.transition(&a, common);
+		tracker.flush(ref(recording));
+		CHECK(recording.batches.empty());
+
+		// One batch per flush
+		tracker.transition(&a, copyDest);
+		tracker.transition(&b, shaderResource);
+		CHECK(tracker.getPendingCount() == 2);
+		tracker.flush(ref(recording));
+		CHECK(recording.batches.size() == 1 && recording.batches[0].size() == 2);
+		CHECK(tracker.getPendingCount() == 0);
+
+		// Consecutive transitions of one resource become one
+		tracker.transition(&a, unorderedAccess);
+		tracker.transition(&a, renderTarget);
+		tracker.flush(ref(recording));
+		CHECK(recording.batches.size() == 2 && recording.batches[1].size() == 1);
+		CHECK(recording.batches[1][0].type == Barrier::Transition);
+		CHECK(recording.batches[1][0].before == copyDest && recording.batches[1][0].after == renderTarget);
+
+		// And disappear if they end where they started
+		tracker.transition(&a, copyDest);
+		tracker.transition(&a, renderTarget);
+		CHECK(tracker.getPendingCount() == 0);
+		tracker.flush(ref(recording));
+		CHECK(recording.batches.size() == 2);
+		CHECK(tracker.getState(&a) == renderTarget);
+
+		// Flushed transitions aren't merged into
+		tracker.transition(&a, copyDest);
+		tracker.flush(ref(recording));
+		tracker.transition(&a, renderTarget);
+		tracker.flush(ref(recording));
+		CHECK(recording.batches.size() == 4);
+		CHECK(recording.getBarrierCount() == 5);
+	}
+
+	void testReadStates()
+	{
+		ResourceStateTracker tracker;
+		ResourceStateTracker::RecordingBackend recording;
+		int a = 0;
+
+		// A set of read states covers each of them, but not the common state
+		tracker.setState(&a, shaderResource | copySource);
+		tracker.transition(&a, shaderResource);
+		tracker.transition(&a, copySource);
+		CHECK(tracker.getPendingCount() == 0);
+		CHECK(tracker.getState(&a) == (shaderResource | copySource));
+		tracker.transition(&a, common);
+		CHECK(tracker.getPendingCount() == 1);
+		tracker.flush(ref(recording));
+
+		// Unless the exact state is asked for
+		tracker.setState(&a, shaderResource | copySource);
+		tracker.transitionExactly(&a, shaderResource);
+		tracker.transitionExactly(&a, shaderResource);
+		tracker.flush(ref(recording));
+		CHECK(recording.batches.size() == 2 && recording.batches[1].size() == 1);
+		CHECK(recording.batches[1][0].before == (shaderResource | copySource) && recording.batches[1][0].after == shaderResource);
+		CHECK(tracker.getState(&a) == shaderResource);
+	}
+
+	void testOrdering()
+	{
+		ResourceStateTracker tracker;
+		ResourceStateTracker::RecordingBackend recording;
+		int a = 0;
+		int b = 0;
+		tracker.setState(&a, unorderedAccess);
+		tracker.setState(&b, common);
+
+		// A transition after a UAV barrier isn't merged into one in front of it
+		tracker.transition(&a, shaderResource);
+		tracker.uavBarrier(&a);
+		tracker.transition(&a, unorderedAccess);
+		tracker.flush(ref(recording));
+		CHECK(recording.batches.size() == 1 && recording.batches[0].size() == 3);
+		CHECK(recording.batches[0][0].type == Barrier::Transition && recording.batches[0][0].after == shaderResource);
+		CHECK(recording.batches[0][1].type == Barrier::Uav && recording.batches[0][1].resource == &a);
+		CHECK(recording.batches[0][2].type == Barrier::Transition && recording.batches[0][2].before == shaderResource);
+
+		// A null UAV barrier orders every resource
+		tracker.transition(&a, copyDest);
+		tracker.transition(&b, copyDest);
+		tracker.uavBarrier(nullptr);
+		tracker.transition(&a, unorderedAccess);
+		tracker.transition(&b, common);
+		tracker.flush(ref(recording));
+		CHECK(recording.batches.size() == 2 && recording.batches[1].size() == 5);
+		CHECK(recording.batches[1][2].type == Barrier::Uav && recording.batches[1][2].resource == nullptr);
+
+		// Aliasing comes before the transitions that follow it, even with one pending in front of it
+		tracker.transition(&b, renderTarget);
+		tracker.aliasingBarrier(&b);
+		tracker.transition(&b, copyDest);
+		tracker.flush(ref(recording));
+		CHECK(recording.batches.size() == 3 && recording.batches[2].size() == 3);
+		CHECK(recording.batches[2][1].type == Barrier::Aliasing && recording.batches[2][1].resource == &b);
+		CHECK(recording.batches[2][2].before == renderTarget && recording.batches[2][2].after == copyDest);
+
+		// An aliasing barrier goes out even if no transition follows it
+		tracker.aliasingBarrier(&a);
+		CHECK(tracker.getPendingCount() == 1);
+		tracker.flush(ref(recording));
+		CHECK(recording.batches.size() == 4);
+	}
+
+	// Replaying the flushed barriers from the initial states has to end in the tracked states, and every transition has
+	// to start in the state the replay is in
+	void testRandom()
+	{
+		const ResourceStateTracker::State states[] = { common, renderTarget, unorderedAccess, copyDest, shaderResource, copySource, shaderResource | copySource };
+
+		mt19937 rng(11);
+		for (int trial = 0; trial < 2000; ++trial) {
+			ResourceStateTracker tracker;
+			int resources[6] = {};
+			map<ResourceStateTracker::Resource, ResourceStateTracker::State> replayed;
+			vector<Barrier> flushed;
+
+			for (int& resource : resources) {
+				const auto state = states[rng() % size(states)];
+				tracker.setState(&resource, state);
+				replayed[&resource] = state;
+			}
+
+			const ResourceStateTracker::Backend backend = [&](const vector<Barrier>& barriers) {
+				CHECK(!barriers.empty());
+				flushed.insert(flushed.end(), barriers.begin(), barriers.end());
+			};
+
+			for (int operation = 0; operation < 40; ++operation) {
+				int* const resource = &resources[rng() % size(resources)];
+				const auto state = states[rng() % size(states)];
+
+				switch (rng() % 10) {
+				case 0: tracker.uavBarrier(resource); break;
+				case 1: tracker.aliasingBarrier(resource); break;
+				case 2:
+					tracker.transitionExactly(resource, state);
+					CHECK(tracker.getState(resource) == state);
+					break;
+				case 3: tracker.flush(backend); break;
+				default:
+					// The tracked state covers the requested one right away
+					tracker.transition(resource, state);
+					CHECK(tracker.getState(resource) == state || (state != common && (tracker.getState(resource) & state) == state));
+					break;
+				}
+			}
+			tracker.flush(backend);
+
+			for (const Barrier& barrier : flushed) {
+				if (barrier.type == Barrier::Transition) {
+					CHECK(replayed[barrier.resource] == barrier.before);
+					CHECK(barrier.before != barrier.after);
+					replayed[barrier.resource] = barrier.after;
+				}
+			}
+
+			for (int& resource : resources) {
+				CHECK(replayed[&resource] == tracker.getState(&resource));
+			}
+		}
+	}
+}
+
+int main()
+{
+	testMerging();
+	testReadStates();
+	testOrdering();
+	testRandom();
+	return 0;
+}
@@ -0,0 +1,168 @@
+#include "Util/RingAllocator.h"
+
+#include <random>
+#include <vector>
+#include <algorithm>
+
+#include "Check.h"
+
+using namespace std;
+using Util::RingAllocator;
+
+namespace {
+	void testAlignment()
+	{
+		RingAllocator ring(256);
+		CHECK(ring.allocate(10) == 0);
+		CHECK(ring.allocate(16, 64) == 64);
+		// The padding counts as used
+		CHECK(ring.getUsedSize() == 80);
+		CHECK(ring.allocate(0) == RingAllocator::invalidOffset);
+		CHECK(ring.allocate(257) == RingAllocator::invalidOffset);
+	}
+
+	void testWrapAround()
+	{
+		RingAllocator ring(100);
+		CHECK(ring.allocate(60) == 0);
+		ring.finishFrame(1);
+		CHECK(ring.allocate(30) == 60);
+		ring.finishFrame(2);
+		ring.release(1);
+		CHECK(ring.getUsedSize() == 30);
+
+		// Only 10 bytes left at the end, the allocation starts over at 0 and the skipped bytes are used until the frame is released
+		CHECK(ring.allocate(20) == 0);
+		CHECK(ring.getUsedSize() == 60);
+
+		// Free space is [20, 60) now
+		CHECK(ring.allocate(41) == RingAllocator::invalidOffset);
+		CHECK(ring.allocate(40) == 20);
+		ring.finishFrame(3);
+
+		ring.release(3);
+		CHECK(ring.getUsedSize() == 0);
+		CHECK(!ring.hasPendingFrames());
+	}
+
+	void testFull()
+	{
+		RingAllocator ring(100);
+		CHECK(ring.allocate(60) == 0);
+		ring.finishFrame(1);
+		CHECK(ring.allocate(40) == 60);
+		ring.finishFrame(2);
+		ring.release(1);
+
+		// Wraps around and ends exactly at the tail, so head == tail with everything in use
+		CHECK(ring.allocate(60) == 0);
+		CHECK(ring.getUsedSize() == 100);
+		CHECK(ring.allocate(1) == RingAllocator::invalidOffset);
+		ring.finishFrame(3);
+
+		ring.release(2);
+		CHECK(ring.getUsedSize() == 60);
+		CHECK(ring.allocate(40) == 60);
+		CHECK(ring.allocate(1) == RingAllocator::invalidOffset);
+	}
+
+	void testReleaseByFenceValue()
+	{
+		// Stands in for the GPU fence: frames are submitted with increasing values, completedFenceValue lags behind
+		uint64_t submittedFenceValue = 0;
+		uint64_t completedFenceValue = 0;
+
+		RingAllocator ring(1024);
+		for (int i = 0; i < 3; ++i) {
+			CHECK(ring.allocate(256) == static_cast<uint64_t>(i) * 256);
+			ring.finishFrame(++submittedFenceValue);
+		}
+
+		// Nothing completed yet
+		ring.release(completedFenceValue);
+		CHECK(ring.getUsedSize() == 768);
+		CHECK(ring.allocate(512) == RingAllocator::invalidOffset);
+
+		completedFenceValue = 1;
+		ring.release(completedFenceValue);
+		CHECK(ring.getUsedSize() == 512);
+		CHECK(ring.hasPendingFrames() && ring.getOldestFenceValue() == 2);
+		CHECK(ring.allocate(256) == 768);
+
+		// The current frame is not finished, so it is not released with the others
+		completedFenceValue = 3;
+		ring.release(completedFenceValue);
+		CHECK(ring.getUsedSize() == 256);
+		CHECK(!ring.hasPendingFrames());
+
+		ring.finishFrame(++submittedFenceValue);
+		ring.release(submittedFenceValue - 1);
+		CHECK(ring.getUsedSize() == 256);
+		ring.release(submittedFenceValue);
+		CHECK(ring.getUsedSize() == 0);
+	}
+
+	// Random allocations and releases, live allocations must never overlap and everything is freed in the end
+	void testRandom()
+	{
+		struct Allocation {
+			uint64_t offset;
+			uint64_t size;
+			uint64_t fenceValue;
+		};
+
+		mt19937 rng(1);
+		for (int trial = 0; trial < 200; ++trial) {
+			const uint64_t capacity = 256 + rng() % 4096;
+			RingAllocator ring(capacity);
+			vector<Allocation> live;
+			uint64_t fenceValue = 0;
+
+			auto release = [&](uint64_t completedFenceValue) {
+				ring.release(completedFenceValue);
+				live.erase(remove_if(live.begin(), live.end(), [&](const Allocation& a) { return a.fenceValue <= completedFenceValue; }), live.end());
+			};
+
+			for (int frame = 0; frame < 300; ++frame) {
+				const int count = rng() % 6;
+				for (int i = 0; i < count; ++i) {
+					const uint64_t size = 1 + rng() % (capacity / 3);
+					const uint64_t alignment = 1ull << (rng() % 5);
+
+					uint64_t offset = ring.allocate(size, alignment);
+					if (offset == RingAllocator::invalidOffset && ring.hasPendingFrames()) {
+						release(ring.getOldestFenceValue());
+						offset = ring.allocate(size, alignment);
+					}
+					if (offset == RingAllocator::invalidOffset) {
+						continue;
+					}
+
+					CHECK(offset % alignment == 0 && offset + size <= capacity);
+					for (const auto& a : live) {
+						CHECK(offset >= a.offset + a.size || a.offset >= offset + size);
+					}
+					live.push_back({ offset, size, fenceValue + 1 });
+				}
+
+				ring.finishFrame(++fenceValue);
+				if (rng() % 3 == 0) {
+					release(fenceValue - std::min<uint64_t>(fenceValue, rng() % 3));
+				}
+			}
+
+			ring.release(fenceValue);
+			CHECK(ring.getUsedSize() == 0);
+		}
+	}
+}
+
+int main()
+{
+	testAlignment();
+	testWrapAround();
+	testFull();
+	testReleaseByFenceValue();
+	testRandom();
+	return 0;
+}
@@ -0,0 +1,262 @@
+#include "Util/ShaderTableBuilder.h"
+
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "Check.h"
+
+using namespace std;
+using Util::ShaderTableBuilder;
+
+namespace {
+	vector<uint8_t> makeIdentifier(uint8_t value)
+	{
+		return vector<uint8_t>(ShaderTableBuilder::identifierSize, value);
+	}
+
+	void testSections()
+	{
+		// Ray generation with one handle, two misses without arguments, six hit groups with a handle, six constants and a handle
+		ShaderTableBuilder builder({ { 1, 8 }, { 2, 0 }, { 6, 8 * 6 + 8 } });
+		const vector<ShaderTableBuilder::Section>& sections = builder.getSections();
+		CHECK(sections.size() == 3);
+
+		// Records are padded to 32 bytes, sections to 64
+		CHECK(sections[0].offset == 0 && sections[0].recordStride == 64 && sections[0].recordCount == 1 && sections[0].size == 64);
+		CHECK(sections[1].offset == 64 && sections[1].recordStride == 32 && sections[1].recordCount == 2 && sections[1].size == 64);
+		CHECK(sections[2].offset == 128 && sections[2].recordStride == 96 && sections[2].recordCount == 6 && sections[2].size == 576);
+		CHECK(builder.getSize() == 704 && builder.getData().size() == 704);
+
+		for (const auto& section : sections) {
+			CHECK(section.offset % ShaderTableBuilder::tableAlignment == 0);
+			CHECK(section.recordStride % ShaderTableBuilder::recordAlignment == 0);
+		}
+
+		// An empty section takes no space
+		ShaderTableBuilder empty({ { 1, 0 }, { 0, 0 }, { 1, 0 } });
+		CHECK(empty.getSections()[1].size == 0 && empty.getSections()[2].offset == 64);
+
+		// A new table is dirty as a whole
+		const auto ranges = builder.takeDirtyRanges();
+		CHECK(ranges.size() == 1 && ranges[0].first == 0 && ranges[0].second == 704);
+		CHECK(builder.takeDirtyRanges().empty());
+	}
+
+	void testDirtyRanges()
+	{
+		ShaderTableBuilder builder({ { 1, 8 }, { 2, 0 }, { 6, 8 * 6 + 8 } });
+		builder.takeDirtyRanges();
+
+		const uint32_t constants[] = { 1, 2, 3 };
+		ShaderTableBuilder::Arguments arguments;
+		arguments.addHandle(0x1122334455667788ull);
+		arguments.addConstants(constants, 3);
+		arguments.addHandle(5);
+
+		// Only the record, and only the bytes that differ from the zeroes it replaces
+		const auto identifier = makeIdentifier(7);
+		builder.setRecord(2, 1, identifier.data(), arguments);
+		auto ranges = builder.takeDirtyRanges();
+		CHECK(ranges.size() == 1 && ranges[0].first == 128 + 96 && ranges[0].second <= 128 + 96 * 2);
+
+		// Setting the same record again changes nothing
+		builder.setRecord(2, 1, identifier.data(), arguments);
+		CHECK(builder.takeDirtyRanges().empty());
+
+		// One changed constant is one dirty byte
+		const uint32_t changedConstants[] = { 1, 9, 3 };
+		ShaderTableBuilder::Arguments changed;
+		changed.addHandle(0x1122334455667788ull);
+		changed.addConstants(changedConstants, 3);
+		changed.addHandle(5);
+		builder.setRecord(2, 1, identifier.data(), changed);
+		ranges = builder.takeDirtyRanges();
+		CHECK(ranges.size() == 1 && ranges[0].first == 128 + 96 + 32 + 8 + 4 && ranges[0].second == ranges[0].first + 1);
+
+		// Changes that touch merge into one range, set in any order. The zero padding between hit group records stays clean.
+		builder.setRecord(1, 1, makeIdentifier(1).data(), {});
+		builder.setRecord(1, 0, makeIdentifier(1).data(), {});
+		builder.setRecord(2, 3, makeIdentifier(1).data(), {});
+		builder.setRecord(2, 2, makeIdentifier(1).data(), {});
+		ranges = builder.takeDirtyRanges();
+		CHECK(ranges.size() == 3);
+		CHECK(ranges[0].first == 64 && ranges[0].second == 128);
+		CHECK(ranges[1].first == 128 + 96 * 2 && ranges[1].second == 128 + 96 * 2 + 32);
+		CHECK(ranges[2].first == 128 + 96 * 3 && ranges[2].second == 128 + 96 * 3 + 32);
+
+		// Records that don't exist or arguments that don't fit
+		bool threw = false;
+		try {
+			builder.setRecord(1, 0, identifier.data(), arguments);
+		}
+		catch (const out_of_range&) {
+			threw = true;
+		}
+		CHECK(threw);
+
+		threw = false;
+		try {
+			builder.setRecord(2, 6, identifier.data(), arguments);
+		}
+		catch (const out_of_range&) {
+			threw = true;
+		}
+		CHECK(threw);
+
+		threw = false;
+		try {
+			builder.setRecord(3, 0, identifier.data(), {});
+		}
+		catch (const out_of_range&) {
+			threw = true;
+		}
+		CHECK(threw);
+		CHECK(builder.takeDirtyRanges().empty());
+	}
+
+	// Random records against a reference copy: the data always matches, every changed byte is in a dirty range, and the
+	// ranges are sorted, disjoint and not touching
+	void testRandom()
+	{
+		mt19937 rng(1);
+		for (int trial = 0; trial < 50; ++trial) {
+			vector<ShaderTableBuilder::SectionDesc> descs;
+			for (size_t i = 0; i < 3; ++i) {
+				descs.push_back({ rng() % 6, 8 * (rng() % 6) });
+			}
+
+			ShaderTableBuilder builder(descs);
+			vector<uint8_t> reference(builder.getSize());
+			builder.takeDirtyRanges();
+
+			for (int operation = 0; operation < 200; ++operation) {
+				const size_t section = rng() % 3;
+				const ShaderTableBuilder::Section& s = builder.getSections()[section];
+				if (s.recordCount == 0) {
+					continue;
+				}
+
+				const size_t record = rng() % s.recordCount;
+				const auto identifier = makeIdentifier(static_cast<uint8_t>(rng() % 2));
+				// Each argument takes at most 8 bytes, padding included
+				ShaderTableBuilder::Arguments arguments;
+				size_t expectedSize = 0;
+				for (size_t i = 0; i < descs[section].argumentsSize / ShaderTableBuilder::Arguments::handleSize; ++i) {
+					if (rng() % 2 == 0) {
+						const uint64_t handle = rng() % 3;
+						arguments.addHandle(handle);
+						expectedSize = ShaderTableBuilder::align(expectedSize, 8) + 8;
+
+						uint64_t written = 0;
+						memcpy(&written, arguments.getData().data() + expectedSize - 8, sizeof(written));
+						CHECK(written == handle);
+					}
+					else {
+						const uint32_t value = rng() % 3;
+						arguments.addConstants(&value, 1);
+						expectedSize += 4;
+					}
+				}
+				CHECK(arguments.getData().size() == expectedSize);
+				builder.setRecord(section, record, identifier.data(), arguments);
+
+				const vector<uint8_t> before = reference;
+				const size_t offset = s.offset + s.recordStride * record;
+				fill(reference.begin() + offset, reference.begin() + offset + s.recordStride, uint8_t(0));
+				copy(identifier.begin(), identifier.end(), reference.begin() + offset);
+				copy(arguments.getData().begin(), arguments.getData().end(), reference.begin() + offset + ShaderTableBuilder::identifierSize);
+				CHECK(reference == builder.getData());
+
+				if (rng() % 4 != 0) {
+					continue;
+				}
+
+				const auto ranges = builder.takeDirtyRanges();
+				for (size_t i = 0; i < ranges.size(); ++i) {
+					CHECK(ranges[i].first < ranges[i].second && ranges[i].second <= builder.getSize());
+					CHECK(i == 0 || ranges[i - 1].second < ranges[i].first);
+				}
+				for (size_t i = 0; i < reference.size(); ++i) {
+					bool dirty = false;
+					for (const auto& range : ranges) {
+						dirty = dirty || (i >= range.first && i < range.second);
+					}
+					CHECK(dirty || before[i] == reference[i]);
+				}
+			}
+		}
+	}
+
+	// Constants are packed at 4 byte alignment, only a handle after an odd number of them is padded to 8
+	void testArgumentsLayout()
+	{
+		CHECK(ShaderTableBuilder::Arguments::handleSize == 8);
+
+		// Adjacent constants, and the last ones, are never padded
+		const uint32_t constants[] = { 1, 2, 3 };
+		ShaderTableBuilder::Arguments packed;
+		packed.addConstants(constants, 1);
+		packed.addConstants(constants + 1, 2);
+		CHECK(packed.getData().size() == 12);
+
+		uint32_t readConstants[3] = {};
+		memcpy(readConstants, packed.getData().data(), sizeof(readConstants));
+		CHECK(readConstants[0] == 1 && readConstants[1] == 2 && readConstants[2] == 3);
+
+		ShaderTableBuilder::Arguments trailing;
+		trailing.addHandle(1);
+		trailing.addConstants(constants, 1);
+		CHECK(trailing.getData().size() == 12);
+
+		// An even number of constants keeps the handle after them aligned on its own
+		ShaderTableBuilder::Arguments even;
+		even.addConstants(constants, 2);
+		even.addHandle(5);
+		CHECK(even.getData().size() == 16);
+
+		uint64_t handle = 0;
+		memcpy(&handle, even.getData().data() + 8, sizeof(handle));
+		CHECK(handle == 5);
+
+		// Handle, three constants, handle: the last handle moves to the next 8 bytes and the padding is zero
+		ShaderTableBuilder::Arguments arguments;
+		arguments.addHandle(0x1122334455667788ull);
+		arguments.addConstants(constants, 3);
+		arguments.addHandle(5);
+
+		const vector<uint8_t>& data = arguments.getData();
+		CHECK(data.size() == 32);
+
+		memcpy(readConstants, data.data() + 8, sizeof(readConstants));
+		CHECK(readConstants[0] == 1 && readConstants[1] == 2 && readConstants[2] == 3);
+		CHECK(data[20] == 0 && data[21] == 0 && data[22] == 0 && data[23] == 0);
+
+		memcpy(&handle, data.data() + 24, sizeof(handle));
+		CHECK(handle == 5);
+
+		// A record sized the way ShadingTable sizes it (the same arguments with zeroes) fits exactly
+		ShaderTableBuilder::Arguments zeroes;
+		const uint32_t zeroConstants[3] = {};
+		zeroes.addHandle(0);
+		zeroes.addConstants(zeroConstants, 3);
+		zeroes.addHandle(0);
+		CHECK(zeroes.getData().size() == data.size());
+
+		ShaderTableBuilder builder({ { 1, zeroes.getData().size() } });
+		CHECK(builder.getSections()[0].recordStride == ShaderTableBuilder::align(ShaderTableBuilder::identifierSize + data.size(), ShaderTableBuilder::recordAlignment));
+		const uint8_t identifier[ShaderTableBuilder::identifierSize] = {};
+		builder.setRecord(0, 0, identifier, arguments);
+		CHECK(memcmp(builder.getData().data() + ShaderTableBuilder::identifierSize, data.data(), data.size()) == 0);
+	}
+}
+
+int main()
+{
+	testSections();
+	testDirtyRanges();
+	testRandom();
+	testArgumentsLayout();
+	return 0;
+}
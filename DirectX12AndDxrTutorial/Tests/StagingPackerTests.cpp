@@ -0,0 +1,109 @@
+#include "Util/StagingPacker.h"
+
+#include <random>
+#include <vector>
+
+#include "Check.h"
+
+using namespace std;
+using Util::StagingPacker;
+
+namespace {
+	void testFirstFit()
+	{
+		StagingPacker packer(1000);
+		const auto a = packer.add(600, 1);
+		const auto b = packer.add(600, 1);
+		CHECK(a.page == 0 && a.offset == 0);
+		CHECK(b.page == 1 && b.offset == 0);
+
+		// Fits behind a, which comes first
+		const auto c = packer.add(300, 1);
+		CHECK(c.page == 0 && c.offset == 600);
+
+		// Doesn't fit behind a and c anymore, but behind b
+		const auto d = packer.add(200, 1);
+		CHECK(d.page == 1 && d.offset == 600);
+
+		CHECK(packer.getPageSizes() == vector<uint64_t>({ 900, 800 }));
+		CHECK(packer.getTotalSize() == 1700);
+	}
+
+	void testAlignment()
+	{
+		StagingPacker packer(1024);
+		CHECK(packer.add(10, 1).offset == 0);
+		CHECK(packer.add(10, 256).offset == 256);
+		CHECK(packer.add(1, 4).offset == 268);
+
+		// The padding would push it over the page size, so it opens a new page instead
+		const auto placement = packer.add(512, 512);
+		CHECK(placement.page == 0 && placement.offset == 512);
+		const auto next = packer.add(1, 512);
+		CHECK(next.page == 1 && next.offset == 0);
+	}
+
+	void testOversize()
+	{
+		StagingPacker packer(1000);
+		CHECK(packer.add(100, 1).page == 0);
+
+		// Larger than a page: a page of its own, exactly as large as the upload
+		const auto large = packer.add(5000, 256);
+		CHECK(large.page == 1 && large.offset == 0);
+		CHECK(packer.getPageSizes()[1] == 5000);
+
+		// Nothing else goes into the oversized page
+		const auto small = packer.add(1, 1);
+		CHECK(small.page == 0 && small.offset == 100);
+		CHECK(packer.getTotalSize() == 5101);
+	}
+
+	// Random uploads: aligned, inside their page, pages only exceed the page size for a single oversized upload, no overlaps
+	void testRandom()
+	{
+		struct Upload {
+			size_t page;
+			uint64_t offset;
+			uint64_t size;
+		};
+
+		mt19937_64 rng(7);
+		for (int trial = 0; trial < 2000; ++trial) {
+			const uint64_t pageSize = 1 + rng() % 5000;
+			StagingPacker packer(pageSize);
+			vector<Upload> uploads;
+
+			const int count = rng() % 60;
+			for (int i = 0; i < count; ++i) {
+				const uint64_t size = rng() % 2 == 0 ? rng() % 300 : rng() % 8000;
+				const uint64_t alignment = 1ull << (rng() % 9);
+				const auto placement = packer.add(size, alignment);
+				CHECK(placement.offset % alignment == 0);
+				uploads.push_back({ placement.page, placement.offset, size });
+			}
+
+			const auto& pageSizes = packer.getPageSizes();
+			for (size_t i = 0; i < uploads.size(); ++i) {
+				const auto& u = uploads[i];
+				CHECK(u.page < pageSizes.size() && u.offset + u.size <= pageSizes[u.page]);
+				CHECK(pageSizes[u.page] <= pageSize || (u.offset == 0 && pageSizes[u.page] == u.size));
+				for (size_t j = i + 1; j < uploads.size(); ++j) {
+					const auto& v = uploads[j];
+					if (u.page == v.page && u.size > 0 && v.size > 0) {
+						CHECK(u.offset + u.size <= v.offset || v.offset + v.size <= u.offset);
+					}
+				}
+			}
+		}
+	}
+}
+
+int main()
+{
+	testFirstFit();
+	testAlignment();
+	testOversize();
+	testRandom();
+	return 0;
+}
@@ -0,0 +1,71 @@
+#include "BlasBuildPlan.h"
+
+#include <algorithm>
+
+using namespace std;
+
+Util::BlasBuildPlan::BlasBuildPlan(const std::vector<std::uint64_t>& scratchSizes, const std::vector<std::uint64_t>& resultSizes, std::uint64_t scratchBudget)
+	: scratchArenaSize(), resultSize()
+{
+	builds.resize(scratchSizes.size());
+
+	const vector<uint64_t> resultOffsets = pack(resultSizes, resultSize);
+	for (size_t i = 0; i < builds.size(); ++i) {
+		builds[i].resultOffset = resultOffsets[i];
+	}
+
+	// Greedy, in order, so that a batch is a contiguous range of builds
+	for (size_t i = 0; i < builds.size(); ++i) {
+		const uint64_t size = align(scratchSizes[i]);
+
+		if (batches.empty() || (batches.back().scratchSize + size > scratchBudget && batches.back().begin != i)) {
+			batches.push_back({ i, i, 0 });
+		}
+
+		Batch& batch = batches.back();
+		builds[i].scratchOffset = batch.scratchSize;
+		builds[i].batch = batches.size() - 1;
+		batch.scratchSize += size;
+		batch.end = i + 1;
+
+		scratchArenaSize = std::max(scratchArenaSize, batch.scratchSize);
+	}
+}
+
+const std::vector<Util::BlasBuildPlan::Build>& Util::BlasBuildPlan::getBuilds() const
+{
+	return builds;
+}
+
+const std::vector<Util::BlasBuildPlan::Batch>& Util::BlasBuildPlan::getBatches() const
+{
+	return batches;
+}
+
+std::uint64_t Util::BlasBuildPlan::getScratchArenaSize() const
+{
+	return scratchArenaSize;
+}
+
+std::uint64_t Util::BlasBuildPlan::getResultSize() const
+{
+	return resultSize;
+}
+
+std::vector<std::uint64_t> Util::BlasBuildPlan::pack(const std::vector<std::uint64_t>& sizes, std::uint64_t& totalSize)
+{
+	vector<uint64_t> offsets(sizes.size());
+
+	totalSize = 0;
+	for (size_t i = 0; i < sizes.size(); ++i) {
+		offsets[i] = totalSize;
+		totalSize += align(sizes[i]);
+	}
+
+	return offsets;
+}
+
+std::uint64_t Util::BlasBuildPlan::align(std::uint64_t size)
+{
+	return (size + alignment - 1) & ~(alignment - 1);
+}
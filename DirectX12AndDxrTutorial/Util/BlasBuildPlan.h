@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Util
+{
+	// Decides how a group of bottom level AS builds shares memory. Builds are split into batches whose scratch regions fit
+	// in one arena (a build larger than the budget gets a batch of its own), every build of a batch gets its own region of
+	// the arena and all results are packed into one buffer. Only works with sizes, so it knows nothing about the device.
+	class BlasBuildPlan {
+	public:
+		// D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT, applies to scratch and result addresses alike
+		static constexpr std::uint64_t alignment = 256;
+		static constexpr std::uint64_t defaultScratchBudget = 64 * 1024 * 1024;
+
+		struct Build {
+			std::uint64_t scratchOffset; // In the scratch arena
+			std::uint64_t resultOffset; // In the result buffer
+			std::size_t batch;
+		};
+
+		// Builds [begin, end) run together and may not overlap in the arena, consecutive batches reuse it
+		struct Batch {
+			std::size_t begin;
+			std::size_t end;
+			std::uint64_t scratchSize;
+		};
+
+		BlasBuildPlan(const std::vector<std::uint64_t>& scratchSizes, const std::vector<std::uint64_t>& resultSizes, std::uint64_t scratchBudget = defaultScratchBudget);
+
+		const std::vector<Build>& getBuilds() const;
+		const std::vector<Batch>& getBatches() const;
+		// Largest batch
+		std::uint64_t getScratchArenaSize() const;
+		std::uint64_t getResultSize() const;
+
+		// Aligned offsets of sizes placed back to back, totalSize receives the size of the whole block
+		static std::vector<std::uint64_t> pack(const std::vector<std::uint64_t>& sizes, std::uint64_t& totalSize);
+		static std::uint64_t align(std::uint64_t size);
+
+	private:
+		std::vector<Build> builds;
+		std::vector<Batch> batches;
+		std::uint64_t scratchArenaSize;
+		std::uint64_t resultSize;
+	};
+}
@@ -0,0 +1,128 @@
+#include "BuddyAllocator.h"
+
+#include <algorithm>
+
+using namespace std;
+
+Util::BuddyAllocator::BuddyAllocator(std::uint64_t capacity, std::uint64_t minBlockSize)
+	: capacity(capacity), minBlockSize(minBlockSize), maxOrder(), allocatedSize()
+{
+	while (getBlockSize(maxOrder) < capacity) {
+		++maxOrder;
+	}
+
+	freeBlocks.resize(maxOrder + 1);
+	freeBlocks[maxOrder].insert(0);
+}
+
+std::uint64_t Util::BuddyAllocator::allocate(std::uint64_t size, std::uint64_t alignment)
+{
+	const uint64_t requiredSize = std::max(size, alignment);
+	if (size == 0 || requiredSize > capacity) {
+		return invalidOffset;
+	}
+
+	const int order = getOrder(requiredSize);
+
+	// Smallest free block that is large enough
+	int freeOrder = order;
+	while (freeOrder <= maxOrder && freeBlocks[freeOrder].empty()) {
+		++freeOrder;
+	}
+
+	if (freeOrder > maxOrder) {
+		return invalidOffset;
+	}
+
+	const uint64_t offset = *freeBlocks[freeOrder].begin();
+	freeBlocks[freeOrder].erase(freeBlocks[freeOrder].begin());
+
+	// Split it, keeping the lower half and freeing the upper ones
+	while (freeOrder > order) {
+		--freeOrder;
+		freeBlocks[freeOrder].insert(offset + getBlockSize(freeOrder));
+	}
+
+	allocatedOrders.emplace(offset, order);
+	allocatedSize += getBlockSize(order);
+
+	return offset;
+}
+
+void Util::BuddyAllocator::free(std::uint64_t offset)
+{
+	const auto it = allocatedOrders.find(offset);
+	if (it == allocatedOrders.end()) {
+		return;
+	}
+
+	int order = it->second;
+	allocatedOrders.erase(it);
+	allocatedSize -= getBlockSize(order);
+
+	// Merge with the buddy as long as it is free
+	while (order < maxOrder) {
+		const uint64_t buddy = offset ^ getBlockSize(order);
+		const auto buddyIt = freeBlocks[order].find(buddy);
+		if (buddyIt == freeBlocks[order].end()) {
+			break;
+		}
+
+		freeBlocks[order].erase(buddyIt);
+		offset = std::min(offset, buddy);
+		++order;
+	}
+
+	freeBlocks[order].insert(offset);
+}
+
+std::uint64_t Util::BuddyAllocator::getCapacity() const
+{
+	return capacity;
+}
+
+std::uint64_t Util::BuddyAllocator::getMinBlockSize() const
+{
+	return minBlockSize;
+}
+
+std::uint64_t Util::BuddyAllocator::getAllocatedSize() const
+{
+	return allocatedSize;
+}
+
+std::uint64_t Util::BuddyAllocator::getLargestFreeBlockSize() const
+{
+	for (int order = maxOrder; order >= 0; --order) {
+		if (!freeBlocks[order].empty()) {
+			return getBlockSize(order);
+		}
+	}
+
+	return 0;
+}
+
+std::size_t Util::BuddyAllocator::getAllocationCount() const
+{
+	return allocatedOrders.size();
+}
+
+bool Util::BuddyAllocator::isEmpty() const
+{
+	return allocatedOrders.empty();
+}
+
+int Util::BuddyAllocator::getOrder(std::uint64_t size) const
+{
+	int order = 0;
+	while (getBlockSize(order) < size) {
+		++order;
+	}
+
+	return order;
+}
+
+std::uint64_t Util::BuddyAllocator::getBlockSize(int order) const
+{
+	return minBlockSize << order;
+}
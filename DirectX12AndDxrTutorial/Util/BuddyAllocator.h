@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace Util
+{
+	// Binary buddy allocator over [0, capacity). Blocks are powers of two between minBlockSize and capacity and are aligned
+	// to their size, so any alignment up to the block size comes for free. Freed blocks merge with their buddy right away.
+	// Only hands out offsets, the memory itself belongs to the owner.
+	class BuddyAllocator {
+	public:
+		static constexpr std::uint64_t invalidOffset = std::numeric_limits<std::uint64_t>::max();
+
+		// Both have to be powers of two, capacity at least minBlockSize
+		BuddyAllocator(std::uint64_t capacity, std::uint64_t minBlockSize);
+
+		// Returns invalidOffset if there is no free block large enough. alignment has to be a power of two.
+		std::uint64_t allocate(std::uint64_t size, std::uint64_t alignment = 1);
+		// offset has to come from allocate
+		void free(std::uint64_t offset);
+
+		std::uint64_t getCapacity() const;
+		std::uint64_t getMinBlockSize() const;
+		// Sum of the allocated block sizes, includes the rounding up to a power of two
+		std::uint64_t getAllocatedSize() const;
+		std::uint64_t getLargestFreeBlockSize() const;
+		std::size_t getAllocationCount() const;
+		bool isEmpty() const;
+
+	private:
+		// Smallest order whose blocks hold size bytes
+		int getOrder(std::uint64_t size) const;
+		std::uint64_t getBlockSize(int order) const;
+
+		std::uint64_t capacity;
+		std::uint64_t minBlockSize;
+		int maxOrder;
+		std::uint64_t allocatedSize;
+
+		// Free block offsets per order, lowest address first
+		std::vector<std::set<std::uint64_t>> freeBlocks;
+		// Order of every allocated block
+		std::unordered_map<std::uint64_t, int> allocatedOrders;
+	};
+}
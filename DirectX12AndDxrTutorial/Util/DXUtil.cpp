@@ -7,12 +7,38 @@
 #include <DirectXMath.h>
 #include "Libraries/d3dx12.h"
 
+#include <cstring>
 #include <iostream>
+#include <algorithm>
 
 namespace wrl = Microsoft::WRL;
 
 using namespace Util;
 
+Util::GpuMemoryAllocator* Util::DXUtil::memoryAllocator = nullptr;
+
+namespace {
+	// One subresource per mip level of data tightly packed from largest to smallest.
+	// Block compressed rows hold 4 texel rows, sizePerPixel is then the block size.
+	std::vector<D3D12_SUBRESOURCE_DATA> getMipSubresourceData(const void* ptData, std::size_t width, std::size_t height, std::size_t sizePerPixel, DXGI_FORMAT format, UINT16 mipLevels)
+	{
+		const std::size_t blockDimension = DXUtil::isBlockCompressed(format) ? 4 : 1;
+		std::vector<D3D12_SUBRESOURCE_DATA> subresourceData(mipLevels);
+		const std::uint8_t* levelData = static_cast<const std::uint8_t*>(ptData);
+		for (auto& subresource : subresourceData) {
+			subresource.pData = levelData;
+			subresource.RowPitch = (width + blockDimension - 1) / blockDimension * sizePerPixel;
+			subresource.SlicePitch = subresource.RowPitch * ((height + blockDimension - 1) / blockDimension);
+
+			levelData += subresource.SlicePitch;
+			width = std::max<std::size_t>(1, width / 2);
+			height = std::max<std::size_t>(1, height / 2);
+		}
+
+		return subresourceData;
+	}
+}
+
 void Util::DXUtil::enableDebugLayer()
 {
 #ifdef _DEBUG
@@ -257,15 +283,30 @@ std::vector<wrl::ComPtr<ID3D12Resource>> Util::DXUtil::createDepthStencilView(
 	return depthBuffers;
 }
 
+void Util::DXUtil::setMemoryAllocator(GpuMemoryAllocator* allocator)
+{
+	memoryAllocator = allocator;
+}
+
+Util::GpuMemoryAllocator* Util::DXUtil::getMemoryAllocator()
+{
+	return memoryAllocator;
+}
+
 wrl::ComPtr<ID3D12Resource> Util::DXUtil::createCommittedResource(wrl::ComPtr<ID3D12Device5> device, D3D12_HEAP_TYPE heapType, UINT64 size, D3D12_RESOURCE_STATES resourceState, D3D12_RESOURCE_FLAGS resourceFlags)
 {
 	wrl::ComPtr<ID3D12Resource> buffer;
+	const CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Buffer(size, resourceFlags);
+
+	if (memoryAllocator) {
+		return memoryAllocator->createResource(heapType, desc, resourceState);
+	}
 	
 	HRESULT hr;
 	GFXTHROWIFFAILED(device->CreateCommittedResource(
 		&CD3DX12_HEAP_PROPERTIES(heapType),
 		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(size, resourceFlags),
+		&desc,
 		resourceState,
 		nullptr,
 		IID_PPV_ARGS(&buffer)
@@ -274,16 +315,20 @@ wrl::ComPtr<ID3D12Resource> Util::DXUtil::createCommittedResource(wrl::ComPtr<ID
 	return buffer;
 }
 
-Microsoft::WRL::ComPtr<ID3D12Resource> Util::DXUtil::createTextureCommittedResource(Microsoft::WRL::ComPtr<ID3D12Device5> device, D3D12_HEAP_TYPE heapType, UINT64 width, UINT64 height, D3D12_RESOURCE_STATES resourceState, D3D12_RESOURCE_FLAGS resourceFlags, DXGI_FORMAT format)
+Microsoft::WRL::ComPtr<ID3D12Resource> Util::DXUtil::createTextureCommittedResource(Microsoft::WRL::ComPtr<ID3D12Device5> device, D3D12_HEAP_TYPE heapType, UINT64 width, UINT64 height, D3D12_RESOURCE_STATES resourceState, D3D12_RESOURCE_FLAGS resourceFlags, DXGI_FORMAT format, UINT16 mipLevels)
 {
 	wrl::ComPtr<ID3D12Resource> buffer;
+	const CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex2D(format, width, height, 1u, mipLevels, 1u, 0u, resourceFlags);
+
+	if (memoryAllocator) {
+		return memoryAllocator->createResource(heapType, desc, resourceState);
+	}
 
-	// TODO: Check - Do we need mip level 1 for Ray Tracing?
 	HRESULT hr;
 	GFXTHROWIFFAILED(device->CreateCommittedResource(
 		&CD3DX12_HEAP_PROPERTIES(heapType),
 		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Tex2D(format, width, height, 1u, 1u, 1u, 0u, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS),
+		&desc,
 		resourceState,
 		nullptr,
 		IID_PPV_ARGS(&buffer)
@@ -302,21 +347,17 @@ wrl::ComPtr<ID3D12Resource> Util::DXUtil::uploadDataToDefaultHeap(wrl::ComPtr<ID
 	return defaultResource;
 }
 
-Microsoft::WRL::ComPtr<ID3D12Resource> Util::DXUtil::uploadTextureDataToDefaultHeap(Microsoft::WRL::ComPtr<ID3D12Device5> device, Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList, Microsoft::WRL::ComPtr<ID3D12Resource>& tempResource, const void* ptData, std::size_t width, std::size_t height, std::size_t sizePerPixel, DXGI_FORMAT format, D3D12_RESOURCE_STATES finalState)
+Microsoft::WRL::ComPtr<ID3D12Resource> Util::DXUtil::uploadTextureDataToDefaultHeap(Microsoft::WRL::ComPtr<ID3D12Device5> device, Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList, Microsoft::WRL::ComPtr<ID3D12Resource>& tempResource, const void* ptData, std::size_t width, std::size_t height, std::size_t sizePerPixel, DXGI_FORMAT format, D3D12_RESOURCE_STATES finalState, UINT16 mipLevels)
 {
 	// create texture
-	wrl::ComPtr<ID3D12Resource> texResource = createTextureCommittedResource(device, D3D12_HEAP_TYPE_DEFAULT, width, height, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_FLAG_NONE, format);
+	wrl::ComPtr<ID3D12Resource> texResource = createTextureCommittedResource(device, D3D12_HEAP_TYPE_DEFAULT, width, height, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_FLAG_NONE, format, mipLevels);
 
-	const UINT64 uploadBufferSize = GetRequiredIntermediateSize(texResource.Get(), 0, 1);
-	//const UINT64 uploadBufferSize = width * height * 4;
+	const UINT64 uploadBufferSize = GetRequiredIntermediateSize(texResource.Get(), 0, mipLevels);
+	const std::vector<D3D12_SUBRESOURCE_DATA> subresourceData = getMipSubresourceData(ptData, width, height, sizePerPixel, format, mipLevels);
 
 	// Upload buffer to gpu
 	tempResource = DXUtil::createCommittedResource(device, D3D12_HEAP_TYPE_UPLOAD, uploadBufferSize, D3D12_RESOURCE_STATE_GENERIC_READ);
-	D3D12_SUBRESOURCE_DATA subresourceData = {};
-	subresourceData.pData = ptData;
-	subresourceData.RowPitch = width * sizePerPixel;
-	subresourceData.SlicePitch = subresourceData.RowPitch * height;
-	UpdateSubresources(pCommandList.Get(), texResource.Get(), tempResource.Get(), 0, 0, 1, &subresourceData);
+	UpdateSubresources(pCommandList.Get(), texResource.Get(), tempResource.Get(), 0, 0, mipLevels, subresourceData.data());
 
 	// Change state so that it can be read
 	pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, finalState));
@@ -324,6 +365,33 @@ Microsoft::WRL::ComPtr<ID3D12Resource> Util::DXUtil::uploadTextureDataToDefaultH
 	return texResource;
 }
 
+Microsoft::WRL::ComPtr<ID3D12Resource> Util::DXUtil::uploadTextureDataToDefaultHeap(Microsoft::WRL::ComPtr<ID3D12Device5> device, Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList, const UploadAllocator& allocateUpload, const void* ptData, std::size_t width, std::size_t height, std::size_t sizePerPixel, DXGI_FORMAT format, D3D12_RESOURCE_STATES finalState, UINT16 mipLevels)
+{
+	wrl::ComPtr<ID3D12Resource> texResource = createTextureCommittedResource(device, D3D12_HEAP_TYPE_DEFAULT, width, height, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_FLAG_NONE, format, mipLevels);
+
+	const UINT64 uploadSize = GetRequiredIntermediateSize(texResource.Get(), 0, mipLevels);
+	const std::vector<D3D12_SUBRESOURCE_DATA> subresourceData = getMipSubresourceData(ptData, width, height, sizePerPixel, format, mipLevels);
+
+	// The footprints are placed from the allocation's offset on, which the copy requires to be aligned
+	const UploadAllocation upload = allocateUpload(static_cast<std::size_t>(uploadSize));
+	if (upload.offset % D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT != 0) {
+		ThrowException("Texture upload allocations have to be aligned to D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT");
+	}
+
+	UpdateSubresources(pCommandList.Get(), texResource.Get(), upload.pResource, upload.offset, 0, mipLevels, subresourceData.data());
+
+	pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(texResource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, finalState));
+
+	return texResource;
+}
+
+UINT64 Util::DXUtil::getTextureUploadSize(Microsoft::WRL::ComPtr<ID3D12Device5> device, const D3D12_RESOURCE_DESC& desc)
+{
+	UINT64 size = 0;
+	device->GetCopyableFootprints(&desc, 0, desc.MipLevels, 0, nullptr, nullptr, nullptr, &size);
+	return size;
+}
+
 void Util::DXUtil::updateDataInDefaultHeap(Microsoft::WRL::ComPtr<ID3D12Device5> pDevice, Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList, Microsoft::WRL::ComPtr<ID3D12Resource>& resource, Microsoft::WRL::ComPtr<ID3D12Resource>& tempResource, const void* ptData, std::size_t dataSize, D3D12_RESOURCE_STATES previousState, D3D12_RESOURCE_STATES finalState)
 {
 	// Transition to correct state
@@ -340,10 +408,85 @@ void Util::DXUtil::updateDataInDefaultHeap(Microsoft::WRL::ComPtr<ID3D12Device5>
 	UpdateSubresources(pCommandList.Get(), resource.Get(), tempResource.Get(), 0, 0, 1, &subresourceData);
 
 	// Change state so that it can be read
-	pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, finalState));
+	if (finalState != D3D12_RESOURCE_STATE_COPY_DEST) {
+		pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, finalState));
+	}
+}
+
+
+void Util::DXUtil::updateDataInDefaultHeap(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList, Microsoft::WRL::ComPtr<ID3D12Resource>& resource, const UploadAllocator& allocateUpload, const void* ptData, std::size_t dataSize, D3D12_RESOURCE_STATES previousState, D3D12_RESOURCE_STATES finalState)
+{
+	updateDataRangesInDefaultHeap(pCommandList, resource, allocateUpload, ptData, dataSize, { { 0, 1 } }, previousState, finalState);
+}
+
+void Util::DXUtil::updateDataRangesInDefaultHeap(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList, Microsoft::WRL::ComPtr<ID3D12Resource>& resource, const UploadAllocator& allocateUpload, const void* ptData, std::size_t elementSize, const std::vector<std::pair<std::size_t, std::size_t>>& ranges, D3D12_RESOURCE_STATES previousState, D3D12_RESOURCE_STATES finalState)
+{
+	std::size_t uploadSize = 0;
+	for (const auto& range : ranges) {
+		uploadSize += (range.second - range.first) * elementSize;
+	}
+
+	if (uploadSize == 0) {
+		return;
+	}
+
+	// Pack the ranges into the upload allocation
+	const UploadAllocation upload = allocateUpload(uploadSize);
+
+	std::size_t uploadOffset = 0;
+	for (const auto& range : ranges) {
+		const std::size_t size = (range.second - range.first) * elementSize;
+		memcpy(upload.pData + uploadOffset, static_cast<const std::uint8_t*>(ptData) + range.first * elementSize, size);
+		uploadOffset += size;
+	}
+
+	if (previousState != D3D12_RESOURCE_STATE_COPY_DEST) {
+		pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(resource.Get(), previousState, D3D12_RESOURCE_STATE_COPY_DEST));
+	}
+
+	uploadOffset = 0;
+	for (const auto& range : ranges) {
+		const std::size_t size = (range.second - range.first) * elementSize;
+		pCommandList->CopyBufferRegion(resource.Get(), range.first * elementSize, upload.pResource, upload.offset + uploadOffset, size);
+		uploadOffset += size;
+	}
+
+	if (finalState != D3D12_RESOURCE_STATE_COPY_DEST) {
+		pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, finalState));
+	}
+}
+
+void Util::DXUtil::flushBarriers(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList, ResourceStateTracker& stateTracker)
+{
+	stateTracker.flush([&](const std::vector<ResourceStateTracker::Barrier>& barriers) {
+		std::vector<D3D12_RESOURCE_BARRIER> d3dBarriers;
+		d3dBarriers.reserve(barriers.size());
+
+		for (const auto& barrier : barriers) {
+			ID3D12Resource* pResource = static_cast<ID3D12Resource*>(barrier.resource);
+			if (barrier.type == ResourceStateTracker::Barrier::Uav) {
+				d3dBarriers.push_back(CD3DX12_RESOURCE_BARRIER::UAV(pResource));
+			}
+			else if (barrier.type == ResourceStateTracker::Barrier::Aliasing) {
+				// Whichever resource used the memory before
+				d3dBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(nullptr, pResource));
+			}
+			else {
+				d3dBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(pResource, static_cast<D3D12_RESOURCE_STATES>(barrier.before), static_cast<D3D12_RESOURCE_STATES>(barrier.after)));
+			}
+		}
+
+		pCommandList->ResourceBarrier(static_cast<UINT>(d3dBarriers.size()), d3dBarriers.data());
+	});
 }
 
 
+bool Util::DXUtil::isBlockCompressed(DXGI_FORMAT format)
+{
+	return (format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC5_SNORM) ||
+		   (format >= DXGI_FORMAT_BC6H_TYPELESS && format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+}
+
 wrl::ComPtr<ID3D12RootSignature> Util::DXUtil::createRootSignature(wrl::ComPtr<ID3D12Device5> pDevice, const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& rootSignatureDesc)
 {
 	// Check which root signature version we support - 1.1 is better than 1.0...
@@ -437,17 +580,17 @@ DXUtil::AccelerationStructureBuffers Util::DXUtil::createBottomLevelAS(
 void Util::DXUtil::buildTopLevelAS(
 	Microsoft::WRL::ComPtr<ID3D12Device5> pDevice,
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList,
-	std::vector<Util::DXUtil::AccelerationStructureBuffers> blasBuffers,
-	Microsoft::WRL::ComPtr<ID3D12Resource>& tlasTempBuffer,
+	const std::vector<Util::DXUtil::AccelerationStructureBuffers>& blasBuffers,
+	const std::vector<size_t>& blasIndices,
+	const UploadAllocator& allocateUpload,
 	const std::vector<size_t>& instanceIds,
 	const std::vector<DirectX::XMFLOAT3X4>& transforms,
-	bool update,
 	DXUtil::AccelerationStructureBuffers& tlasBuffers)
 {
 	// Query the buffer sizes that we need to allocate
 	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS rtStructureDescriptor = {};
 	rtStructureDescriptor.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-	rtStructureDescriptor.NumDescs = blasBuffers.size();
+	rtStructureDescriptor.NumDescs = instanceIds.size();
 	rtStructureDescriptor.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
 	rtStructureDescriptor.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE;
 	
@@ -455,51 +598,78 @@ void Util::DXUtil::buildTopLevelAS(
 	D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO prebuildInfo = {};
 	pDevice->GetRaytracingAccelerationStructurePrebuildInfo(&rtStructureDescriptor, &prebuildInfo);
 
-	if (update) {
-		pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::UAV(tlasBuffers.pResult.Get()));
-	}
-	else {
-		// Create the buffers..
-		tlasBuffers.pScratch = createCommittedResource(pDevice, D3D12_HEAP_TYPE_DEFAULT, prebuildInfo.ScratchDataSizeInBytes, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-		tlasBuffers.pResult = createCommittedResource(pDevice, D3D12_HEAP_TYPE_DEFAULT, prebuildInfo.ResultDataMaxSizeInBytes, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-	}
+	// Create the buffers.. Scratch space is enough for updates as well
+	tlasBuffers.pScratch = createCommittedResource(pDevice, D3D12_HEAP_TYPE_DEFAULT, std::max(prebuildInfo.ScratchDataSizeInBytes, prebuildInfo.UpdateScratchDataSizeInBytes), D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+	tlasBuffers.pResult = createCommittedResource(pDevice, D3D12_HEAP_TYPE_DEFAULT, prebuildInfo.ResultDataMaxSizeInBytes, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
 
-	std::vector<D3D12_RAYTRACING_INSTANCE_DESC> rtInstanceDescs;
-	rtInstanceDescs.resize(blasBuffers.size());
+	// Kept for updateTopLevelAS, which only touches the instances that changed
+	std::vector<D3D12_RAYTRACING_INSTANCE_DESC>& rtInstanceDescs = tlasBuffers.instanceDescs;
+	rtInstanceDescs.assign(instanceIds.size(), {});
 
-	for (size_t i = 0; i < blasBuffers.size(); ++i) {
+	for (size_t i = 0; i < rtInstanceDescs.size(); ++i) {
 		D3D12_RAYTRACING_INSTANCE_DESC &rtInstanceDesc = rtInstanceDescs[i];
 		rtInstanceDesc.InstanceID = instanceIds.at(i);
 		rtInstanceDesc.InstanceContributionToHitGroupIndex = 0;
 		rtInstanceDesc.Flags = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
-		rtInstanceDesc.AccelerationStructure = blasBuffers[i].pResult->GetGPUVirtualAddress();
+		const AccelerationStructureBuffers& blas = blasBuffers[blasIndices.at(i)];
+		rtInstanceDesc.AccelerationStructure = blas.pResult->GetGPUVirtualAddress() + blas.resultOffset;
 		memcpy(rtInstanceDesc.Transform, &transforms[i], sizeof(rtInstanceDesc.Transform));
 		rtInstanceDesc.InstanceMask = 0xFF;
 	}
 
 	// Upload ray tracing instance desc to GPU
-	if (update) {
-		updateDataInDefaultHeap(pDevice, pCommandList, tlasBuffers.pInstanceDesc, tlasTempBuffer, rtInstanceDescs.data(), sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * rtInstanceDescs.size(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-	}
-	else {
-		tlasBuffers.pInstanceDesc = uploadDataToDefaultHeap(pDevice, pCommandList, tlasTempBuffer, rtInstanceDescs.data(), sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * rtInstanceDescs.size(), D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-	}
-
-	rtStructureDescriptor.InstanceDescs = tlasBuffers.pInstanceDesc->GetGPUVirtualAddress();
+	const std::size_t instanceDescsSize = sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * rtInstanceDescs.size();
+	tlasBuffers.pInstanceDesc = createCommittedResource(pDevice, D3D12_HEAP_TYPE_DEFAULT, instanceDescsSize, D3D12_RESOURCE_STATE_COPY_DEST);
+	updateDataInDefaultHeap(pCommandList, tlasBuffers.pInstanceDesc, allocateUpload, rtInstanceDescs.data(), instanceDescsSize, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
 
 	// Descriptor for building TLAS
 	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC tlasDesc = {};
 	tlasDesc.Inputs = rtStructureDescriptor;
+	tlasDesc.Inputs.InstanceDescs = tlasBuffers.pInstanceDesc->GetGPUVirtualAddress();
 	tlasDesc.DestAccelerationStructureData = tlasBuffers.pResult->GetGPUVirtualAddress();
 	tlasDesc.ScratchAccelerationStructureData = tlasBuffers.pScratch->GetGPUVirtualAddress();
 
-	if (update) {
-		tlasDesc.Inputs.Flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
-		tlasDesc.SourceAccelerationStructureData = tlasBuffers.pResult->GetGPUVirtualAddress();
+	pCommandList->BuildRaytracingAccelerationStructure(&tlasDesc, 0, nullptr);
+
+	// Insert barrier for uav access..
+	pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::UAV(tlasBuffers.pResult.Get()));
+}
+
+void Util::DXUtil::updateTopLevelAS(
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList,
+	const UploadAllocator& allocateUpload,
+	const std::vector<DirectX::XMFLOAT3X4>& transforms,
+	const std::vector<std::pair<std::size_t, std::size_t>>& ranges,
+	AccelerationStructureBuffers& tlasBuffers)
+{
+	if (ranges.empty()) {
+		return;
+	}
+
+	std::vector<D3D12_RAYTRACING_INSTANCE_DESC>& rtInstanceDescs = tlasBuffers.instanceDescs;
+	for (const auto& range : ranges) {
+		for (size_t i = range.first; i < range.second; ++i) {
+			memcpy(rtInstanceDescs[i].Transform, &transforms[i], sizeof(rtInstanceDescs[i].Transform));
+		}
 	}
 
+	// Previous refit (or the build) must be done with the result before it is used as the source
+	pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::UAV(tlasBuffers.pResult.Get()));
+	// Buffers decay to COMMON once a command list using them completes
+	updateDataRangesInDefaultHeap(pCommandList, tlasBuffers.pInstanceDesc, allocateUpload, rtInstanceDescs.data(), sizeof(D3D12_RAYTRACING_INSTANCE_DESC), ranges, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+	// Same inputs as the build, the driver refits in place
+	D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC tlasDesc = {};
+	tlasDesc.Inputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+	tlasDesc.Inputs.NumDescs = rtInstanceDescs.size();
+	tlasDesc.Inputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL;
+	tlasDesc.Inputs.Flags = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_ALLOW_UPDATE | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+	tlasDesc.Inputs.InstanceDescs = tlasBuffers.pInstanceDesc->GetGPUVirtualAddress();
+	tlasDesc.DestAccelerationStructureData = tlasBuffers.pResult->GetGPUVirtualAddress();
+	tlasDesc.SourceAccelerationStructureData = tlasBuffers.pResult->GetGPUVirtualAddress();
+	tlasDesc.ScratchAccelerationStructureData = tlasBuffers.pScratch->GetGPUVirtualAddress();
+
 	pCommandList->BuildRaytracingAccelerationStructure(&tlasDesc, 0, nullptr);
 
-	// Insert barrier for uav access..
 	pCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::UAV(tlasBuffers.pResult.Get()));
 }
@@ -6,8 +6,13 @@
 #include <wrl/client.h>
 
 #include <vector>
+#include <utility>
+#include <functional>
 #include <DirectXMath.h>
 
+#include "GpuMemoryAllocator.h"
+#include "ResourceStateTracker.h"
+
 namespace Util 
 {
 	class DXUtil {
@@ -39,14 +44,43 @@ namespace Util
 			UINT winWidth, UINT winHeight,
 			UINT numDSV);
 
+		// Resources created by the functions below are placed by the allocator when one is set (it has to outlive them)
+		static void setMemoryAllocator(GpuMemoryAllocator* allocator);
+		static GpuMemoryAllocator* getMemoryAllocator();
+
 		static Microsoft::WRL::ComPtr<ID3D12Resource> createCommittedResource(Microsoft::WRL::ComPtr<ID3D12Device5> device, D3D12_HEAP_TYPE heapType, UINT64 size, D3D12_RESOURCE_STATES resourceState, D3D12_RESOURCE_FLAGS resourceFlags = D3D12_RESOURCE_FLAG_NONE);
-		static Microsoft::WRL::ComPtr<ID3D12Resource> createTextureCommittedResource(Microsoft::WRL::ComPtr<ID3D12Device5> device, D3D12_HEAP_TYPE heapType, UINT64 width, UINT64 height, D3D12_RESOURCE_STATES resourceState, D3D12_RESOURCE_FLAGS resourceFlags = D3D12_RESOURCE_FLAG_NONE, DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM);
+		static Microsoft::WRL::ComPtr<ID3D12Resource> createTextureCommittedResource(Microsoft::WRL::ComPtr<ID3D12Device5> device, D3D12_HEAP_TYPE heapType, UINT64 width, UINT64 height, D3D12_RESOURCE_STATES resourceState, D3D12_RESOURCE_FLAGS resourceFlags = D3D12_RESOURCE_FLAG_NONE, DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM, UINT16 mipLevels = 1);
 		
 		static Microsoft::WRL::ComPtr<ID3D12Resource> uploadDataToDefaultHeap(Microsoft::WRL::ComPtr<ID3D12Device5> device, Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList, Microsoft::WRL::ComPtr<ID3D12Resource>& tempResource, const void* ptData, std::size_t dataSize, D3D12_RESOURCE_STATES finalState);
-		static Microsoft::WRL::ComPtr<ID3D12Resource> uploadTextureDataToDefaultHeap(Microsoft::WRL::ComPtr<ID3D12Device5> device, Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList, Microsoft::WRL::ComPtr<ID3D12Resource>& tempResource, const void* ptData, std::size_t width, std::size_t height, std::size_t sizePerPixel, DXGI_FORMAT format, D3D12_RESOURCE_STATES finalState);
+		// ptData holds mipLevels levels, tightly packed from largest to smallest.
+		// For block compressed formats sizePerPixel is the size of a 4x4 block.
+		static Microsoft::WRL::ComPtr<ID3D12Resource> uploadTextureDataToDefaultHeap(Microsoft::WRL::ComPtr<ID3D12Device5> device, Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList, Microsoft::WRL::ComPtr<ID3D12Resource>& tempResource, const void* ptData, std::size_t width, std::size_t height, std::size_t sizePerPixel, DXGI_FORMAT format, D3D12_RESOURCE_STATES finalState, UINT16 mipLevels = 1);
 
 		static void updateDataInDefaultHeap(Microsoft::WRL::ComPtr<ID3D12Device5> device, Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList, Microsoft::WRL::ComPtr<ID3D12Resource>& resource, Microsoft::WRL::ComPtr<ID3D12Resource>& tempResource, const void* ptData, std::size_t dataSize, D3D12_RESOURCE_STATES previousState, D3D12_RESOURCE_STATES finalState);
 
+		// Part of a persistently mapped upload buffer
+		struct UploadAllocation {
+			ID3D12Resource* pResource;
+			UINT64 offset;
+			std::uint8_t* pData; // CPU address of offset
+		};
+		// Returns space for size bytes that stays valid until the GPU is done with the current frame
+		using UploadAllocator = std::function<UploadAllocation(std::size_t size)>;
+
+		// Same as above, but the data is staged in space from allocateUpload instead of a new upload heap
+		static void updateDataInDefaultHeap(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList, Microsoft::WRL::ComPtr<ID3D12Resource>& resource, const UploadAllocator& allocateUpload, const void* ptData, std::size_t dataSize, D3D12_RESOURCE_STATES previousState, D3D12_RESOURCE_STATES finalState);
+		// Only copies the [begin, end) element ranges of ptData, packed into one upload allocation. Does nothing if there are no ranges.
+		static void updateDataRangesInDefaultHeap(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList, Microsoft::WRL::ComPtr<ID3D12Resource>& resource, const UploadAllocator& allocateUpload, const void* ptData, std::size_t elementSize, const std::vector<std::pair<std::size_t, std::size_t>>& ranges, D3D12_RESOURCE_STATES previousState, D3D12_RESOURCE_STATES finalState);
+		// Stages the texture in space from allocateUpload, which has to be aligned to D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+		static Microsoft::WRL::ComPtr<ID3D12Resource> uploadTextureDataToDefaultHeap(Microsoft::WRL::ComPtr<ID3D12Device5> device, Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList, const UploadAllocator& allocateUpload, const void* ptData, std::size_t width, std::size_t height, std::size_t sizePerPixel, DXGI_FORMAT format, D3D12_RESOURCE_STATES finalState, UINT16 mipLevels = 1);
+		// Upload space all subresources of desc need, with every row at its required pitch
+		static UINT64 getTextureUploadSize(Microsoft::WRL::ComPtr<ID3D12Device5> device, const D3D12_RESOURCE_DESC& desc);
+
+		// Records all of stateTracker's pending barriers with a single ResourceBarrier call
+		static void flushBarriers(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList, ResourceStateTracker& stateTracker);
+
+		static bool isBlockCompressed(DXGI_FORMAT format);
+
 		static Microsoft::WRL::ComPtr<ID3D12RootSignature> createRootSignature(Microsoft::WRL::ComPtr<ID3D12Device5> device, const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& rootSignatureDesc);
 
 		// RT Stuff
@@ -56,6 +90,8 @@ namespace Util
 			Microsoft::WRL::ComPtr<ID3D12Resource> pScratch;
 			Microsoft::WRL::ComPtr<ID3D12Resource> pResult;
 			Microsoft::WRL::ComPtr<ID3D12Resource> pInstanceDesc; // For top-level AS
+			UINT64 resultOffset = 0; // Where the AS starts in pResult, which may be shared by several
+			std::vector<D3D12_RAYTRACING_INSTANCE_DESC> instanceDescs; // CPU copy of pInstanceDesc, for top-level AS
 		};
 
 		// Vertex buffer must be in a readable state
@@ -67,14 +103,27 @@ namespace Util
 			const std::vector<size_t>& vertexCounts,
 			UINT vertexSize);
 
+		// One instance per entry of instanceIds, instance i uses blasBuffers[blasIndices[i]]
 		static void buildTopLevelAS(
 			Microsoft::WRL::ComPtr<ID3D12Device5> pDevice,
 			Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList,
-			std::vector<Util::DXUtil::AccelerationStructureBuffers> blasBuffers,
-			Microsoft::WRL::ComPtr<ID3D12Resource>& tlasTempBuffer,
+			const std::vector<Util::DXUtil::AccelerationStructureBuffers>& blasBuffers,
+			const std::vector<std::size_t>& blasIndices,
+			const UploadAllocator& allocateUpload,
 			const std::vector<std::size_t>& instanceIds,
 			const std::vector<DirectX::XMFLOAT3X4>& transforms,
-			bool update,
 			AccelerationStructureBuffers& tlasBuffers);
+
+		// Refits a TLAS from buildTopLevelAS after the transforms in the [begin, end) instance ranges changed.
+		// Only those instance descs are patched and uploaded. Does nothing if there are no ranges.
+		static void updateTopLevelAS(
+			Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList4> pCommandList,
+			const UploadAllocator& allocateUpload,
+			const std::vector<DirectX::XMFLOAT3X4>& transforms,
+			const std::vector<std::pair<std::size_t, std::size_t>>& ranges,
+			AccelerationStructureBuffers& tlasBuffers);
+
+	private:
+		static GpuMemoryAllocator* memoryAllocator;
 	};
 }
\ No newline at end of file
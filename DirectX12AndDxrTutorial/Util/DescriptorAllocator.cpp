@@ -0,0 +1,133 @@
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+
+using namespace std;
+
+Util::DescriptorAllocator::DescriptorAllocator(std::uint32_t persistentCount, std::uint32_t frameCount, std::size_t slotCount)
+	: persistentCount(persistentCount), frameCount(frameCount), generations(persistentCount), slots(slotCount), frameOffset()
+{
+	if (persistentCount > 0) {
+		freeRanges.push_back({ 0, persistentCount });
+	}
+}
+
+Util::DescriptorAllocator::Handle Util::DescriptorAllocator::allocate(std::uint32_t count)
+{
+	if (count == 0) {
+		return {};
+	}
+
+	// First fit keeps the start of the heap packed
+	for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+		if (it->second - it->first >= count) {
+			const uint32_t index = it->first;
+			it->first += count;
+			if (it->first == it->second) {
+				freeRanges.erase(it);
+			}
+
+			return { index, count, generations[index] };
+		}
+	}
+
+	return {};
+}
+
+bool Util::DescriptorAllocator::free(const Handle& handle)
+{
+	if (!isValid(handle)) {
+		return false;
+	}
+
+	++generations[handle.index];
+	currentFrees.push_back({ handle.index, handle.index + handle.count });
+	return true;
+}
+
+bool Util::DescriptorAllocator::isValid(const Handle& handle) const
+{
+	return handle.count > 0 && handle.index < persistentCount && generations[handle.index] == handle.generation;
+}
+
+std::uint64_t Util::DescriptorAllocator::beginFrame()
+{
+	frameOffset = 0;
+	return slots.advance();
+}
+
+std::uint32_t Util::DescriptorAllocator::allocateTemporary(std::uint32_t count)
+{
+	if (count == 0 || frameCount - frameOffset < count) {
+		return invalidIndex;
+	}
+
+	const uint32_t index = persistentCount + static_cast<uint32_t>(slots.getCurrentSlot()) * frameCount + frameOffset;
+	frameOffset += count;
+	return index;
+}
+
+void Util::DescriptorAllocator::finishFrame(std::uint64_t fenceValue)
+{
+	slots.finishFrame(fenceValue);
+
+	for (const auto& range : currentFrees) {
+		pendingFrees.push_back({ fenceValue, range.first, range.second });
+	}
+	currentFrees.clear();
+}
+
+void Util::DescriptorAllocator::release(std::uint64_t completedFenceValue)
+{
+	while (!pendingFrees.empty() && pendingFrees.front().fenceValue <= completedFenceValue) {
+		addFreeRange(pendingFrees.front().begin, pendingFrees.front().end);
+		pendingFrees.pop_front();
+	}
+}
+
+std::uint32_t Util::DescriptorAllocator::getCapacity() const
+{
+	return persistentCount + frameCount * static_cast<uint32_t>(slots.getSlotCount());
+}
+
+std::uint32_t Util::DescriptorAllocator::getPersistentCount() const
+{
+	return persistentCount;
+}
+
+std::uint32_t Util::DescriptorAllocator::getFreeCount() const
+{
+	uint32_t count = 0;
+	for (const auto& range : freeRanges) {
+		count += range.second - range.first;
+	}
+	return count;
+}
+
+std::uint32_t Util::DescriptorAllocator::getPendingFreeCount() const
+{
+	uint32_t count = 0;
+	for (const auto& range : currentFrees) {
+		count += range.second - range.first;
+	}
+	for (const PendingFree& pending : pendingFrees) {
+		count += pending.end - pending.begin;
+	}
+	return count;
+}
+
+void Util::DescriptorAllocator::addFreeRange(std::uint32_t begin, std::uint32_t end)
+{
+	auto it = lower_bound(freeRanges.begin(), freeRanges.end(), make_pair(begin, end));
+	it = freeRanges.insert(it, { begin, end });
+
+	// Merge with the next range, then with the previous one
+	if (it + 1 != freeRanges.end() && it->second == (it + 1)->first) {
+		it->second = (it + 1)->second;
+		freeRanges.erase(it + 1);
+	}
+	if (it != freeRanges.begin() && (it - 1)->second == it->first) {
+		(it - 1)->second = it->second;
+		freeRanges.erase(it);
+	}
+}
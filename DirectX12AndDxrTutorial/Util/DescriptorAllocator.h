@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "FrameSlotRing.h"
+
+namespace Util
+{
+	// Hands out descriptor indices of one shader visible heap. The front of the heap holds persistent ranges, managed
+	// with a free list. Freed ranges are only reused once the frame that freed them is complete, and stale handles are
+	// recognized by a generation count. The back holds one linear region per frame in flight for temporary descriptors,
+	// which are reset once the frame that last used the region is complete.
+	// Knows nothing about the GPU, the owner supplies the fence values and does the waiting.
+	class DescriptorAllocator {
+	public:
+		static constexpr std::uint32_t invalidIndex = std::numeric_limits<std::uint32_t>::max();
+
+		struct Handle {
+			std::uint32_t index = invalidIndex;
+			std::uint32_t count = 0;
+			std::uint32_t generation = 0;
+		};
+
+		DescriptorAllocator(std::uint32_t persistentCount, std::uint32_t frameCount, std::size_t slotCount);
+
+		// count contiguous descriptors, index is invalidIndex if there is no range large enough
+		Handle allocate(std::uint32_t count);
+		// The handle goes stale right away. Returns false if it already was.
+		bool free(const Handle& handle);
+		bool isValid(const Handle& handle) const;
+
+		// Moves on to the next frame region. Returns the fence value that has to be complete before its descriptors may be
+		// written, 0 if it hasn't been used yet.
+		std::uint64_t beginFrame();
+		// Valid until the current frame completes. Returns invalidIndex if the frame region is full.
+		std::uint32_t allocateTemporary(std::uint32_t count);
+		// Tags the current frame region and the ranges freed since the last call with the frame's fence value
+		void finishFrame(std::uint64_t fenceValue);
+		// Reuses the ranges freed by frames up to completedFenceValue
+		void release(std::uint64_t completedFenceValue);
+
+		std::uint32_t getCapacity() const;
+		std::uint32_t getPersistentCount() const;
+		// Persistent descriptors that can be allocated, not counting the ones waiting for their frame
+		std::uint32_t getFreeCount() const;
+		std::uint32_t getPendingFreeCount() const;
+
+	private:
+		struct PendingFree {
+			std::uint64_t fenceValue;
+			std::uint32_t begin;
+			std::uint32_t end;
+		};
+
+		// Returns [begin, end) to the sorted free list, merging it with its neighbours
+		void addFreeRange(std::uint32_t begin, std::uint32_t end);
+
+		std::uint32_t persistentCount;
+		std::uint32_t frameCount;
+
+		// Sorted [begin, end) ranges
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> freeRanges;
+		std::vector<std::uint32_t> generations;
+
+		// Freed since the last finishFrame, then waiting for their fence value
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> currentFrees;
+		std::deque<PendingFree> pendingFrees;
+
+		FrameSlotRing slots;
+		std::uint32_t frameOffset;
+	};
+}
@@ -0,0 +1,29 @@
+#include "FrameSlotRing.h"
+
+using namespace std;
+
+Util::FrameSlotRing::FrameSlotRing(std::size_t slotCount)
+	: fenceValues(slotCount), currentSlot(slotCount - 1)
+{
+}
+
+std::uint64_t Util::FrameSlotRing::advance()
+{
+	currentSlot = (currentSlot + 1) % fenceValues.size();
+	return fenceValues[currentSlot];
+}
+
+void Util::FrameSlotRing::finishFrame(std::uint64_t fenceValue)
+{
+	fenceValues[currentSlot] = fenceValue;
+}
+
+std::size_t Util::FrameSlotRing::getCurrentSlot() const
+{
+	return currentSlot;
+}
+
+std::size_t Util::FrameSlotRing::getSlotCount() const
+{
+	return fenceValues.size();
+}
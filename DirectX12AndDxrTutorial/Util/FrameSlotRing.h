@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Util
+{
+	// Round robin over slotCount per frame slots (ex. one constant buffer copy per frame in flight). Each slot remembers
+	// the fence value of the last frame that used it, so a slot is only handed out again once the GPU is done with it.
+	// Knows nothing about the GPU, the owner supplies the fence values and does the waiting.
+	class FrameSlotRing {
+	public:
+		FrameSlotRing(std::size_t slotCount);
+
+		// Moves on to the next slot. Returns the fence value that has to be complete before that slot may be written,
+		// 0 if it hasn't been used yet.
+		std::uint64_t advance();
+		// Tags the current slot with the fence value of the frame that used it
+		void finishFrame(std::uint64_t fenceValue);
+
+		std::size_t getCurrentSlot() const;
+		std::size_t getSlotCount() const;
+
+	private:
+		std::vector<std::uint64_t> fenceValues;
+		std::size_t currentSlot;
+	};
+}
@@ -0,0 +1,97 @@
+#include "GeometryDeduplicator.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace std;
+
+void Util::GeometryDeduplicator::add(std::size_t mesh, const Position* positions, std::size_t vertexCount, std::uint64_t dataHash)
+{
+	const Bounds bounds = getBounds(positions, vertexCount);
+
+	Bucket& bucket = buckets[getBucketKey(vertexCount, dataHash)];
+	bucket.entries.insert({ bounds.size[0], { mesh, positions, bounds } });
+	bucket.maxTolerance = std::max(bucket.maxTolerance, bounds.tolerance);
+}
+
+std::size_t Util::GeometryDeduplicator::find(const Position* positions, std::size_t vertexCount, std::uint64_t dataHash, const std::function<bool(std::size_t mesh)>& isSameData) const
+{
+	const auto it = buckets.find(getBucketKey(vertexCount, dataHash));
+	if (it == buckets.end()) {
+		return notFound;
+	}
+
+	const Bucket& bucket = it->second;
+	const Bounds bounds = getBounds(positions, vertexCount);
+
+	// Every entry whose width is close enough, in the order they were added
+	const float window = bounds.tolerance + bucket.maxTolerance;
+	size_t found = notFound;
+	for (auto entry = bucket.entries.lower_bound(bounds.size[0] - window); entry != bucket.entries.end() && entry->first <= bounds.size[0] + window; ++entry) {
+		const Entry& candidate = entry->second;
+		const float tolerance = bounds.tolerance + candidate.bounds.tolerance;
+
+		if (candidate.mesh < found &&
+			std::abs(candidate.bounds.size[0] - bounds.size[0]) <= tolerance &&
+			std::abs(candidate.bounds.size[1] - bounds.size[1]) <= tolerance &&
+			std::abs(candidate.bounds.size[2] - bounds.size[2]) <= tolerance &&
+			isTranslatedCopy(candidate.positions, positions, vertexCount, tolerance) &&
+			isSameData(candidate.mesh)) {
+			found = candidate.mesh;
+		}
+	}
+
+	return found;
+}
+
+std::uint64_t Util::GeometryDeduplicator::hash(std::uint64_t hash, const void* data, std::size_t size)
+{
+	const auto bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; ++i) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+
+	return hash;
+}
+
+bool Util::GeometryDeduplicator::isTranslatedCopy(const Position* a, const Position* b, std::size_t vertexCount, float tolerance)
+{
+	for (size_t i = 1; i < vertexCount; ++i) {
+		if (std::abs((a[i].x - a[0].x) - (b[i].x - b[0].x)) > tolerance ||
+			std::abs((a[i].y - a[0].y) - (b[i].y - b[0].y)) > tolerance ||
+			std::abs((a[i].z - a[0].z) - (b[i].z - b[0].z)) > tolerance) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+Util::GeometryDeduplicator::Bounds Util::GeometryDeduplicator::getBounds(const Position* positions, std::size_t vertexCount)
+{
+	if (vertexCount == 0) {
+		return { { 0.f, 0.f, 0.f }, 0.f };
+	}
+
+	Position low = positions[0];
+	Position high = positions[0];
+	for (size_t i = 1; i < vertexCount; ++i) {
+		low = { std::min(low.x, positions[i].x), std::min(low.y, positions[i].y), std::min(low.z, positions[i].z) };
+		high = { std::max(high.x, positions[i].x), std::max(high.y, positions[i].y), std::max(high.z, positions[i].z) };
+	}
+
+	Bounds bounds = { { high.x - low.x, high.y - low.y, high.z - low.z }, 0.f };
+	const float extent = std::max({ bounds.size[0], bounds.size[1], bounds.size[2] });
+	const float magnitude = std::max({ std::abs(low.x), std::abs(low.y), std::abs(low.z), std::abs(high.x), std::abs(high.y), std::abs(high.z) });
+
+	// Coordinates, and the differences taken from them, are off by up to a few ulps of the largest one
+	bounds.tolerance = 0.5f * relativeTolerance * extent + 2.f * FLT_EPSILON * magnitude;
+	return bounds;
+}
+
+std::uint64_t Util::GeometryDeduplicator::getBucketKey(std::size_t vertexCount, std::uint64_t dataHash)
+{
+	const uint64_t count = vertexCount;
+	return hash(dataHash, &count, sizeof(count));
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <unordered_map>
+
+namespace Util
+{
+	// Finds meshes that are translated copies of meshes added before. A mesh is a list of positions plus data that has to
+	// match exactly (ex. texture coordinates and materials), which the caller hashes and compares. Candidates need the
+	// same data hash and vertex count and a bounding box of the same size, looked up with a range search rather than
+	// quantised cells so that no rounding step can separate two copies. Their positions are then compared relative to the
+	// first vertex. The tolerance scales with the size of the mesh, plus the float rounding error of coordinates that far
+	// from the origin. Only works with plain floats, so it runs without a device.
+	class GeometryDeduplicator {
+	public:
+		struct Position {
+			float x;
+			float y;
+			float z;
+		};
+
+		static constexpr std::size_t notFound = std::numeric_limits<std::size_t>::max();
+		// Largest difference still treated as the same position, relative to the largest bounding box side
+		static constexpr float relativeTolerance = 1e-5f;
+		static constexpr std::uint64_t hashSeed = 14695981039346656037ull;
+
+		// positions have to stay where they are as long as find is used
+		void add(std::size_t mesh, const Position* positions, std::size_t vertexCount, std::uint64_t dataHash);
+		// First added mesh that positions are a translated copy of and isSameData accepts, notFound if there is none
+		std::size_t find(const Position* positions, std::size_t vertexCount, std::uint64_t dataHash, const std::function<bool(std::size_t mesh)>& isSameData) const;
+
+		// FNV-1a over size bytes of data
+		static std::uint64_t hash(std::uint64_t hash, const void* data, std::size_t size);
+		static bool isTranslatedCopy(const Position* a, const Position* b, std::size_t vertexCount, float tolerance);
+
+	private:
+		struct Bounds {
+			float size[3];
+			// Half of what two meshes may differ by
+			float tolerance;
+		};
+
+		struct Entry {
+			std::size_t mesh;
+			const Position* positions;
+			Bounds bounds;
+		};
+
+		// Entries with the same data hash and vertex count, by bounding box width
+		struct Bucket {
+			std::multimap<float, Entry> entries;
+			float maxTolerance = 0.f;
+		};
+
+		static Bounds getBounds(const Position* positions, std::size_t vertexCount);
+		static std::uint64_t getBucketKey(std::size_t vertexCount, std::uint64_t dataHash);
+
+		std::unordered_map<std::uint64_t, Bucket> buckets;
+	};
+}
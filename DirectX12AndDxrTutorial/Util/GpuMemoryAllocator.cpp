@@ -0,0 +1,204 @@
+#include "GpuMemoryAllocator.h"
+
+#include <atomic>
+#include <algorithm>
+
+#include "../Exception/WindowException.h"
+#include "../Libraries/d3dx12.h"
+
+namespace wrl = Microsoft::WRL;
+
+using namespace std;
+
+namespace {
+	// {5A1F2A3C-7E4B-4F51-9C1D-3B8E6F0A2D47}
+	const GUID blockReleaserGuid = { 0x5a1f2a3c, 0x7e4b, 0x4f51, { 0x9c, 0x1d, 0x3b, 0x8e, 0x6f, 0x0a, 0x2d, 0x47 } };
+}
+
+// Attached to a resource as private data. The resource releases it when it is destroyed, which frees the block
+// (or only counts the resource out, for committed resources without a heap).
+class Util::GpuMemoryAllocator::BlockReleaser
+	: public IUnknown
+{
+public:
+	BlockReleaser(GpuMemoryAllocator& allocator, Pool* pool, Heap* heap, UINT64 offset)
+		: refCount(1), allocator(allocator), pool(pool), heap(heap), offset(offset)
+	{
+	}
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+	{
+		if (riid == __uuidof(IUnknown)) {
+			*ppvObject = static_cast<IUnknown*>(this);
+			AddRef();
+			return S_OK;
+		}
+
+		*ppvObject = nullptr;
+		return E_NOINTERFACE;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef() override
+	{
+		return ++refCount;
+	}
+
+	ULONG STDMETHODCALLTYPE Release() override
+	{
+		const ULONG count = --refCount;
+		if (count == 0) {
+			allocator.free(pool, heap, offset);
+			delete this;
+		}
+		return count;
+	}
+
+private:
+	std::atomic<ULONG> refCount;
+	GpuMemoryAllocator& allocator;
+	Pool* pool;
+	Heap* heap;
+	UINT64 offset;
+};
+
+Util::GpuMemoryAllocator::GpuMemoryAllocator(wrl::ComPtr<ID3D12Device5> pDevice, UINT64 heapSize)
+	: pDevice(pDevice), heapSize(heapSize), placedCount(), committedCount()
+{
+}
+
+wrl::ComPtr<ID3D12Resource> Util::GpuMemoryAllocator::createResource(D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES resourceState, const D3D12_CLEAR_VALUE* clearValue)
+{
+	HRESULT hr;
+	wrl::ComPtr<ID3D12Resource> resource;
+
+	const D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = pDevice->GetResourceAllocationInfo(0, 1, &desc);
+
+	unique_lock<std::mutex> lock(poolMutex);
+
+	Pool* pool = allocationInfo.SizeInBytes <= heapSize ? getPool(heapType, desc) : nullptr;
+	if (!pool) {
+		lock.unlock();
+
+		GFXTHROWIFFAILED(pDevice->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(heapType), D3D12_HEAP_FLAG_NONE, &desc, resourceState, clearValue, IID_PPV_ARGS(&resource)));
+
+		lock.lock();
+		++committedCount;
+		lock.unlock();
+
+		// Counted out again when the resource is destroyed
+		BlockReleaser* releaser = new BlockReleaser(*this, nullptr, nullptr, 0);
+		resource->SetPrivateDataInterface(blockReleaserGuid, releaser);
+		releaser->Release();
+
+		return resource;
+	}
+
+	// First heap with a large enough block, or a new one
+	Heap* heap = nullptr;
+	UINT64 offset = BuddyAllocator::invalidOffset;
+	for (size_t i = 0; i < pool->heaps.size() && offset == BuddyAllocator::invalidOffset; ++i) {
+		heap = pool->heaps[i].get();
+		offset = heap->allocator.allocate(allocationInfo.SizeInBytes, allocationInfo.Alignment);
+	}
+
+	if (offset == BuddyAllocator::invalidOffset) {
+		CD3DX12_HEAP_DESC heapDesc(heapSize, heapType, D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT, pool->heapFlags);
+
+		wrl::ComPtr<ID3D12Heap> pHeap;
+		GFXTHROWIFFAILED(pDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&pHeap)));
+
+		pool->heaps.push_back(make_unique<Heap>(Heap{ pHeap, BuddyAllocator(heapSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT) }));
+		heap = pool->heaps.back().get();
+		offset = heap->allocator.allocate(allocationInfo.SizeInBytes, allocationInfo.Alignment);
+	}
+
+	ID3D12Heap* pHeap = heap->heap.Get();
+	++placedCount;
+	lock.unlock();
+
+	hr = pDevice->CreatePlacedResource(pHeap, offset, &desc, resourceState, clearValue, IID_PPV_ARGS(&resource));
+	if (FAILED(hr)) {
+		free(pool, heap, offset);
+		GFXTHROWIFFAILED(hr);
+	}
+
+	// Hand the block over to the resource
+	BlockReleaser* releaser = new BlockReleaser(*this, pool, heap, offset);
+	resource->SetPrivateDataInterface(blockReleaserGuid, releaser);
+	releaser->Release();
+
+	return resource;
+}
+
+Util::GpuMemoryAllocator::Stats Util::GpuMemoryAllocator::getStats() const
+{
+	lock_guard<std::mutex> lock(poolMutex);
+
+	Stats stats = {};
+	stats.placedCount = placedCount;
+	stats.committedCount = committedCount;
+
+	UINT64 freeSize = 0;
+	for (const auto& pool : pools) {
+		for (const auto& heap : pool->heaps) {
+			++stats.heapCount;
+			stats.reservedSize += heap->allocator.getCapacity();
+			stats.allocatedSize += heap->allocator.getAllocatedSize();
+			stats.largestFreeBlockSize = std::max(stats.largestFreeBlockSize, heap->allocator.getLargestFreeBlockSize());
+		}
+	}
+
+	freeSize = stats.reservedSize - stats.allocatedSize;
+	stats.fragmentation = freeSize == 0 ? 0.f : 1.f - static_cast<float>(stats.largestFreeBlockSize) / freeSize;
+
+	return stats;
+}
+
+Util::GpuMemoryAllocator::Pool* Util::GpuMemoryAllocator::getPool(D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC& desc)
+{
+	// Resource heap tier 1 keeps buffers, textures and render target / depth stencil textures apart
+	D3D12_HEAP_FLAGS heapFlags;
+	if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER) {
+		heapFlags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+	}
+	else if (!(desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) && heapType == D3D12_HEAP_TYPE_DEFAULT) {
+		heapFlags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+	}
+	else {
+		return nullptr;
+	}
+
+	for (auto& pool : pools) {
+		if (pool->heapType == heapType && pool->heapFlags == heapFlags) {
+			return pool.get();
+		}
+	}
+
+	pools.push_back(make_unique<Pool>(Pool{ heapType, heapFlags, {} }));
+	return pools.back().get();
+}
+
+void Util::GpuMemoryAllocator::free(Pool* pool, Heap* heap, UINT64 offset)
+{
+	lock_guard<std::mutex> lock(poolMutex);
+
+	if (!heap) {
+		--committedCount;
+		return;
+	}
+
+	heap->allocator.free(offset);
+	--placedCount;
+
+	if (!heap->allocator.isEmpty()) {
+		return;
+	}
+
+	// Keep one empty heap around, so that a resource that is recreated right away doesn't create a new heap
+	const auto isSpare = [heap](const unique_ptr<Heap>& other) {
+		return other.get() != heap && other->allocator.isEmpty();
+	};
+	if (any_of(pool->heaps.begin(), pool->heaps.end(), isSpare)) {
+		pool->heaps.erase(find_if(pool->heaps.begin(), pool->heaps.end(), [heap](const unique_ptr<Heap>& other) { return other.get() == heap; }));
+	}
+}
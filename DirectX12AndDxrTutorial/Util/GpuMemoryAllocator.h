@@ -0,0 +1,75 @@
+#pragma once
+#define NOMINMAX
+
+#include <d3d12.h>
+#include <wrl/client.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "BuddyAllocator.h"
+
+namespace Util
+{
+	// Places resources in large ID3D12Heaps instead of giving each one its own implicit heap.
+	// There is a pool of heaps per heap type and resource class (buffers, textures), each heap is split up by a buddy allocator.
+	// A resource's block is freed when the resource is destroyed, and a heap left empty is destroyed as well, except for
+	// one spare per pool. Resources that can't be placed (render targets,
+	// depth stencils, anything larger than a heap) fall back to committed resources.
+	// The allocator has to outlive every resource it created.
+	class GpuMemoryAllocator {
+	public:
+		static constexpr UINT64 defaultHeapSize = 64ull << 20;
+
+		struct Stats {
+			std::size_t heapCount;
+			UINT64 reservedSize; // size of all heaps
+			UINT64 allocatedSize; // blocks handed out, including the rounding up to a power of two
+			UINT64 largestFreeBlockSize;
+			// Live resources, both drop when a resource is destroyed
+			std::size_t placedCount;
+			std::size_t committedCount;
+			// 0 if all free space is in one block, approaching 1 as it is scattered into small blocks
+			float fragmentation;
+		};
+
+		GpuMemoryAllocator(Microsoft::WRL::ComPtr<ID3D12Device5> pDevice, UINT64 heapSize = defaultHeapSize);
+		GpuMemoryAllocator(const GpuMemoryAllocator&) = delete;
+		GpuMemoryAllocator& operator=(const GpuMemoryAllocator&) = delete;
+
+		Microsoft::WRL::ComPtr<ID3D12Resource> createResource(D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES resourceState, const D3D12_CLEAR_VALUE* clearValue = nullptr);
+
+		Stats getStats() const;
+
+	private:
+		class BlockReleaser;
+
+		struct Heap {
+			Microsoft::WRL::ComPtr<ID3D12Heap> heap;
+			BuddyAllocator allocator;
+		};
+
+		struct Pool {
+			D3D12_HEAP_TYPE heapType;
+			D3D12_HEAP_FLAGS heapFlags;
+			// Heaps are referred to by the blocks handed out, so they don't move when others are destroyed
+			std::vector<std::unique_ptr<Heap>> heaps;
+		};
+
+		// Null if the resource can't be placed
+		Pool* getPool(D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC& desc);
+		// A null heap frees a committed resource
+		void free(Pool* pool, Heap* heap, UINT64 offset);
+
+		Microsoft::WRL::ComPtr<ID3D12Device5> pDevice;
+		UINT64 heapSize;
+
+		std::vector<std::unique_ptr<Pool>> pools;
+		std::size_t placedCount;
+		std::size_t committedCount;
+
+		// Resources may be released from any thread
+		mutable std::mutex poolMutex;
+	};
+}
@@ -0,0 +1,76 @@
+#include "MappedFile.h"
+
+#include "../Exception/WindowException.h"
+
+using namespace Util;
+
+Util::MappedFile::MappedFile(const std::string& fileName)
+	: fileName(fileName), fileHandle(INVALID_HANDLE_VALUE), mappingHandle(NULL), data(), size()
+{
+	HRESULT hr;
+
+	fileHandle = ::CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		hr = HRESULT_FROM_WIN32(::GetLastError());
+		ThrowWindowException(hr);
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!::GetFileSizeEx(fileHandle, &fileSize)) {
+		hr = HRESULT_FROM_WIN32(::GetLastError());
+		::CloseHandle(fileHandle);
+		ThrowWindowException(hr);
+	}
+
+	size = static_cast<std::size_t>(fileSize.QuadPart);
+
+	// Empty files cannot be mapped
+	if (size == 0) {
+		return;
+	}
+
+	mappingHandle = ::CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle == NULL) {
+		hr = HRESULT_FROM_WIN32(::GetLastError());
+		::CloseHandle(fileHandle);
+		ThrowWindowException(hr);
+	}
+
+	data = static_cast<const std::uint8_t*>(::MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (data == nullptr) {
+		hr = HRESULT_FROM_WIN32(::GetLastError());
+		::CloseHandle(mappingHandle);
+		::CloseHandle(fileHandle);
+		ThrowWindowException(hr);
+	}
+}
+
+Util::MappedFile::~MappedFile()
+{
+	if (data != nullptr) {
+		::UnmapViewOfFile(data);
+	}
+
+	if (mappingHandle != NULL) {
+		::CloseHandle(mappingHandle);
+	}
+
+	if (fileHandle != INVALID_HANDLE_VALUE) {
+		::CloseHandle(fileHandle);
+	}
+}
+
+const std::uint8_t* Util::MappedFile::getData() const
+{
+	return data;
+}
+
+std::size_t Util::MappedFile::getSize() const
+{
+	return size;
+}
+
+const std::string& Util::MappedFile::getFileName() const
+{
+	return fileName;
+}
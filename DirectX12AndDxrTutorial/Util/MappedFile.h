@@ -0,0 +1,31 @@
+#pragma once
+
+#define NOMINMAX
+#include <Windows.h>
+
+#include <cstdint>
+#include <string>
+
+namespace Util
+{
+	// Read-only view of a whole file, mapped into the address space.
+	// Pages are loaded lazily by the OS and are shared with any other process mapping the same file.
+	class MappedFile {
+	public:
+		MappedFile(const std::string& fileName);
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		virtual ~MappedFile();
+
+		const std::uint8_t* getData() const;
+		std::size_t getSize() const;
+		const std::string& getFileName() const;
+
+	private:
+		std::string fileName;
+		HANDLE fileHandle;
+		HANDLE mappingHandle;
+		const std::uint8_t* data;
+		std::size_t size;
+	};
+}
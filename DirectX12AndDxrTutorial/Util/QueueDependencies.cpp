@@ -0,0 +1,42 @@
+#include "QueueDependencies.h"
+
+#include <algorithm>
+
+using namespace std;
+
+void Util::QueueDependencies::setProducer(Key key, std::uint64_t fenceValue)
+{
+	producerFenceValues[key] = fenceValue;
+}
+
+std::uint64_t Util::QueueDependencies::getRequiredWait(const std::vector<Key>& keys) const
+{
+	uint64_t fenceValue = 0;
+	for (Key key : keys) {
+		const auto it = producerFenceValues.find(key);
+		if (it != producerFenceValues.end() && it->second > waitedFenceValue) {
+			fenceValue = std::max(fenceValue, it->second);
+		}
+	}
+
+	return fenceValue;
+}
+
+void Util::QueueDependencies::setWaited(std::uint64_t fenceValue)
+{
+	waitedFenceValue = std::max(waitedFenceValue, fenceValue);
+
+	for (auto it = producerFenceValues.begin(); it != producerFenceValues.end();) {
+		it = it->second <= waitedFenceValue ? producerFenceValues.erase(it) : next(it);
+	}
+}
+
+std::uint64_t Util::QueueDependencies::getWaitedFenceValue() const
+{
+	return waitedFenceValue;
+}
+
+std::size_t Util::QueueDependencies::getPendingCount() const
+{
+	return producerFenceValues.size();
+}
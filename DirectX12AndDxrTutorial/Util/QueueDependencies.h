@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Util
+{
+	// Remembers which fence value of a producer queue (e.g. the copy queue) wrote each resource, and tells a consumer
+	// queue which fence value it has to wait for before it may use a set of them. Waits already made are remembered, so
+	// the consumer never waits twice for the same work. Knows nothing about the GPU, the owner issues the waits.
+	class QueueDependencies {
+	public:
+		using Key = const void*;
+
+		// Fence value the producer signals once its writes to key are done
+		void setProducer(Key key, std::uint64_t fenceValue);
+		// 0 if none of keys is pending. Keys without a producer never are.
+		std::uint64_t getRequiredWait(const std::vector<Key>& keys) const;
+		// The consumer waits for fenceValue, which covers every producer fence up to it
+		void setWaited(std::uint64_t fenceValue);
+
+		std::uint64_t getWaitedFenceValue() const;
+		std::size_t getPendingCount() const;
+
+	private:
+		std::unordered_map<Key, std::uint64_t> producerFenceValues;
+		std::uint64_t waitedFenceValue = 0;
+	};
+}
@@ -0,0 +1,244 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+
+using namespace std;
+
+Util::RenderGraph::Handle Util::RenderGraph::createTransient(const std::string& name, std::uint64_t size, std::uint64_t alignment)
+{
+	resources.push_back({ name, true, size, std::max<uint64_t>(alignment, 1), 0, 0 });
+	return resources.size() - 1;
+}
+
+Util::RenderGraph::Handle Util::RenderGraph::importResource(const std::string& name, State initialState, State finalState)
+{
+	resources.push_back({ name, false, 0, 1, initialState, finalState });
+	return resources.size() - 1;
+}
+
+Util::RenderGraph::Handle Util::RenderGraph::addPass(const std::string& name)
+{
+	passes.push_back({ name, {} });
+	return passes.size() - 1;
+}
+
+void Util::RenderGraph::read(Handle pass, Handle resource, State state)
+{
+	passes[pass].accesses.push_back({ resource, state, false });
+}
+
+void Util::RenderGraph::write(Handle pass, Handle resource, State state)
+{
+	passes[pass].accesses.push_back({ resource, state, true });
+}
+
+Util::RenderGraph::Compiled Util::RenderGraph::compile() const
+{
+	// Culls passes whose results nobody needs, working back from the imported resources
+	vector<bool> neededResources(resources.size());
+	for (size_t r = 0; r < resources.size(); ++r) {
+		neededResources[r] = !resources[r].transient;
+	}
+
+	vector<bool> neededPasses(passes.size());
+	for (size_t p = passes.size(); p-- > 0;) {
+		for (const Access& access : passes[p].accesses) {
+			neededPasses[p] = neededPasses[p] || (access.write && neededResources[access.resource]);
+		}
+
+		if (neededPasses[p]) {
+			for (const Access& access : passes[p].accesses) {
+				if (!access.write) {
+					neededResources[access.resource] = true;
+				}
+			}
+		}
+	}
+
+	// A pass goes one step after the latest pass it depends on: the last writer of everything it accesses, and for
+	// writes also the readers since then
+	vector<size_t> levels(passes.size());
+	vector<Handle> lastWriters(resources.size(), invalidHandle);
+	vector<vector<Handle>> readers(resources.size());
+	size_t stepCount = 0;
+
+	for (size_t p = 0; p < passes.size(); ++p) {
+		if (!neededPasses[p]) {
+			continue;
+		}
+
+		size_t level = 0;
+		for (const Access& access : passes[p].accesses) {
+			if (lastWriters[access.resource] != invalidHandle) {
+				level = std::max(level, levels[lastWriters[access.resource]] + 1);
+			}
+			if (access.write) {
+				for (Handle reader : readers[access.resource]) {
+					level = std::max(level, levels[reader] + 1);
+				}
+			}
+		}
+
+		for (const Access& access : passes[p].accesses) {
+			if (access.write) {
+				lastWriters[access.resource] = p;
+				readers[access.resource].clear();
+			}
+			else {
+				readers[access.resource].push_back(p);
+			}
+		}
+
+		levels[p] = level;
+		stepCount = std::max(stepCount, level + 1);
+	}
+
+	Compiled compiled = {};
+	compiled.steps.resize(stepCount);
+	for (size_t p = 0; p < passes.size(); ++p) {
+		if (neededPasses[p]) {
+			compiled.steps[levels[p]].passes.push_back(p);
+		}
+	}
+
+	// State every resource needs in every step, in the order the step first accesses them
+	vector<vector<pair<Handle, State>>> stepStates(stepCount);
+	vector<size_t> firstSteps(resources.size(), invalidHandle);
+	vector<size_t> lastSteps(resources.size(), invalidHandle);
+	compiled.initialStates.resize(resources.size());
+
+	for (size_t s = 0; s < stepCount; ++s) {
+		vector<bool> written(resources.size());
+
+		for (Handle p : compiled.steps[s].passes) {
+			for (const Access& access : passes[p].accesses) {
+				auto& states = stepStates[s];
+				auto it = find_if(states.begin(), states.end(), [&](const pair<Handle, State>& state) { return state.first == access.resource; });
+				if (it == states.end()) {
+					states.push_back({ access.resource, access.state });
+					written[access.resource] = access.write;
+				}
+				else if (access.write) {
+					it->second = access.state;
+					written[access.resource] = true;
+				}
+				else if (!written[access.resource]) {
+					// Passes of the same step can only share a resource for reading
+					it->second |= access.state;
+				}
+			}
+		}
+
+		for (const auto& state : stepStates[s]) {
+			if (firstSteps[state.first] == invalidHandle) {
+				firstSteps[state.first] = s;
+			}
+			lastSteps[state.first] = s;
+			compiled.initialStates[state.first] = state.second;
+		}
+	}
+
+	// Imported resources start where their owner left them, transients where the previous frame left them
+	for (size_t r = 0; r < resources.size(); ++r) {
+		if (!resources[r].transient) {
+			compiled.initialStates[r] = resources[r].initialState;
+		}
+	}
+
+	// Places the largest transients first, each at the lowest offset that doesn't overlap a transient it's alive with
+	vector<Handle> transients;
+	for (size_t r = 0; r < resources.size(); ++r) {
+		if (resources[r].transient && firstSteps[r] != invalidHandle) {
+			transients.push_back(r);
+		}
+	}
+	stable_sort(transients.begin(), transients.end(), [&](Handle a, Handle b) { return resources[a].size > resources[b].size; });
+
+	compiled.heapOffsets.assign(resources.size(), invalidOffset);
+	for (size_t i = 0; i < transients.size(); ++i) {
+		const Resource& resource = resources[transients[i]];
+
+		vector<pair<uint64_t, uint64_t>> occupied;
+		for (size_t j = 0; j < i; ++j) {
+			const Handle other = transients[j];
+			if (firstSteps[other] <= lastSteps[transients[i]] && firstSteps[transients[i]] <= lastSteps[other]) {
+				occupied.push_back({ compiled.heapOffsets[other], compiled.heapOffsets[other] + resources[other].size });
+			}
+		}
+
+		const uint64_t offset = findOffset(move(occupied), resource.size, resource.alignment);
+		compiled.heapOffsets[transients[i]] = offset;
+		compiled.heapSize = std::max(compiled.heapSize, offset + resource.size);
+		compiled.transientSize += (resource.size + resource.alignment - 1) / resource.alignment * resource.alignment;
+	}
+
+	const auto sharesMemory = [&](Handle a) {
+		for (Handle b : transients) {
+			if (b != a && compiled.heapOffsets[a] < compiled.heapOffsets[b] + resources[b].size && compiled.heapOffsets[b] < compiled.heapOffsets[a] + resources[a].size) {
+				return true;
+			}
+		}
+		return false;
+	};
+
+	vector<State> states = compiled.initialStates;
+	for (size_t s = 0; s < stepCount; ++s) {
+		for (const auto& state : stepStates[s]) {
+			if (resources[state.first].transient && firstSteps[state.first] == s && sharesMemory(state.first)) {
+				compiled.steps[s].barriers.push_back({ Barrier::Aliasing, state.first, 0, 0 });
+			}
+			if (states[state.first] != state.second) {
+				compiled.steps[s].barriers.push_back({ Barrier::Transition, state.first, states[state.first], state.second });
+				states[state.first] = state.second;
+			}
+		}
+	}
+
+	for (size_t r = 0; r < resources.size(); ++r) {
+		if (!resources[r].transient && states[r] != resources[r].finalState) {
+			compiled.finalBarriers.push_back({ Barrier::Transition, r, states[r], resources[r].finalState });
+		}
+	}
+
+	return compiled;
+}
+
+const std::string& Util::RenderGraph::getResourceName(Handle resource) const
+{
+	return resources[resource].name;
+}
+
+const std::string& Util::RenderGraph::getPassName(Handle pass) const
+{
+	return passes[pass].name;
+}
+
+std::size_t Util::RenderGraph::getResourceCount() const
+{
+	return resources.size();
+}
+
+std::size_t Util::RenderGraph::getPassCount() const
+{
+	return passes.size();
+}
+
+bool Util::RenderGraph::isTransient(Handle resource) const
+{
+	return resources[resource].transient;
+}
+
+std::uint64_t Util::RenderGraph::findOffset(std::vector<std::pair<std::uint64_t, std::uint64_t>> occupied, std::uint64_t size, std::uint64_t alignment)
+{
+	sort(occupied.begin(), occupied.end());
+
+	uint64_t offset = 0;
+	for (const auto& range : occupied) {
+		if (range.first >= offset + size) {
+			break;
+		}
+		offset = std::max(offset, (range.second + alignment - 1) / alignment * alignment);
+	}
+
+	return offset;
+}
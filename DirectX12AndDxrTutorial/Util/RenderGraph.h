@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace Util
+{
+	// Describes a frame as passes that declare the resources they read and write, and the state they need them in.
+	// compile() culls passes that don't contribute to an imported resource, groups the rest into steps of passes that
+	// don't depend on each other, works out the barriers in front of every step, and places the transient resources in
+	// one heap, letting resources whose lifetimes don't overlap share memory.
+	// Only deals with handles, sizes and states (D3D12_RESOURCE_STATES in practice), so it runs without a device.
+	// The frame is assumed to repeat: transients start a frame in the state their last use left them in.
+	class RenderGraph {
+	public:
+		using Handle = std::size_t;
+		using State = std::uint32_t;
+
+		static constexpr Handle invalidHandle = std::numeric_limits<Handle>::max();
+		static constexpr std::uint64_t invalidOffset = std::numeric_limits<std::uint64_t>::max();
+
+		struct Barrier {
+			enum Type {
+				Transition = 0,
+				// Resource takes over memory that other transients used, its contents are undefined afterwards
+				Aliasing
+			};
+
+			Type type;
+			Handle resource;
+			State before; // Transitions only
+			State after;
+		};
+
+		// Passes of one step can run in any order (or at the same time), after the step's barriers
+		struct Step {
+			std::vector<Barrier> barriers;
+			std::vector<Handle> passes;
+		};
+
+		struct Compiled {
+			std::vector<Step> steps;
+			// Brings the imported resources into their final states
+			std::vector<Barrier> finalBarriers;
+			// Per resource. invalidOffset for imported resources and transients no pass uses, which don't have to be created.
+			// Transients are created in their initialStates.
+			std::vector<std::uint64_t> heapOffsets;
+			std::vector<State> initialStates;
+			std::uint64_t heapSize;
+			// Without aliasing
+			std::uint64_t transientSize;
+		};
+
+		// Memory managed by the graph. Whoever writes it first in a frame has to overwrite all of it.
+		Handle createTransient(const std::string& name, std::uint64_t size, std::uint64_t alignment);
+		// Created elsewhere (ex. the back buffer), in initialState at the start of the frame and left in finalState
+		Handle importResource(const std::string& name, State initialState, State finalState);
+
+		Handle addPass(const std::string& name);
+		void read(Handle pass, Handle resource, State state);
+		// A pass that also reads the resource needs it in the write state
+		void write(Handle pass, Handle resource, State state);
+
+		Compiled compile() const;
+
+		const std::string& getResourceName(Handle resource) const;
+		const std::string& getPassName(Handle pass) const;
+		std::size_t getResourceCount() const;
+		std::size_t getPassCount() const;
+		bool isTransient(Handle resource) const;
+
+	private:
+		struct Resource {
+			std::string name;
+			bool transient;
+			std::uint64_t size;
+			std::uint64_t alignment;
+			State initialState;
+			State finalState;
+		};
+
+		struct Access {
+			Handle resource;
+			State state;
+			bool write;
+		};
+
+		struct Pass {
+			std::string name;
+			std::vector<Access> accesses;
+		};
+
+		// Lowest offset where a resource fits next to the placed ones it is alive with
+		static std::uint64_t findOffset(std::vector<std::pair<std::uint64_t, std::uint64_t>> occupied, std::uint64_t size, std::uint64_t alignment);
+
+		std::vector<Resource> resources;
+		std::vector<Pass> passes;
+	};
+}
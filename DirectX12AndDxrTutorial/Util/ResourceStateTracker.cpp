@@ -0,0 +1,128 @@
+#include "ResourceStateTracker.h"
+
+using namespace std;
+
+void Util::ResourceStateTracker::RecordingBackend::operator()(const std::vector<Barrier>& barriers)
+{
+	batches.push_back(barriers);
+}
+
+std::size_t Util::ResourceStateTracker::RecordingBackend::getBarrierCount() const
+{
+	size_t count = 0;
+	for (const auto& batch : batches) {
+		count += batch.size();
+	}
+
+	return count;
+}
+
+void Util::ResourceStateTracker::setState(Resource resource, State state)
+{
+	resources[resource] = { state, noPending };
+}
+
+void Util::ResourceStateTracker::forget(Resource resource)
+{
+	resources.erase(resource);
+}
+
+Util::ResourceStateTracker::State Util::ResourceStateTracker::getState(Resource resource) const
+{
+	return resources.at(resource).state;
+}
+
+void Util::ResourceStateTracker::transition(Resource resource, State after)
+{
+	transition(resource, after, false);
+}
+
+void Util::ResourceStateTracker::transitionExactly(Resource resource, State after)
+{
+	transition(resource, after, true);
+}
+
+void Util::ResourceStateTracker::transition(Resource resource, State after, bool exactly)
+{
+	TrackedResource& tracked = resources.at(resource);
+	if (exactly ? tracked.state == after : includes(tracked.state, after)) {
+		return;
+	}
+
+	if (tracked.pendingTransition != noPending) {
+		// before -> state -> after is the same as before -> after, and nothing if that ends where it started
+		Barrier& barrier = pending[tracked.pendingTransition];
+		barrier.after = after;
+		tracked.state = after;
+
+		if (barrier.before == after) {
+			barrier.resource = nullptr;
+			tracked.pendingTransition = noPending;
+		}
+		return;
+	}
+
+	tracked.pendingTransition = pending.size();
+	pending.push_back({ Barrier::Transition, resource, tracked.state, after });
+	tracked.state = after;
+}
+
+void Util::ResourceStateTracker::uavBarrier(Resource resource)
+{
+	// Transitions after this one must stay after it. A null resource stands for all of them.
+	if (!resource) {
+		for (auto& tracked : resources) {
+			tracked.second.pendingTransition = noPending;
+		}
+	}
+	else if (const auto it = resources.find(resource); it != resources.end()) {
+		it->second.pendingTransition = noPending;
+	}
+
+	pending.push_back({ Barrier::Uav, resource, 0, 0 });
+}
+
+void Util::ResourceStateTracker::aliasingBarrier(Resource resource)
+{
+	// Transitions of resource after this one must stay after it
+	resources.at(resource).pendingTransition = noPending;
+	pending.push_back({ Barrier::Aliasing, resource, 0, 0 });
+}
+
+void Util::ResourceStateTracker::flush(const Backend& backend)
+{
+	// Drop the merged away transitions
+	vector<Barrier> barriers;
+	barriers.reserve(pending.size());
+	for (const auto& barrier : pending) {
+		if (barrier.type == Barrier::Transition && barrier.resource) {
+			resources.at(barrier.resource).pendingTransition = noPending;
+		}
+
+		if (barrier.resource || barrier.type == Barrier::Uav) {
+			barriers.push_back(barrier);
+		}
+	}
+	pending.clear();
+
+	if (!barriers.empty()) {
+		backend(barriers);
+	}
+}
+
+std::size_t Util::ResourceStateTracker::getPendingCount() const
+{
+	size_t count = 0;
+	for (const auto& barrier : pending) {
+		count += barrier.resource || barrier.type == Barrier::Uav ? 1 : 0;
+	}
+
+	return count;
+}
+
+bool Util::ResourceStateTracker::includes(State state, State after)
+{
+	// Write states are single bits that can't be combined, so a state with more than one bit is a set of read states.
+	// The common state (0) is only included in itself.
+	return state == after || (after != 0 && (state & after) == after);
+}
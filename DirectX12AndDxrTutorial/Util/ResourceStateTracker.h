@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace Util
+{
+	// Tracks the state of every registered resource and collects the barriers needed to reach requested states.
+	// Transitions to the state a resource is already in are dropped, consecutive transitions of one resource are merged,
+	// and everything pending goes to the backend in one batch on flush. Resources and states are opaque
+	// (ID3D12Resource* and D3D12_RESOURCE_STATES in practice), so the tracker runs and can be tested without a device.
+	class ResourceStateTracker {
+	public:
+		using Resource = void*;
+		using State = std::uint32_t;
+
+		struct Barrier {
+			enum Type {
+				Transition = 0,
+				Uav,
+				// Resource takes over memory that other resources used
+				Aliasing
+			};
+
+			Type type;
+			Resource resource;
+			State before; // Transitions only
+			State after;
+		};
+
+		using Backend = std::function<void(const std::vector<Barrier>& barriers)>;
+
+		// Keeps every flushed batch, for tests and debugging
+		struct RecordingBackend {
+			std::vector<std::vector<Barrier>> batches;
+
+			void operator()(const std::vector<Barrier>& barriers);
+			std::size_t getBarrierCount() const;
+		};
+
+		// The state resource is in right now, replaces anything known about it
+		void setState(Resource resource, State state);
+		void forget(Resource resource);
+		// Resource has to be registered with setState
+		State getState(Resource resource) const;
+
+		void transition(Resource resource, State after);
+		// Like transition, but also leaves a set of read states that includes after, for handing a resource over to code
+		// that expects exactly that state
+		void transitionExactly(Resource resource, State after);
+		// Orders unordered access before and after it
+		void uavBarrier(Resource resource);
+		// Placed resource that starts using memory shared with others, before its first transition
+		void aliasingBarrier(Resource resource);
+
+		// One backend call for all pending barriers, none if nothing is pending
+		void flush(const Backend& backend);
+		std::size_t getPendingCount() const;
+
+	private:
+		struct TrackedResource {
+			State state; // Once the pending barriers are done
+			std::size_t pendingTransition; // Index into pending, noPending if it can't be merged into
+		};
+
+		static constexpr std::size_t noPending = static_cast<std::size_t>(-1);
+
+		void transition(Resource resource, State after, bool exactly);
+
+		// state already covers the read only states in after
+		static bool includes(State state, State after);
+
+		std::unordered_map<Resource, TrackedResource> resources;
+		std::vector<Barrier> pending;
+	};
+}
@@ -0,0 +1,92 @@
+#include "RingAllocator.h"
+
+using namespace std;
+
+Util::RingAllocator::RingAllocator(std::uint64_t capacity)
+	: capacity(capacity), head(), tail(), usedSize(), currentFrameSize()
+{
+}
+
+std::uint64_t Util::RingAllocator::allocate(std::uint64_t size, std::uint64_t alignment)
+{
+	if (size == 0 || size > capacity) {
+		return invalidOffset;
+	}
+
+	// Start over at the beginning whenever the ring is empty (and no finished frame still refers to the old positions)
+	if (usedSize == 0 && frames.empty()) {
+		head = tail = 0;
+	}
+
+	const uint64_t offset = (head + alignment - 1) & ~(alignment - 1);
+	uint64_t allocatedSize;
+
+	if (head < tail) {
+		// Free space is [head, tail)
+		if (offset > tail || tail - offset < size) {
+			return invalidOffset;
+		}
+
+		allocatedSize = offset - head + size;
+		head = offset + size;
+	}
+	else if (head == tail && usedSize > 0) {
+		// Full
+		return invalidOffset;
+	}
+	else if (offset <= capacity && capacity - offset >= size) {
+		// Free space is [head, capacity) and [0, tail)
+		allocatedSize = offset - head + size;
+		head = offset + size;
+	}
+	else if (size <= tail) {
+		// Skip the rest of the ring and wrap around
+		allocatedSize = capacity - head + size;
+		head = size;
+		usedSize += allocatedSize;
+		currentFrameSize += allocatedSize;
+		return 0;
+	}
+	else {
+		return invalidOffset;
+	}
+
+	usedSize += allocatedSize;
+	currentFrameSize += allocatedSize;
+	return offset;
+}
+
+void Util::RingAllocator::finishFrame(std::uint64_t fenceValue)
+{
+	frames.push_back({ fenceValue, head, currentFrameSize });
+	currentFrameSize = 0;
+}
+
+void Util::RingAllocator::release(std::uint64_t completedFenceValue)
+{
+	while (!frames.empty() && frames.front().fenceValue <= completedFenceValue) {
+		tail = frames.front().end;
+		usedSize -= frames.front().size;
+		frames.pop_front();
+	}
+}
+
+std::uint64_t Util::RingAllocator::getOldestFenceValue() const
+{
+	return frames.front().fenceValue;
+}
+
+bool Util::RingAllocator::hasPendingFrames() const
+{
+	return !frames.empty();
+}
+
+std::uint64_t Util::RingAllocator::getCapacity() const
+{
+	return capacity;
+}
+
+std::uint64_t Util::RingAllocator::getUsedSize() const
+{
+	return usedSize;
+}
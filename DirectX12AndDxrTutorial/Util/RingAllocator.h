@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+
+namespace Util
+{
+	// Hands out offsets into a ring of capacity bytes. Allocations are grouped into frames: finishFrame tags everything
+	// allocated since the previous call with a fence value, and release frees all frames whose fence value has been reached.
+	// Knows nothing about the GPU, the owner supplies the fence values.
+	class RingAllocator {
+	public:
+		static constexpr std::uint64_t invalidOffset = std::numeric_limits<std::uint64_t>::max();
+
+		RingAllocator(std::uint64_t capacity);
+
+		// Returns invalidOffset if there isn't enough contiguous space. alignment has to be a power of two.
+		std::uint64_t allocate(std::uint64_t size, std::uint64_t alignment = 1);
+
+		// Closes the current frame, its allocations are freed once completedFenceValue passes fenceValue
+		void finishFrame(std::uint64_t fenceValue);
+		void release(std::uint64_t completedFenceValue);
+
+		// Fence value of the oldest frame that hasn't been released. Only valid if hasPendingFrames().
+		std::uint64_t getOldestFenceValue() const;
+		bool hasPendingFrames() const;
+
+		std::uint64_t getCapacity() const;
+		// Includes padding and space skipped when wrapping around
+		std::uint64_t getUsedSize() const;
+
+	private:
+		struct Frame {
+			std::uint64_t fenceValue;
+			std::uint64_t end; // head when the frame was finished
+			std::uint64_t size;
+		};
+
+		std::uint64_t capacity;
+		// Next allocation starts at head, the oldest live allocation at tail
+		std::uint64_t head;
+		std::uint64_t tail;
+		std::uint64_t usedSize;
+		std::uint64_t currentFrameSize;
+
+		std::deque<Frame> frames;
+	};
+}
@@ -0,0 +1,119 @@
+#include "ShaderTableBuilder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+void Util::ShaderTableBuilder::Arguments::addHandle(std::uint64_t handle)
+{
+	// Only needs padding after an odd number of constants
+	data.resize(align(data.size(), handleSize));
+
+	const auto bytes = reinterpret_cast<const uint8_t*>(&handle);
+	data.insert(data.end(), bytes, bytes + sizeof(handle));
+}
+
+void Util::ShaderTableBuilder::Arguments::addConstants(const std::uint32_t* values, std::size_t count)
+{
+	const auto bytes = reinterpret_cast<const uint8_t*>(values);
+	data.insert(data.end(), bytes, bytes + count * sizeof(uint32_t));
+}
+
+const std::vector<std::uint8_t>& Util::ShaderTableBuilder::Arguments::getData() const
+{
+	return data;
+}
+
+Util::ShaderTableBuilder::ShaderTableBuilder(const std::vector<SectionDesc>& sectionDescs)
+{
+	size_t offset = 0;
+	for (const SectionDesc& desc : sectionDescs) {
+		const size_t recordStride = align(identifierSize + desc.argumentsSize, recordAlignment);
+		const size_t size = align(recordStride * desc.recordCount, tableAlignment);
+
+		sections.push_back({ offset, recordStride, desc.recordCount, size });
+		offset += size;
+	}
+
+	data.resize(offset);
+	if (offset > 0) {
+		dirtyRanges.push_back({ 0, offset });
+	}
+}
+
+void Util::ShaderTableBuilder::setRecord(std::size_t section, std::size_t record, const void* identifier, const Arguments& arguments)
+{
+	const Section& s = sections.at(section);
+	if (record >= s.recordCount || identifierSize + arguments.getData().size() > s.recordStride) {
+		throw out_of_range("Record " + to_string(record) + " of section " + to_string(section) + " does not fit the shader table");
+	}
+
+	// Whatever the arguments don't cover stays zero
+	const size_t offset = s.offset + s.recordStride * record;
+	vector<uint8_t> recordData(s.recordStride);
+	memcpy(recordData.data(), identifier, identifierSize);
+	copy(arguments.getData().begin(), arguments.getData().end(), recordData.begin() + identifierSize);
+
+	write(offset, recordData.data(), recordData.size());
+}
+
+const std::vector<Util::ShaderTableBuilder::Section>& Util::ShaderTableBuilder::getSections() const
+{
+	return sections;
+}
+
+std::size_t Util::ShaderTableBuilder::getSize() const
+{
+	return data.size();
+}
+
+const std::vector<std::uint8_t>& Util::ShaderTableBuilder::getData() const
+{
+	return data;
+}
+
+std::vector<std::pair<std::size_t, std::size_t>> Util::ShaderTableBuilder::takeDirtyRanges()
+{
+	sort(dirtyRanges.begin(), dirtyRanges.end());
+
+	vector<pair<size_t, size_t>> merged;
+	for (const auto& range : dirtyRanges) {
+		if (!merged.empty() && range.first <= merged.back().second) {
+			merged.back().second = std::max(merged.back().second, range.second);
+		}
+		else {
+			merged.push_back(range);
+		}
+	}
+
+	dirtyRanges.clear();
+	return merged;
+}
+
+std::size_t Util::ShaderTableBuilder::align(std::size_t size, std::size_t alignment)
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+void Util::ShaderTableBuilder::write(std::size_t offset, const void* ptData, std::size_t size)
+{
+	const auto bytes = static_cast<const uint8_t*>(ptData);
+
+	// One range from the first to the last changed byte
+	size_t begin = size;
+	size_t end = 0;
+	for (size_t i = 0; i < size; ++i) {
+		if (data[offset + i] != bytes[i]) {
+			begin = std::min(begin, i);
+			end = i + 1;
+		}
+	}
+
+	if (begin < end) {
+		memcpy(data.data() + offset + begin, bytes + begin, end - begin);
+		dirtyRanges.push_back({ offset + begin, offset + end });
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Util
+{
+	// Lays out a ray tracing shader table and keeps a CPU copy of its contents. The table has one section per record
+	// type (ray generation, miss, hit group), every record is a shader identifier followed by its root arguments.
+	// Identifiers are opaque bytes, so this runs without a device. Records that are set again only mark the bytes that
+	// actually changed as dirty, so that an update uploads just those.
+	class ShaderTableBuilder {
+	public:
+		// Same as the D3D12_SHADER_IDENTIFIER_SIZE_IN_BYTES, D3D12_RAYTRACING_SHADER_RECORD_BYTE_ALIGNMENT and
+		// D3D12_RAYTRACING_SHADER_TABLE_BYTE_ALIGNMENT, checked in ShadingTable.cpp
+		static constexpr std::size_t identifierSize = 32;
+		static constexpr std::size_t recordAlignment = 32;
+		static constexpr std::size_t tableAlignment = 64;
+
+		// Root arguments of one record, laid out the way D3D12 reads local root arguments: 32-bit constants are packed
+		// at 4 byte alignment, descriptor handles and addresses take 8 bytes and are aligned to 8, with zero padding in
+		// between. Adding zeroes gives the size a record with those parameters needs.
+		class Arguments {
+		public:
+			void addHandle(std::uint64_t handle);
+			void addConstants(const std::uint32_t* values, std::size_t count);
+
+			const std::vector<std::uint8_t>& getData() const;
+
+			static constexpr std::size_t handleSize = sizeof(std::uint64_t);
+
+		private:
+			std::vector<std::uint8_t> data;
+		};
+
+		struct SectionDesc {
+			std::size_t recordCount;
+			std::size_t argumentsSize; // of the largest record
+		};
+
+		struct Section {
+			std::size_t offset;
+			std::size_t recordStride;
+			std::size_t recordCount;
+			std::size_t size; // Padded to tableAlignment
+		};
+
+		ShaderTableBuilder(const std::vector<SectionDesc>& sections);
+
+		// Throws std::out_of_range if the record doesn't exist or its arguments don't fit
+		void setRecord(std::size_t section, std::size_t record, const void* identifier, const Arguments& arguments);
+
+		const std::vector<Section>& getSections() const;
+		std::size_t getSize() const;
+		const std::vector<std::uint8_t>& getData() const;
+
+		// Sorted, merged [begin, end) byte ranges changed since the last call
+		std::vector<std::pair<std::size_t, std::size_t>> takeDirtyRanges();
+
+		static std::size_t align(std::size_t size, std::size_t alignment);
+
+	private:
+		// Copies size bytes to offset, marking the ones that differ
+		void write(std::size_t offset, const void* ptData, std::size_t size);
+
+		std::vector<Section> sections;
+		std::vector<std::uint8_t> data;
+		std::vector<std::pair<std::size_t, std::size_t>> dirtyRanges;
+	};
+}
@@ -0,0 +1,34 @@
+#include "StagingPacker.h"
+
+#include <numeric>
+
+using namespace std;
+
+Util::StagingPacker::StagingPacker(std::uint64_t pageSize)
+	: pageSize(pageSize)
+{
+}
+
+Util::StagingPacker::Placement Util::StagingPacker::add(std::uint64_t size, std::uint64_t alignment)
+{
+	for (size_t page = 0; page < pageSizes.size(); ++page) {
+		const uint64_t offset = (pageSizes[page] + alignment - 1) & ~(alignment - 1);
+		if (offset + size <= pageSize) {
+			pageSizes[page] = offset + size;
+			return { page, offset };
+		}
+	}
+
+	pageSizes.push_back(size);
+	return { pageSizes.size() - 1, 0 };
+}
+
+const std::vector<std::uint64_t>& Util::StagingPacker::getPageSizes() const
+{
+	return pageSizes;
+}
+
+std::uint64_t Util::StagingPacker::getTotalSize() const
+{
+	return accumulate(pageSizes.begin(), pageSizes.end(), uint64_t(0));
+}
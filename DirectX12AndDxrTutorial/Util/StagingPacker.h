@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace Util
+{
+	// Packs uploads into as few staging pages as possible. Each upload goes into the first page it fits in (first fit,
+	// in submission order), a new page is opened otherwise. An upload larger than a page gets a page of its own.
+	// Pages are only as large as their contents, so the caller allocates exactly getPageSizes().
+	class StagingPacker {
+	public:
+		struct Placement {
+			std::size_t page;
+			std::uint64_t offset;
+		};
+
+		StagingPacker(std::uint64_t pageSize);
+
+		// alignment has to be a power of two
+		Placement add(std::uint64_t size, std::uint64_t alignment);
+
+		const std::vector<std::uint64_t>& getPageSizes() const;
+		std::uint64_t getTotalSize() const;
+
+	private:
+		std::uint64_t pageSize;
+		std::vector<std::uint64_t> pageSizes;
+	};
+}
@@ -0,0 +1,133 @@
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <algorithm>
+
+using namespace std;
+using namespace Util;
+
+namespace {
+	// State of a single parallelFor call. Shared, as helper tasks may start after the call has returned.
+	struct ParallelForJob {
+		ParallelForJob(size_t count, const function<void(size_t)>& fn)
+			: count(count), fn(fn), next(), completed()
+		{}
+
+		void run() {
+			size_t i;
+			while ((i = next++) < count) {
+				try {
+					fn(i);
+				}
+				catch (...) {
+					lock_guard<std::mutex> lock(mutex);
+					if (!exception) {
+						exception = current_exception();
+					}
+				}
+
+				if (++completed == count) {
+					lock_guard<std::mutex> lock(mutex);
+					done.notify_all();
+				}
+			}
+		}
+
+		void wait() {
+			unique_lock<std::mutex> lock(mutex);
+			done.wait(lock, [this]() { return completed == count; });
+		}
+
+		const size_t count;
+		const function<void(size_t)> fn;
+		atomic<size_t> next;
+		atomic<size_t> completed;
+
+		std::mutex mutex;
+		condition_variable done;
+		exception_ptr exception;
+	};
+}
+
+Util::ThreadPool::ThreadPool(std::size_t threadCount)
+	: stopping()
+{
+	// The calling thread always participates, so one thread less is needed
+	threadCount = max<size_t>(threadCount, 1) - 1;
+	for (size_t i = 0; i < threadCount; ++i) {
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+Util::ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	taskAvailable.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+void Util::ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)>& fn)
+{
+	if (count == 0) {
+		return;
+	}
+
+	auto job = make_shared<ParallelForJob>(count, fn);
+
+	const size_t helperCount = min(workers.size(), count - 1);
+	if (helperCount > 0) {
+		{
+			lock_guard<std::mutex> lock(mutex);
+			for (size_t i = 0; i < helperCount; ++i) {
+				tasks.emplace([job]() { job->run(); });
+			}
+		}
+		taskAvailable.notify_all();
+	}
+
+	job->run();
+	job->wait();
+
+	if (job->exception) {
+		rethrow_exception(job->exception);
+	}
+}
+
+std::size_t Util::ThreadPool::getThreadCount() const
+{
+	return workers.size() + 1;
+}
+
+ThreadPool& Util::ThreadPool::getDefault()
+{
+	static ThreadPool threadPool;
+	return threadPool;
+}
+
+void Util::ThreadPool::workerLoop()
+{
+	while (true) {
+		function<void()> task;
+		{
+			unique_lock<std::mutex> lock(mutex);
+			taskAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+			if (stopping && tasks.empty()) {
+				return;
+			}
+
+			task = move(tasks.front());
+			tasks.pop();
+		}
+
+		task();
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace Util
+{
+	class ThreadPool {
+	public:
+		ThreadPool(std::size_t threadCount = std::thread::hardware_concurrency());
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		virtual ~ThreadPool();
+
+		// Calls fn(i) for every i in [0, count) on the pool, the calling thread helps out.
+		// Blocks until all calls have finished and rethrows the first exception thrown by fn.
+		// Safe to call from within a task (the caller never waits on work that has not been picked up)
+		void parallelFor(std::size_t count, const std::function<void(std::size_t)>& fn);
+
+		std::size_t getThreadCount() const;
+
+		// Shared pool used for loading
+		static ThreadPool& getDefault();
+
+	private:
+		void workerLoop();
+
+		std::vector<std::thread> workers;
+		std::queue<std::function<void()>> tasks;
+		std::mutex mutex;
+		std::condition_variable taskAvailable;
+		bool stopping;
+	};
+}